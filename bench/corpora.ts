@@ -0,0 +1,152 @@
+import { Connector, HaverefCb, Value } from '../src/types';
+
+export class Vec {
+  constructor(public x: number, public y: number, public z: number) {}
+}
+
+export class Edge {
+  constructor(public from: Vec, public to: Vec) {}
+}
+
+// eslint-disable-next-line @typescript-eslint/no-explicit-any
+export const connectors: Record<string, Connector<any, any>> = {
+  Vec: {
+    by: Vec,
+    split(v: Vec): [number, number, number] {
+      return [v.x, v.y, v.z];
+    },
+    create([x, y, z]: [number, number, number]): Vec {
+      return new Vec(x, y, z);
+    },
+    hasCreate: true,
+  },
+  Edge: {
+    by: Edge,
+    split(e: Edge): [Vec, Vec] {
+      return [e.from, e.to];
+    },
+    precreate(): Edge {
+      return Object.create(Edge.prototype) as Edge;
+    },
+    postcreate(e: Edge, [from, to]: [Vec, Vec]): Edge {
+      e.from = from;
+      e.to = to;
+      return e;
+    },
+  },
+};
+
+export interface Corpus {
+  name: string;
+  x: Value;
+  haverefCb?: HaverefCb;
+  externalRefs?: Value[]; // same refs as haverefCb finds
+  json: boolean; // JSON can represent it
+}
+
+// deterministic, so runs are comparable
+function makeRandom(seed: number): () => number {
+  let state = seed;
+  return () => {
+    state = (state * 1103515245 + 12345) % 2147483648;
+    return state / 2147483648;
+  };
+}
+
+function makeWord(random: () => number, len: number, alphabet: string): string {
+  let s = '';
+  for (let i = 0; i < len; ++i) {
+    s += alphabet[Math.floor(random() * alphabet.length)];
+  }
+  return s;
+}
+
+const plain = 'abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789';
+const structural = '{}[]:#|`';
+
+function wideRecords(random: () => number): Value {
+  const records: Value[] = [];
+  for (let i = 0; i < 200; ++i) {
+    const record: Record<string, Value> = {};
+    for (let j = 0; j < 50; ++j) {
+      record[`field${j}`] = j % 3 ? makeWord(random, 8, plain) : Math.floor(random() * 100000);
+    }
+    records.push(record);
+  }
+  return records;
+}
+
+function deepNesting(random: () => number): Value {
+  const roots: Value[] = [];
+  for (let i = 0; i < 50; ++i) {
+    let x: Value = makeWord(random, 4, plain);
+    for (let depth = 0; depth < 100; ++depth) {
+      x = depth % 2 ? [x, depth] : { d: x, n: null };
+    }
+    roots.push(x);
+  }
+  return roots;
+}
+
+function escapeHeavy(random: () => number): Value {
+  const texts: string[] = [];
+  for (let i = 0; i < 2000; ++i) {
+    texts.push(makeWord(random, 30, plain.slice(0, 10) + structural));
+  }
+  return texts;
+}
+
+function numberArrays(random: () => number): Value {
+  const arrays: number[][] = [];
+  for (let i = 0; i < 100; ++i) {
+    const numbers: number[] = [];
+    for (let j = 0; j < 200; ++j) {
+      numbers.push(j % 2 ? Math.floor(random() * 1e6) : random() * 1e3);
+    }
+    arrays.push(numbers);
+  }
+  return arrays;
+}
+
+function connectorGraph(random: () => number): Value {
+  const vecs: Vec[] = [];
+  for (let i = 0; i < 1000; ++i) {
+    vecs.push(new Vec(random(), random(), random()));
+  }
+  const edges: Edge[] = [];
+  for (let i = 0; i < 3000; ++i) {
+    edges.push(new Edge(vecs[Math.floor(random() * vecs.length)], vecs[Math.floor(random() * vecs.length)]));
+  }
+  return edges;
+}
+
+const extBacks = [{ shared: 'a' }, { shared: 'b' }, { shared: 'c' }];
+
+function backrefs(random: () => number): Value {
+  const items: Value[] = [];
+  for (let i = 0; i < 2000; ++i) {
+    const item: Record<string, Value> = { id: i, ext: extBacks[i % extBacks.length] };
+    item.self = item;
+    item.label = makeWord(random, 6, plain);
+    items.push(item);
+  }
+  return items;
+}
+
+const extHaverefCb: HaverefCb = (x: Value) => {
+  const idx = extBacks.indexOf(x as { shared: string });
+  return idx >= 0 ? idx : null;
+};
+
+export const backrefCb = (idx: number): Value => extBacks[idx];
+
+const corpora: Corpus[] = [
+  { name: 'wide-records', x: wideRecords(makeRandom(1)), json: true },
+  { name: 'deep-nesting', x: deepNesting(makeRandom(2)), json: true },
+  { name: 'escape-heavy', x: escapeHeavy(makeRandom(3)), json: true },
+  { name: 'number-arrays', x: numberArrays(makeRandom(4)), json: true },
+  { name: 'connector-graph', x: connectorGraph(makeRandom(5)), json: false },
+  { name: 'backrefs', x: backrefs(makeRandom(6)), haverefCb: extHaverefCb, externalRefs: extBacks, json: false },
+];
+
+export default corpora;
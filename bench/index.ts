@@ -0,0 +1,211 @@
+import fs = require('fs');
+
+import { BaseParseError, BaseStringifyError, HowNext, Value } from '../src/types';
+import addonFactory from '../src/';
+import corpora, { backrefCb, connectors, Corpus } from './corpora';
+
+// Runs each operation over each corpus and prints the results as JSON.
+// Usage: npm run bench -- [--time <ms per case>] [--corpus <name>] [--out <file>]
+
+interface Result {
+  corpus: string;
+  op: string;
+  impl: string;
+  bytes: number;
+  opsPerSec: number;
+  mbPerSec: number;
+  heapBytesPerOp: number | null; // needs --expose-gc
+}
+
+interface PureWson {
+  stringify(x: Value, opt?: Record<string, unknown>): string;
+  parse(s: string, opt?: Record<string, unknown>): Value;
+  escape(s: string): string;
+  unescape(s: string): string;
+}
+
+function loadPureWson(): PureWson | null {
+  // the pure JS implementation is an optional comparison
+  try {
+    // eslint-disable-next-line @typescript-eslint/no-var-requires, @typescript-eslint/no-unsafe-assignment
+    const wsonModule = require('wson');
+    // eslint-disable-next-line @typescript-eslint/no-unsafe-assignment, @typescript-eslint/no-unsafe-member-access
+    const wsonFactory = wsonModule.default || wsonModule;
+    // eslint-disable-next-line @typescript-eslint/no-unsafe-call
+    return wsonFactory({ useAddon: false, connectors }) as PureWson;
+  } catch (e) {
+    return null;
+  }
+}
+
+function parseArgs(argv: string[]): Record<string, string> {
+  const args: Record<string, string> = {};
+  for (let i = 0; i < argv.length; i += 2) {
+    args[argv[i].replace(/^--/, '')] = argv[i + 1];
+  }
+  return args;
+}
+
+function collectTexts(x: Value, texts: string[]): void {
+  if (typeof x === 'string') {
+    texts.push(x);
+  } else if (Array.isArray(x)) {
+    for (const item of x) {
+      collectTexts(item, texts);
+    }
+  } else if (x != null && typeof x === 'object' && Object.getPrototypeOf(x) === Object.prototype) {
+    for (const [key, value] of Object.entries(x)) {
+      texts.push(key);
+      if (value !== x) {
+        collectTexts(value, texts);
+      }
+    }
+  }
+}
+
+const gc = (global as { gc?: () => void }).gc;
+
+function measureHeap(fn: () => unknown): number | null {
+  if (!gc) {
+    return null;
+  }
+  const runs = 5;
+  const deltas: number[] = [];
+  for (let i = 0; i < runs; ++i) {
+    gc();
+    const before = process.memoryUsage().heapUsed;
+    fn();
+    deltas.push(process.memoryUsage().heapUsed - before);
+  }
+  deltas.sort((a, b) => a - b);
+  return Math.max(0, deltas[runs >> 1]);
+}
+
+function measure(corpus: string, op: string, impl: string, bytes: number, time: number, fn: () => unknown): Result {
+  for (let i = 0; i < 3; ++i) {
+    fn();
+  }
+  let count = 0;
+  const start = process.hrtime.bigint();
+  const limit = start + BigInt(time) * BigInt(1e6);
+  let now = start;
+  do {
+    fn();
+    ++count;
+    now = process.hrtime.bigint();
+  } while (now < limit);
+  const opsPerSec = (count * 1e9) / Number(now - start);
+  return {
+    corpus,
+    op,
+    impl,
+    bytes,
+    opsPerSec,
+    mbPerSec: (opsPerSec * bytes) / 1e6,
+    heapBytesPerOp: measureHeap(fn),
+  };
+}
+
+class StringifyError extends BaseStringifyError {
+  name = 'StringifierError';
+}
+
+class ParseError extends BaseParseError {
+  name = 'ParseError';
+}
+
+function benchCorpus(corpus: Corpus, time: number, pureWson: PureWson | null): Result[] {
+  const stringifier = new addonFactory.Stringifier(StringifyError, { connectors });
+  const parser = new addonFactory.Parser(ParseError, { connectors });
+  const { x, haverefCb } = corpus;
+  const s = stringifier.stringify(x, haverefCb);
+  const bytes = Buffer.byteLength(s);
+  const howNext: HowNext = false;
+  const results: Result[] = [];
+
+  results.push(measure(corpus.name, 'stringify', 'addon', bytes, time, () => stringifier.stringify(x, haverefCb)));
+  if (corpus.externalRefs) {
+    const { externalRefs } = corpus;
+    results.push(
+      measure(corpus.name, 'stringify', 'addon-externalRefs', bytes, time, () =>
+        stringifier.stringify(x, externalRefs),
+      ),
+    );
+  }
+  results.push(measure(corpus.name, 'parse', 'addon', bytes, time, () => parser.parse(s, backrefCb)));
+  if (corpus.externalRefs) {
+    const { externalRefs } = corpus;
+    results.push(measure(corpus.name, 'parse', 'addon-externalRefs', bytes, time, () => parser.parse(s, externalRefs)));
+  }
+  results.push(
+    measure(corpus.name, 'parsePartial', 'addon', bytes, time, () =>
+      parser.parsePartial(s, howNext, () => howNext, backrefCb),
+    ),
+  );
+
+  const texts: string[] = [];
+  collectTexts(x, texts);
+  const escaped = texts.map((text) => stringifier.escape(text));
+  const textBytes = texts.reduce((sum, text) => sum + Buffer.byteLength(text), 0);
+  if (textBytes) {
+    results.push(
+      measure(corpus.name, 'escape', 'addon', textBytes, time, () => texts.map((text) => stringifier.escape(text))),
+    );
+    results.push(
+      measure(corpus.name, 'unescape', 'addon', textBytes, time, () => escaped.map((text) => parser.unescape(text))),
+    );
+  }
+
+  if (corpus.json) {
+    const json = JSON.stringify(x);
+    const jsonBytes = Buffer.byteLength(json);
+    results.push(measure(corpus.name, 'stringify', 'JSON', jsonBytes, time, () => JSON.stringify(x)));
+    results.push(measure(corpus.name, 'parse', 'JSON', jsonBytes, time, () => JSON.parse(json) as Value));
+  }
+
+  if (pureWson) {
+    const opt = { haverefCb, backrefCb };
+    results.push(measure(corpus.name, 'stringify', 'wson', bytes, time, () => pureWson.stringify(x, opt)));
+    results.push(measure(corpus.name, 'parse', 'wson', bytes, time, () => pureWson.parse(s, opt)));
+    if (textBytes) {
+      results.push(
+        measure(corpus.name, 'escape', 'wson', textBytes, time, () => texts.map((text) => pureWson.escape(text))),
+      );
+      results.push(
+        measure(corpus.name, 'unescape', 'wson', textBytes, time, () =>
+          escaped.map((text) => pureWson.unescape(text)),
+        ),
+      );
+    }
+  }
+  return results;
+}
+
+function main(): void {
+  const args = parseArgs(process.argv.slice(2));
+  const time = Number(args.time || 500);
+  const pureWson = loadPureWson();
+  const results: Result[] = [];
+  for (const corpus of corpora) {
+    if (args.corpus && args.corpus !== corpus.name) {
+      continue;
+    }
+    process.stderr.write(`${corpus.name}\n`);
+    results.push(...benchCorpus(corpus, time, pureWson));
+  }
+  const report = {
+    node: process.version,
+    platform: `${process.platform}-${process.arch}`,
+    date: new Date().toISOString(),
+    time,
+    results,
+  };
+  const out = JSON.stringify(report, null, 2);
+  if (args.out) {
+    fs.writeFileSync(args.out, out);
+  } else {
+    process.stdout.write(`${out}\n`);
+  }
+}
+
+main();
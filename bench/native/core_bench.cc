@@ -0,0 +1,415 @@
+// Times the kernels of the native core on synthetic UTF-16 texts, away from the noise of V8.
+// Build: node-gyp rebuild --wson_bench=1
+// Usage: build/Release/wson_core_bench [--size <chars>] [--density <escapes per 100 chars>] [--ms <per case>] [--filter <part of name>]
+// Before timing, the vectorized kernels are checked against their scalar references; a mismatch exits with 1.
+
+#include "parser_tape.h"
+#include "key_order.h"
+#include "record_splitter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+struct Options {
+  size_t size;
+  double density;
+  double ms;
+  std::string filter;
+
+  Options(): size(1 << 20), density(2), ms(200) {}
+};
+
+static volatile size_t sink; // keeps the results alive
+
+// a xorshift generator, so texts are the same on every run
+class Random {
+  public:
+    explicit Random(uint32_t seed): state_(seed) {}
+
+    inline uint32_t next() {
+      state_ ^= state_ << 13;
+      state_ ^= state_ >> 17;
+      state_ ^= state_ << 5;
+      return state_;
+    }
+
+    inline bool chance(double percent) {
+      return next() % 10000 < percent * 100;
+    }
+
+  private:
+    uint32_t state_;
+};
+
+static const char specials[] = "{}[]:#|`";
+
+// plain text, mostly ASCII letters, with density% special chars
+static usc2vector makeText(size_t size, double density, uint32_t seed) {
+  Random random(seed);
+  usc2vector text(size);
+  for (size_t i = 0; i < size; ++i) {
+    if (random.chance(density)) {
+      text[i] = specials[random.next() % 8];
+    } else if (random.chance(2)) {
+      text[i] = 0xe4 + random.next() % 0x100; // some non-ASCII
+    } else {
+      text[i] = 'a' + random.next() % 26;
+    }
+  }
+  return text;
+}
+
+static void appendAscii(usc2vector& doc, const char* s) {
+  for (; *s; ++s) {
+    doc.push_back(*s);
+  }
+}
+
+// a WSON document of about size chars: an array of records with texts, numbers, dates and flags
+static usc2vector makeDoc(size_t size, double density, uint32_t seed) {
+  Random random(seed);
+  usc2vector doc;
+  TargetBuffer escaped;
+  char buf[32];
+  doc.push_back('[');
+  for (size_t i = 0; doc.size() < size; ++i) {
+    if (i) {
+      doc.push_back('|');
+    }
+    escaped.clear();
+    escaped.appendEscaped(makeText(4 + random.next() % 40, density, random.next()));
+    snprintf(buf, sizeof(buf), "%u", random.next() % 100000);
+    appendAscii(doc, "{active|id:#");
+    appendAscii(doc, buf);
+    appendAscii(doc, "|name:");
+    doc.insert(doc.end(), escaped.getBuffer().begin(), escaped.getBuffer().end());
+    snprintf(buf, sizeof(buf), "%.3f", (random.next() % 1000000) / 7.0);
+    appendAscii(doc, "|score:#");
+    appendAscii(doc, buf);
+    snprintf(buf, sizeof(buf), "%u", 1600000000 + random.next() % 100000000);
+    appendAscii(doc, "|seen:#d");
+    appendAscii(doc, buf);
+    appendAscii(doc, "|tags:[a|b`ic|#n]}");
+  }
+  doc.push_back(']');
+  return doc;
+}
+
+static bool wanted(const Options& options, const char* name) {
+  return options.filter.empty() || strstr(name, options.filter.c_str()) != NULL;
+}
+
+// Runs f for about options.ms and prints the time per call and the throughput over chars.
+template<typename F>
+static void run(const Options& options, const char* name, size_t chars, F f) {
+  if (!wanted(options, name)) {
+    return;
+  }
+  typedef std::chrono::steady_clock Clock;
+  sink += f(); // warm up
+  size_t calls = 0;
+  double elapsed = 0;
+  Clock::time_point start = Clock::now();
+  while (elapsed < options.ms * 1e6) {
+    for (int i = 0; i < 8; ++i) {
+      sink += f();
+    }
+    calls += 8;
+    elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  }
+  double nanos = elapsed / calls;
+  printf("%-28s %12.1f ns %10.1f MB/s\n", name, nanos, chars * sizeof(uint16_t) / nanos * 1e3);
+}
+
+static int failures;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    fprintf(stderr, "MISMATCH: %s\n", what);
+    ++failures;
+  }
+}
+
+static size_t nextSplitCharScalar(const uint16_t* data, size_t pos, size_t len) {
+  for (; pos < len && !isSplitChar(data[pos]); ++pos) {}
+  return pos;
+}
+
+static void checkKernels(const usc2vector& text, const usc2vector& doc) {
+  indexVector simd;
+  indexVector scalar;
+  indexStructure(doc.data(), doc.size(), simd);
+  indexStructureScalar(doc.data(), 0, doc.size(), scalar);
+  check(simd == scalar, "indexStructure");
+
+  size_t simdPos = 0;
+  size_t scalarPos = 0;
+  while (simdPos < doc.size()) {
+    simdPos = nextSplitChar(doc.data(), simdPos, doc.size());
+    scalarPos = nextSplitCharScalar(doc.data(), scalarPos, doc.size());
+    if (simdPos != scalarPos) {
+      break;
+    }
+    ++simdPos;
+    ++scalarPos;
+  }
+  check(simdPos == scalarPos, "nextSplitChar");
+
+  TargetBuffer escaped;
+  escaped.appendEscaped(text);
+  TargetBuffer tail;
+  std::copy(text.begin(), text.end(), tail.extend(text.size()));
+  tail.escapeTail(0);
+  check(tail.getBuffer() == escaped.getBuffer(), "escapeTail");
+  TargetBuffer unescaped;
+  check(unescaped.appendUnescaped(escaped.getBuffer()) < 0 && unescaped.getBuffer() == text, "appendUnescaped");
+  check(tail.unescapeTail(0) < 0 && tail.getBuffer() == text, "unescapeTail");
+
+  const uint16_t a[] = {'a', 'b'};
+  const uint16_t b[] = {'a', 'b', 'c'};
+  const uint16_t c[] = {'a', 0xe4};
+  check(keyLess(a, 2, b, 3) && !keyLess(b, 3, a, 2) && !keyLess(a, 2, a, 2), "keyLess prefix");
+  check(keyLess(b, 3, c, 2) && !keyLess(c, 2, b, 3), "keyLess chars");
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--size")) {
+      options.size = strtoul(argv[i + 1], NULL, 10);
+    } else if (!strcmp(argv[i], "--density")) {
+      options.density = strtod(argv[i + 1], NULL);
+    } else if (!strcmp(argv[i], "--ms")) {
+      options.ms = strtod(argv[i + 1], NULL);
+    } else if (!strcmp(argv[i], "--filter")) {
+      options.filter = argv[i + 1];
+    } else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  const usc2vector text = makeText(options.size, options.density, 1);
+  usc2vector doc = makeDoc(options.size, options.density, 2);
+  TargetBuffer escapedText;
+  escapedText.appendEscaped(text);
+  const usc2vector& escaped = escapedText.getBuffer();
+
+  checkKernels(text, doc);
+  if (failures) {
+    return 1;
+  }
+  printf("text %zu chars, doc %zu chars, %.1f%% specials\n", text.size(), doc.size(), options.density);
+
+  TargetBuffer target;
+  run(options, "escape/appendEscaped", text.size(), [&]() {
+    target.clear();
+    target.appendEscaped(text);
+    return target.size();
+  });
+  run(options, "escape/escapeTail", text.size(), [&]() {
+    target.clear();
+    std::copy(text.begin(), text.end(), target.extend(text.size()));
+    target.escapeTail(0);
+    return target.size();
+  });
+  run(options, "unescape/appendUnescaped", escaped.size(), [&]() {
+    target.clear();
+    target.appendUnescaped(escaped);
+    return target.size();
+  });
+  run(options, "unescape/unescapeTail", escaped.size(), [&]() {
+    target.clear();
+    std::copy(escaped.begin(), escaped.end(), target.extend(escaped.size()));
+    target.unescapeTail(0);
+    return target.size();
+  });
+
+  SourceBuffer source;
+  run(options, "source/init", doc.size(), [&]() {
+    source.init(doc.data(), doc.size()); // copies and indexes
+    return source.endIdx;
+  });
+  run(options, "source/next", doc.size(), [&]() {
+    source.attach(doc, 0, doc.size());
+    size_t structural = 0;
+    while (source.nextType != END) {
+      structural += source.nextType != TEXT;
+      source.next();
+    }
+    source.detach(doc);
+    return structural;
+  });
+  run(options, "source/pullUnescaped", doc.size(), [&]() {
+    source.attach(doc, 0, doc.size()); // char by char
+    size_t chars = 0;
+    while (source.nextType != END) {
+      if (source.nextType == TEXT || source.nextType == QUOTE) {
+        source.pullUnescapedBuffer();
+        chars += source.nextBuffer.size();
+      } else {
+        source.next();
+      }
+    }
+    source.detach(doc);
+    return chars;
+  });
+  run(options, "source/pullUnescaped+index", doc.size(), [&]() {
+    source.init(doc.data(), doc.size()); // in runs between structural chars
+    size_t chars = 0;
+    while (source.nextType != END) {
+      if (source.nextType == TEXT || source.nextType == QUOTE) {
+        source.pullUnescapedBuffer();
+        chars += source.nextBuffer.size();
+      } else {
+        source.next();
+      }
+    }
+    return chars;
+  });
+
+  indexVector index;
+  run(options, "index/vector", doc.size(), [&]() {
+    indexStructure(doc.data(), doc.size(), index);
+    return index.size();
+  });
+  run(options, "index/scalar", doc.size(), [&]() {
+    index.clear();
+    indexStructureScalar(doc.data(), 0, doc.size(), index);
+    return index.size();
+  });
+  run(options, "split/vector", doc.size(), [&]() {
+    size_t hits = 0;
+    for (size_t pos = 0; (pos = nextSplitChar(doc.data(), pos, doc.size())) < doc.size(); ++pos) {
+      ++hits;
+    }
+    return hits;
+  });
+  run(options, "split/scalar", doc.size(), [&]() {
+    size_t hits = 0;
+    for (size_t pos = 0; (pos = nextSplitCharScalar(doc.data(), pos, doc.size())) < doc.size(); ++pos) {
+      ++hits;
+    }
+    return hits;
+  });
+
+  std::vector<std::string> numbers;
+  std::vector<std::string> dates;
+  Random random(3);
+  char buf[32];
+  size_t numberChars = 0;
+  for (int i = 0; i < 10000; ++i) {
+    if (i % 2) {
+      snprintf(buf, sizeof(buf), "%u", random.next() % 1000000);
+    } else {
+      snprintf(buf, sizeof(buf), "%.6g", (random.next() % 1000000) / 7.0);
+    }
+    numbers.push_back(buf);
+    numberChars += numbers.back().size();
+    snprintf(buf, sizeof(buf), "d%u", 1600000000 + random.next() % 100000000);
+    dates.push_back(buf);
+  }
+  run(options, "scanNumber", numberChars, [&]() {
+    double sum = 0;
+    double x = 0;
+    for (size_t i = 0; i < numbers.size(); ++i) {
+      SourceBuffer::scanNumber(numbers[i], x);
+      sum += x;
+    }
+    return static_cast<size_t>(sum);
+  });
+  run(options, "scanDate", numberChars, [&]() {
+    double sum = 0;
+    double x = 0;
+    for (size_t i = 0; i < dates.size(); ++i) {
+      SourceBuffer::scanDate(dates[i], x);
+      sum += x;
+    }
+    return static_cast<size_t>(sum);
+  });
+
+  // keys as ObjectAdaptor keeps them: one after the other
+  usc2vector keyBunch;
+  std::vector<size_t> keyBegins;
+  std::vector<size_t> keyLengths;
+  for (int i = 0; i < 1000; ++i) {
+    size_t length = 2 + random.next() % 14;
+    usc2vector key = makeText(length, 0, random.next());
+    key[0] = 'k'; // common prefixes, as in real records
+    keyBegins.push_back(keyBunch.size());
+    keyLengths.push_back(length);
+    keyBunch.insert(keyBunch.end(), key.begin(), key.end());
+  }
+  std::vector<size_t> keyIdxs(keyBegins.size());
+  run(options, "sort/keyLess", keyBunch.size(), [&]() {
+    for (size_t i = 0; i < keyIdxs.size(); ++i) {
+      keyIdxs[i] = keyIdxs.size() - 1 - i;
+    }
+    const uint16_t* keyData = keyBunch.data();
+    std::sort(keyIdxs.begin(), keyIdxs.end(), [&](size_t a, size_t b) {
+      return keyLess(keyData + keyBegins[a], keyLengths[a], keyData + keyBegins[b], keyLengths[b]);
+    });
+    return keyIdxs[0];
+  });
+
+  // a wide object: id keys in the order of insertion, as of a dictionary
+  struct WideKey {
+    size_t keyBeginIdx;
+    size_t keyLength;
+  };
+  usc2vector wideBunch;
+  std::vector<WideKey> wideKeys;
+  for (int i = 0; i < 100000; ++i) {
+    char digits[16];
+    int length = snprintf(digits, sizeof(digits), "%u", 1000000 + random.next() % 9000000);
+    WideKey key = {wideBunch.size(), static_cast<size_t>(length)};
+    wideKeys.push_back(key);
+    wideBunch.insert(wideBunch.end(), digits, digits + length);
+  }
+  const uint16_t* wideData = wideBunch.data();
+  std::vector<size_t> wideIdxs;
+  std::vector<size_t> wideRef(wideKeys.size());
+  for (size_t i = 0; i < wideRef.size(); ++i) {
+    wideRef[i] = i;
+  }
+  std::stable_sort(wideRef.begin(), wideRef.end(), [&](size_t a, size_t b) {
+    return keyLess(wideData + wideKeys[a].keyBeginIdx, wideKeys[a].keyLength, wideData + wideKeys[b].keyBeginIdx, wideKeys[b].keyLength);
+  });
+  KeySorter sorter;
+  sorter.sort(wideData, wideKeys, wideIdxs);
+  bool sameOrder = true;
+  for (size_t i = 0; i < wideIdxs.size(); ++i) {
+    const WideKey& x = wideKeys[wideIdxs[i]];
+    const WideKey& y = wideKeys[wideRef[i]];
+    sameOrder &= std::equal(wideData + x.keyBeginIdx, wideData + x.keyBeginIdx + x.keyLength, wideData + y.keyBeginIdx) && x.keyLength == y.keyLength;
+  }
+  check(sameOrder, "KeySorter");
+  if (failures) {
+    return 1;
+  }
+  run(options, "sort/wide keyLess", wideBunch.size(), [&]() {
+    for (size_t i = 0; i < wideIdxs.size(); ++i) {
+      wideIdxs[i] = i;
+    }
+    std::sort(wideIdxs.begin(), wideIdxs.end(), [&](size_t a, size_t b) {
+      return keyLess(wideData + wideKeys[a].keyBeginIdx, wideKeys[a].keyLength, wideData + wideKeys[b].keyBeginIdx, wideKeys[b].keyLength);
+    });
+    return wideIdxs[0];
+  });
+  run(options, "sort/wide KeySorter", wideBunch.size(), [&]() {
+    sorter.sort(wideData, wideKeys, wideIdxs);
+    return wideIdxs[0];
+  });
+
+  ParserTape tape;
+  run(options, "tape/build", doc.size(), [&]() {
+    source.init(doc.data(), doc.size());
+    tape.build(source, 0, false);
+    return tape.hasError ? 0 : tape.nodes.size();
+  });
+
+  return 0;
+}
@@ -1,16 +1,61 @@
 {
+  "variables": {
+    "wson_count_allocs%": 0,
+    "wson_bench%": 0
+  },
   "targets": [
+    {
+      "target_name": "wson_core",
+      "type": "static_library",
+      "sources": [
+        "src/core/parser_tape.cc"
+      ],
+      "cflags": [ "-fPIC" ],
+      "direct_dependent_settings": {
+        "include_dirs": [ "src/core" ]
+      }
+    },
     {
       "target_name": "wson_addon",
+      "dependencies": [ "wson_core" ],
       "sources": [
         "src/stringifier_target.cc",
         "src/stringifier.cc",
         "src/parser_source.cc",
+        "src/lazy_value.cc",
         "src/parser.cc",
+        "src/alloc_counter.cc",
         "src/wson.cc"
       ],
-      "include_dirs": [ "<!(node -e \"require('nan')\")" ],
-      "cflags": []
+      "include_dirs": [ "<!(node -e \"require('nan')\")", "include" ],
+      "cflags": [],
+      "conditions": [
+        ["wson_count_allocs==1", {
+          "defines": [ "WSON_COUNT_ALLOCS" ],
+          "ldflags": [ "-Wl,-Bsymbolic-functions" ]
+        }]
+      ]
+    },
+    {
+      "target_name": "wson_test_connector",
+      "sources": [
+        "test/native/point_connector.cc"
+      ],
+      "include_dirs": [ "<!(node -e \"require('nan')\")", "include" ]
     }
+  ],
+  "conditions": [
+    ["wson_bench==1", {
+      "targets": [
+        {
+          "target_name": "wson_core_bench",
+          "type": "executable",
+          "dependencies": [ "wson_core" ],
+          "sources": [
+            "bench/native/core_bench.cc"
+          ]
+        }
+      ]
+    }]
   ]
 }
@@ -0,0 +1,68 @@
+#ifndef WSON_NATIVE_CONNECTOR_H_
+#define WSON_NATIVE_CONNECTOR_H_
+
+// The interface of native connectors: split and create implemented in C++, called by
+// wson-addon's stringifier and parser without going through JS.
+//
+// Another addon fills a WsonNativeConnector that lives as long as it is loaded, and hands it
+// to JS with wsonNativeConnector(); its result goes into the connector options as 'native':
+//
+//   connectors: { Point: { by: Point, native: plugin.point } }
+//
+// split or create may be NULL: then the 'split' or 'create' function of the options is used.
+// A connector with a native create is called as one with hasCreate. A connector of another
+// abi version is ignored, so the JS functions, if given, take over. So is a 'native' value that
+// does not come from wsonNativeConnector(): the handle is an object that holds the connector
+// under a private key, which no other value has.
+//
+// Both addons must be built against the same node headers, as v8 handles cross the interface.
+// The functions run on the thread of the isolate, within a handle scope of the caller.
+
+#include <v8.h>
+#include <stdint.h>
+
+#define WSON_NATIVE_CONNECTOR_ABI 1
+
+struct WsonNativeConnector {
+  uint32_t abi; // WSON_NATIVE_CONNECTOR_ABI
+  void* data; // passed to split and create
+
+  // Puts the args of x into args[0, room) and returns their number. If that is more than room,
+  // it is called again with enough room. Returns -1 after throwing a JS exception.
+  int (*split)(void* data, v8::Isolate* isolate, v8::Local<v8::Object> x, v8::Local<v8::Value>* args, int room);
+
+  // Returns the value of args[0, argc). Returns an empty handle after throwing a JS exception.
+  v8::Local<v8::Value> (*create)(void* data, v8::Isolate* isolate, const v8::Local<v8::Value>* args, int argc);
+};
+
+// The private key of the connector in its handle; v8 gives every addon the same one.
+inline v8::Local<v8::Private> wsonNativeConnectorKey(v8::Isolate* isolate) {
+  return v8::Private::ForApi(isolate, v8::String::NewFromUtf8Literal(isolate, "wson:nativeConnector"));
+}
+
+// The handle of connector for the 'native' option.
+inline v8::Local<v8::Value> wsonNativeConnector(v8::Isolate* isolate, const WsonNativeConnector* connector) {
+  v8::Local<v8::Object> handle = v8::Object::New(isolate);
+  v8::Local<v8::External> external = v8::External::New(isolate, const_cast<WsonNativeConnector*>(connector));
+  handle->SetPrivate(isolate->GetCurrentContext(), wsonNativeConnectorKey(isolate), external).Check();
+  return handle;
+}
+
+// The connector of a 'native' option; NULL if it is none, or of another abi.
+inline const WsonNativeConnector* wsonNativeConnectorOf(v8::Local<v8::Value> value) {
+  if (value.IsEmpty() || !value->IsObject()) {
+    return NULL;
+  }
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::Local<v8::Value> external;
+  if (
+    !value.As<v8::Object>()->GetPrivate(isolate->GetCurrentContext(), wsonNativeConnectorKey(isolate)).ToLocal(&external) ||
+    !external->IsExternal()
+  ) {
+    return NULL;
+  }
+  const WsonNativeConnector* connector = static_cast<const WsonNativeConnector*>(external.As<v8::External>()->Value());
+  return connector->abi == WSON_NATIVE_CONNECTOR_ABI ? connector : NULL;
+}
+
+#endif // WSON_NATIVE_CONNECTOR_H_
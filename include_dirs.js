@@ -0,0 +1,2 @@
+// for the include_dirs of addons with native connectors: "<!(node -e \"require('wson-addon/include_dirs')\")"
+console.log(require('path').relative('.', require('path').join(__dirname, 'include')));
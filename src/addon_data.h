@@ -0,0 +1,88 @@
+#ifndef WSON_ADDON_DATA_H_
+#define WSON_ADDON_DATA_H_
+
+#include "types.h"
+#include "wson_native_connector.h"
+
+// The handles the addon caches, one instance per isolate, so it can be loaded in several worker threads.
+// Constructors get it as their data, instances keep a pointer to it.
+struct AddonData {
+  Nan::Persistent<v8::Function> stringifierConstructor;
+  Nan::Persistent<v8::Function> parserConstructor;
+  Nan::Persistent<v8::Function> lazyValueConstructor;
+  Nan::Persistent<v8::Function> objectConstructor;
+  Nan::Persistent<v8::Function> objectIsFrozen;
+  Nan::Persistent<v8::String> sBy;
+  Nan::Persistent<v8::String> sSplit;
+  Nan::Persistent<v8::String> sNative;
+  Nan::Persistent<v8::String> sConstructor;
+  Nan::Persistent<v8::String> sEmpty;
+  Nan::Persistent<v8::String> sCreate;
+  Nan::Persistent<v8::String> sPrecreate;
+  Nan::Persistent<v8::String> sPostcreate;
+  Nan::Persistent<v8::String> sKinds;
+  Nan::Persistent<v8::String> sStarts;
+  Nan::Persistent<v8::String> sEnds;
+  Nan::Persistent<v8::String> sValues;
+  Nan::Persistent<v8::String> sNext;
+
+  // freed when the environment (main thread or worker) of isolate exits
+  explicit AddonData(v8::Isolate* isolate) {
+    sBy.Reset(Nan::New("by").ToLocalChecked());
+    sSplit.Reset(Nan::New("split").ToLocalChecked());
+    sNative.Reset(Nan::New("native").ToLocalChecked());
+    sConstructor.Reset(Nan::New("constructor").ToLocalChecked());
+    sEmpty.Reset(Nan::New("").ToLocalChecked());
+    sCreate.Reset(Nan::New("create").ToLocalChecked());
+    sPrecreate.Reset(Nan::New("precreate").ToLocalChecked());
+    sPostcreate.Reset(Nan::New("postcreate").ToLocalChecked());
+    sKinds.Reset(Nan::New("kinds").ToLocalChecked());
+    sStarts.Reset(Nan::New("starts").ToLocalChecked());
+    sEnds.Reset(Nan::New("ends").ToLocalChecked());
+    sValues.Reset(Nan::New("values").ToLocalChecked());
+    sNext.Reset(Nan::New("next").ToLocalChecked());
+    objectConstructor.Reset(
+      Nan::New<v8::Object>()->Get(Nan::GetCurrentContext(), Nan::New(sConstructor)).ToLocalChecked().As<v8::Function>()
+    );
+    objectIsFrozen.Reset(
+      Nan::New(objectConstructor)->Get(Nan::GetCurrentContext(), Nan::New("isFrozen").ToLocalChecked()).ToLocalChecked().As<v8::Function>()
+    );
+    node::AddEnvironmentCleanupHook(isolate, cleanup, this);
+  }
+
+  ~AddonData() {
+    // std::cout << "AddonData::~AddonData" << std::endl;
+    stringifierConstructor.Reset();
+    parserConstructor.Reset();
+    lazyValueConstructor.Reset();
+    objectConstructor.Reset();
+    objectIsFrozen.Reset();
+    sBy.Reset();
+    sSplit.Reset();
+    sNative.Reset();
+    sConstructor.Reset();
+    sEmpty.Reset();
+    sCreate.Reset();
+    sPrecreate.Reset();
+    sPostcreate.Reset();
+    sKinds.Reset();
+    sStarts.Reset();
+    sEnds.Reset();
+    sValues.Reset();
+    sNext.Reset();
+  }
+
+  inline v8::Local<v8::External> newExternal() {
+    return Nan::New<v8::External>(this);
+  }
+
+  static inline AddonData* fromData(v8::Local<v8::Value> data) {
+    return static_cast<AddonData*>(data.As<v8::External>()->Value());
+  }
+
+  static void cleanup(void* arg) {
+    delete static_cast<AddonData*>(arg);
+  }
+};
+
+#endif // WSON_ADDON_DATA_H_
@@ -0,0 +1,46 @@
+#include "alloc_counter.h"
+
+#ifdef WSON_COUNT_ALLOCS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> allocCount(0);
+
+static inline void* countedAlloc(size_t size) {
+  allocCount.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size ? size : 1);
+  if (!p) {
+    abort();
+  }
+  return p;
+}
+
+void* operator new(size_t size) {
+  return countedAlloc(size);
+}
+
+void* operator new[](size_t size) {
+  return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+NAN_METHOD(AllocCount) {
+  info.GetReturnValue().Set(Nan::New<v8::Number>(allocCount.load(std::memory_order_relaxed)));
+}
+#endif
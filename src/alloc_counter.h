@@ -0,0 +1,12 @@
+#ifndef WSON_ALLOC_COUNTER_H_
+#define WSON_ALLOC_COUNTER_H_
+
+#include "types.h"
+
+// Test hook: built with WSON_COUNT_ALLOCS (node-gyp rebuild --wson_count_allocs=1),
+// the addon counts its native heap allocations and exports allocCount().
+#ifdef WSON_COUNT_ALLOCS
+NAN_METHOD(AllocCount);
+#endif
+
+#endif // WSON_ALLOC_COUNTER_H_
@@ -0,0 +1,69 @@
+#ifndef WSON_BUFFER_HANDLES_H_
+#define WSON_BUFFER_HANDLES_H_
+
+#include "types.h"
+#include "trace.h"
+#include "core/source_buffer.h"
+
+// Between v8 strings and the buffers of the core.
+
+// Owns the chars of an external string; v8 disposes of it along with the string.
+class ExternalBuffer: public v8::String::ExternalStringResource {
+  public:
+    ExternalBuffer(BaseBuffer& buffer) {
+      buffer.swap(buffer_);
+    }
+
+    virtual const uint16_t* data() const {
+      return buffer_.data();
+    }
+
+    virtual size_t length() const {
+      return buffer_.size();
+    }
+
+  private:
+    usc2vector buffer_;
+};
+
+inline void appendHandle(BaseBuffer& target, v8::Local<v8::String> source, int start=0, int length=-1) {
+  if (length < 0) {
+    length = source->Length() - start;
+  }
+  source->Write(v8::Isolate::GetCurrent(), target.extend(length), start, length, v8::String::NO_NULL_TERMINATION);
+}
+
+inline void appendHandleEscaped(TargetBuffer& target, v8::Local<v8::String> source, int start=0, int length=-1) {
+  size_t oldSize = target.size();
+  appendHandle(target, source, start, length);
+  target.escapeTail(oldSize);
+}
+
+inline int appendHandleUnescaped(TargetBuffer& target, v8::Local<v8::String> source, int start=0, int length=-1) {
+  // return error pos; -1 for ok
+  size_t oldSize = target.size();
+  appendHandle(target, source, start, length);
+  return target.unescapeTail(oldSize);
+}
+
+inline v8::Local<v8::String> getHandle(const BaseBuffer& buffer) {
+  const usc2vector& chars = buffer.getBuffer();
+  return Nan::New<v8::String>(chars.data(), chars.size()).ToLocalChecked();
+}
+
+// Hands the chars over to an external string instead of copying them; leaves the buffer empty.
+inline v8::Local<v8::String> takeExternalHandle(BaseBuffer& buffer) {
+  return Nan::New<v8::String>(new ExternalBuffer(buffer)).ToLocalChecked();
+}
+
+inline void initSource(SourceBuffer& source, v8::Local<v8::String> s) {
+  source.clear();
+  {
+    TraceSpan span("wson.copy");
+    appendHandle(source, s);
+  }
+  TraceSpan span("wson.index");
+  source.init();
+}
+
+#endif // WSON_BUFFER_HANDLES_H_
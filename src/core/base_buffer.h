@@ -0,0 +1,215 @@
+#ifndef WSON_BASE_BUFFER_H_
+#define WSON_BASE_BUFFER_H_
+
+#include "types.h"
+#include <algorithm>
+
+class BaseBuffer {
+
+  public:
+
+    BaseBuffer(): grows_(0) {}
+
+    inline void push(uint16_t c) {
+      countGrow(buffer_.size() + 1);
+      buffer_.push_back(c);
+    }
+
+    template<typename S>
+    void append(const S& source, int start=0, int length=-1) {
+      if (length < 0) {
+        length = source.size() - start;
+      }
+      typename S::const_iterator sourceBegin = source.begin() + start;
+      typename S::const_iterator sourceEnd = sourceBegin + length;
+      grow(buffer_.size() + length);
+      buffer_.insert(buffer_.end(), sourceBegin, sourceEnd);
+    }
+
+    inline void appendAscii(const char* source) {
+      for (; *source; ++source) {
+        push(*source);
+      }
+    }
+
+    // the decimal digits of x
+    inline void appendDecimal(uint32_t x) {
+      uint16_t digits[10];
+      uint16_t* d = digits + 10;
+      do {
+        *--d = '0' + x % 10;
+        x /= 10;
+      } while (x);
+      std::copy(d, digits + 10, extend(digits + 10 - d));
+    }
+
+    // Grows by length chars, for the caller to fill in.
+    inline uint16_t* extend(size_t length) {
+      size_t oldSize = buffer_.size();
+      countGrow(oldSize + length);
+      buffer_.resize(oldSize + length);
+      return buffer_.data() + oldSize;
+    }
+
+    // Decodes UTF-8 bytes as v8 (and the WHATWG decoder) does: each maximal subpart of a malformed
+    // sequence becomes one U+FFFD.
+    void appendUtf8(const uint8_t* source, size_t length) {
+      uint16_t* t = extend(length); // never more chars than bytes
+      const uint8_t* end = source + length;
+      while (source < end) {
+        uint32_t c = *source++;
+        if (c < 0x80) {
+          *t++ = c;
+          continue;
+        }
+        int follows;
+        uint8_t lower = 0x80; // the range of the next byte
+        uint8_t upper = 0xbf;
+        if (c >= 0xc2 && c < 0xe0) {
+          follows = 1;
+          c &= 0x1f;
+        } else if (c >= 0xe0 && c < 0xf0) {
+          follows = 2;
+          c &= 0x0f;
+          if (c == 0x0) {
+            lower = 0xa0; // no overlong forms
+          } else if (c == 0xd) {
+            upper = 0x9f; // no surrogates
+          }
+        } else if (c >= 0xf0 && c < 0xf5) {
+          follows = 3;
+          c &= 0x07;
+          if (c == 0x0) {
+            lower = 0x90; // no overlong forms
+          } else if (c == 0x4) {
+            upper = 0x8f; // up to U+10FFFF
+          }
+        } else {
+          *t++ = 0xfffd;
+          continue;
+        }
+        for (; follows > 0 && source < end && *source >= lower && *source <= upper; --follows) {
+          c = (c << 6) | (*source++ & 0x3f);
+          lower = 0x80;
+          upper = 0xbf;
+        }
+        if (follows > 0) {
+          *t++ = 0xfffd; // the byte that does not fit starts over
+        } else if (c >= 0x10000) {
+          c -= 0x10000;
+          *t++ = 0xd800 + (c >> 10);
+          *t++ = 0xdc00 + (c & 0x3ff);
+        } else {
+          *t++ = c;
+        }
+      }
+      buffer_.resize(t - buffer_.data());
+    }
+
+    // Drops the chars from size on.
+    inline void truncate(size_t size) {
+      buffer_.resize(size);
+    }
+
+    // Exchanges the chars with v (e.g. to hand them over without copying).
+    inline void swap(usc2vector& v) {
+      buffer_.swap(v);
+    }
+
+    inline const usc2vector& getBuffer() const {
+      return buffer_;
+    }
+
+    size_t size() const {
+      return buffer_.size();
+    }
+
+    void reserve(size_t x) {
+      countGrow(x);
+      buffer_.reserve(x);
+    }
+
+    inline size_t memorySize() const {
+      return vectorMemory(buffer_);
+    }
+
+    inline void trim(size_t maxSize) {
+      trimVector(buffer_, maxSize);
+    }
+
+    // #reallocations since the last call
+    inline size_t takeGrows() {
+      size_t grows = grows_;
+      grows_ = 0;
+      return grows;
+    }
+
+    static inline uint16_t getEscapeChar(uint16_t c) {
+      switch (c) {
+        case '{':
+          return 'o';
+        case '}':
+          return 'c';
+        case '[':
+          return 'a';
+        case ']':
+          return 'e';
+        case ':':
+          return 'i';
+        case '#':
+          return 'l';
+        case '|':
+          return 'p';
+        case '`':
+          return 'q';
+      }
+      return 0;
+    }
+
+    static inline uint16_t getUnescapeChar(uint16_t c) {
+      switch (c) {
+        case 'o':
+          return '{';
+        case 'c':
+          return '}';
+        case 'a':
+          return '[';
+        case 'e':
+          return ']';
+        case 'i':
+          return ':';
+        case 'l':
+          return '#';
+        case 'p':
+          return '|';
+        case 'q':
+          return '`';
+      }
+      return 0;
+    }
+
+    inline void clear() {
+      buffer_.resize(0);
+    }
+
+  protected:
+    inline void countGrow(size_t newSize) {
+      if (newSize > buffer_.capacity()) {
+        ++grows_;
+      }
+    }
+
+    // Makes room for newSize chars before appending. It grows geometrically, as push_back does:
+    // reserving just what is needed would copy the whole buffer on every append.
+    inline void grow(size_t newSize) {
+      if (newSize > buffer_.capacity()) {
+        ++grows_;
+        buffer_.reserve(std::max(newSize, 2 * buffer_.capacity()));
+      }
+    }
+
+    usc2vector buffer_;
+    size_t grows_;
+};
+
+#endif // WSON_BASE_BUFFER_H_
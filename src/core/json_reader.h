@@ -0,0 +1,371 @@
+#ifndef WSON_JSON_READER_H_
+#define WSON_JSON_READER_H_
+
+#include "target_buffer.h"
+#include <algorithm>
+#include <cstdlib>
+
+// Reads JSON text as JSON.parse does and reports its values to a visitor, as TapeReader does
+// (e.g. a WsonWriter, with sortKeys to write what stringify would). With a customPrefix, an object
+// with a key that starts with it is a custom value, {"<customPrefix><name>":[args]}, as written by
+// JsonWriter; besides that key it must not have any. Values nested deeper than MAX_NESTING are an error.
+template<typename V>
+class JsonReader {
+  public:
+    JsonReader(): hasError(false), errorPos(0), depth_(0) {}
+
+    // false on error
+    bool read(V& visitor, const usc2vector& text) {
+      begin_ = text.data();
+      end_ = begin_ + text.size();
+      it_ = begin_;
+      depth_ = 0;
+      hasError = false;
+      skipSpace();
+      readValue(visitor);
+      skipSpace();
+      if (!hasError && it_ != end_) {
+        makeError(); // extra chars after end
+      }
+      return !hasError;
+    }
+
+    inline size_t memorySize() const {
+      return vectorMemory(string_) + vectorMemory(number_) + vectorMemory(customPrefix) + errorCause.memorySize();
+    }
+
+    inline void trim(size_t maxSize) {
+      trimVector(string_, maxSize);
+      trimVector(number_, maxSize);
+      trimVector(customPrefix, maxSize);
+      errorCause.trim(maxSize);
+    }
+
+    usc2vector customPrefix;
+    bool hasError;
+    size_t errorPos;
+    TargetBuffer errorCause;
+
+  private:
+    inline void skipSpace() {
+      while (it_ != end_ && (*it_ == ' ' || *it_ == '\n' || *it_ == '\r' || *it_ == '\t')) {
+        ++it_;
+      }
+    }
+
+    // at the first char of a value
+    void readValue(V& visitor) {
+      if (it_ == end_) {
+        return makeError();
+      }
+      switch (*it_) {
+        case '"':
+          if (readString()) {
+            visitor.text(string_);
+          }
+          return;
+        case '[':
+        case '{':
+          if (depth_ == MAX_NESTING) {
+            return makeError(it_ - begin_, "nested too deeply");
+          }
+          ++depth_;
+          *it_ == '[' ? readArray(visitor) : readObject(visitor);
+          --depth_;
+          return;
+        case 't':
+          if (readWord("true")) {
+            visitor.boolValue(true);
+          }
+          return;
+        case 'f':
+          if (readWord("false")) {
+            visitor.boolValue(false);
+          }
+          return;
+        case 'n':
+          if (readWord("null")) {
+            visitor.nullValue();
+          }
+          return;
+      }
+      double x;
+      if (readNumber(x)) {
+        visitor.numberValue(x);
+      }
+    }
+
+    inline bool readWord(const char* word) {
+      for (; *word; ++word, ++it_) {
+        if (it_ == end_ || *it_ != *word) {
+          makeError();
+          return false;
+        }
+      }
+      return true;
+    }
+
+    inline bool isDigit(uint16_t c) {
+      return c >= '0' && c <= '9';
+    }
+
+    bool readNumber(double& x) {
+      const uint16_t* begin = it_;
+      if (it_ != end_ && *it_ == '-') {
+        ++it_;
+      }
+      if (it_ == end_ || !isDigit(*it_)) {
+        makeError();
+        return false;
+      }
+      if (*it_++ != '0') {
+        while (it_ != end_ && isDigit(*it_)) {
+          ++it_;
+        }
+      }
+      const uint16_t* intEnd = it_;
+      if (it_ != end_ && *it_ == '.') {
+        ++it_;
+        if (it_ == end_ || !isDigit(*it_)) {
+          makeError();
+          return false;
+        }
+        while (it_ != end_ && isDigit(*it_)) {
+          ++it_;
+        }
+      }
+      if (it_ != end_ && (*it_ == 'e' || *it_ == 'E')) {
+        ++it_;
+        if (it_ != end_ && (*it_ == '+' || *it_ == '-')) {
+          ++it_;
+        }
+        if (it_ == end_ || !isDigit(*it_)) {
+          makeError();
+          return false;
+        }
+        while (it_ != end_ && isDigit(*it_)) {
+          ++it_;
+        }
+      }
+      if (intEnd == it_ && it_ - begin <= 16) { // an integer that is exact as double
+        int64_t n = 0;
+        for (const uint16_t* d = *begin == '-' ? begin + 1 : begin; d != it_; ++d) {
+          n = n * 10 + (*d - '0');
+        }
+        x = *begin == '-' ? -static_cast<double>(n) : n;
+        return true;
+      }
+      number_.assign(begin, it_);
+      x = strtod(number_.c_str(), NULL);
+      return true;
+    }
+
+    // into string_
+    bool readString() {
+      string_.clear();
+      ++it_; // '"'
+      while (true) {
+        const uint16_t* run = it_;
+        while (it_ != end_ && *it_ != '"' && *it_ != '\\' && *it_ >= 0x20) {
+          ++it_;
+        }
+        string_.insert(string_.end(), run, it_);
+        if (it_ == end_ || *it_ < 0x20) {
+          makeError();
+          return false;
+        }
+        if (*it_++ == '"') {
+          return true;
+        }
+        if (it_ == end_) {
+          makeError();
+          return false;
+        }
+        uint16_t c = *it_++;
+        switch (c) {
+          case '"':
+          case '\\':
+          case '/':
+            break;
+          case 'b':
+            c = '\b';
+            break;
+          case 'f':
+            c = '\f';
+            break;
+          case 'n':
+            c = '\n';
+            break;
+          case 'r':
+            c = '\r';
+            break;
+          case 't':
+            c = '\t';
+            break;
+          case 'u':
+            c = 0;
+            for (int i = 0; i < 4; ++i, ++it_) {
+              int digit = it_ == end_ ? -1 : hexDigit(*it_);
+              if (digit < 0) {
+                makeError();
+                return false;
+              }
+              c = (c << 4) | digit;
+            }
+            break;
+          default:
+            --it_;
+            makeError();
+            return false;
+        }
+        string_.push_back(c);
+      }
+    }
+
+    static inline int hexDigit(uint16_t c) {
+      if (c >= '0' && c <= '9') {
+        return c - '0';
+      }
+      if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+      }
+      if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+      }
+      return -1;
+    }
+
+    void readArray(V& visitor) {
+      visitor.beginArray();
+      readItems(visitor, ']');
+      visitor.endArray();
+    }
+
+    // the items up to close, behind the opening bracket
+    void readItems(V& visitor, uint16_t close) {
+      ++it_;
+      skipSpace();
+      if (it_ != end_ && *it_ == close) {
+        ++it_;
+        return;
+      }
+      while (!hasError) {
+        readValue(visitor);
+        skipSpace();
+        if (it_ == end_) {
+          return makeError();
+        }
+        uint16_t c = *it_++;
+        if (c == close) {
+          return;
+        }
+        if (c != ',') {
+          --it_;
+          return makeError();
+        }
+        skipSpace();
+      }
+    }
+
+    void readObject(V& visitor) {
+      ++it_;
+      skipSpace();
+      if (it_ != end_ && *it_ == '}') {
+        ++it_;
+        visitor.beginObject();
+        visitor.endObject();
+        return;
+      }
+      bool first = true;
+      while (!hasError) {
+        if (it_ == end_ || *it_ != '"') {
+          return makeError();
+        }
+        const uint16_t* keyBegin = it_;
+        if (!readString()) {
+          return;
+        }
+        if (isCustomName()) {
+          if (!first) {
+            return makeError(keyBegin - begin_, "custom value with other keys");
+          }
+          return readCustom(visitor);
+        }
+        if (first) {
+          visitor.beginObject();
+          first = false;
+        }
+        visitor.key(string_);
+        skipSpace();
+        if (it_ == end_ || *it_++ != ':') {
+          return makeError();
+        }
+        skipSpace();
+        readValue(visitor);
+        skipSpace();
+        if (it_ == end_) {
+          return makeError();
+        }
+        uint16_t c = *it_++;
+        if (c == '}') {
+          visitor.endObject();
+          return;
+        }
+        if (c != ',') {
+          --it_;
+          return makeError();
+        }
+        skipSpace();
+      }
+    }
+
+    inline bool isCustomName() {
+      return !customPrefix.empty() && string_.size() >= customPrefix.size() &&
+        std::equal(customPrefix.begin(), customPrefix.end(), string_.begin());
+    }
+
+    // behind the key of {"<customPrefix><name>":[args]}
+    void readCustom(V& visitor) {
+      string_.erase(string_.begin(), string_.begin() + customPrefix.size());
+      skipSpace();
+      if (it_ == end_ || *it_++ != ':') {
+        return makeError();
+      }
+      skipSpace();
+      if (it_ == end_ || *it_ != '[') {
+        return makeError(it_ - begin_, "custom value without args array");
+      }
+      visitor.beginCustom(string_);
+      readItems(visitor, ']');
+      visitor.endCustom();
+      skipSpace();
+      if (hasError) {
+        return;
+      }
+      if (it_ == end_ || *it_ != '}') {
+        return makeError(it_ - begin_, "custom value with other keys");
+      }
+      ++it_;
+    }
+
+    void makeError(int pos = -1, const char* cause=NULL) {
+      if (hasError) {
+        return;
+      }
+      errorPos = pos < 0 ? it_ - begin_ : pos;
+      errorCause.clear();
+      if (cause) {
+        errorCause.appendAscii(cause);
+      }
+      hasError = true;
+    }
+
+    const uint16_t* begin_;
+    const uint16_t* end_;
+    const uint16_t* it_;
+    size_t depth_;
+    usc2vector string_; // scratch
+    std::string number_; // scratch
+};
+
+#endif // WSON_JSON_READER_H_
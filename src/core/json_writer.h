@@ -0,0 +1,244 @@
+#ifndef WSON_JSON_WRITER_H_
+#define WSON_JSON_WRITER_H_
+
+#include "target_buffer.h"
+#include "number_format.h"
+
+// Writes values as JSON into a TargetBuffer, as JSON.stringify would write them parsed; it takes
+// the calls of a TapeReader visitor. Dates become ISO strings, entries with undefined are left out.
+// A custom value becomes {"<customPrefix><name>":[args]}. Backrefs have no JSON: they become null,
+// so the caller should reject them first.
+class JsonWriter {
+  public:
+    JsonWriter(TargetBuffer& target): target_(target), keyPending_(false) {}
+
+    inline void clear() {
+      target_.clear();
+      frames_.clear();
+      keyPending_ = false;
+    }
+
+    inline size_t memorySize() const {
+      return vectorMemory(frames_) + vectorMemory(key_) + vectorMemory(customPrefix);
+    }
+
+    inline void trim(size_t maxSize) {
+      trimVector(frames_, maxSize);
+      trimVector(key_, maxSize);
+      trimVector(customPrefix, maxSize);
+    }
+
+    template<typename S>
+    inline void text(const S& s) {
+      putSeparator();
+      putString(s.begin(), s.end());
+    }
+
+    inline void undefinedValue() {
+      if (keyPending_) {
+        keyPending_ = false; // the entry is left out
+      } else if (!frames_.empty()) {
+        nullValue();
+      }
+    }
+
+    inline void nullValue() {
+      putSeparator();
+      putAscii("null", 4);
+    }
+
+    inline void boolValue(bool x) {
+      putSeparator();
+      x ? putAscii("true", 4) : putAscii("false", 5);
+    }
+
+    inline void numberValue(double x) {
+      if (std::isnan(x) || std::isinf(x)) {
+        return nullValue();
+      }
+      char buf[32];
+      putSeparator();
+      putAscii(buf, formatNumber(x, buf));
+    }
+
+    inline void dateValue(double x) {
+      char buf[32];
+      size_t length = formatIsoDate(x, buf);
+      if (!length) {
+        return nullValue(); // an invalid date
+      }
+      putSeparator();
+      target_.push('"');
+      putAscii(buf, length);
+      target_.push('"');
+    }
+
+    inline void backref(int64_t) {
+      nullValue();
+    }
+
+    inline void beginArray(size_t size=0) {
+      putSeparator();
+      target_.push('[');
+      frames_.push_back(FRAME_EMPTY);
+    }
+
+    inline void endArray() {
+      frames_.pop_back();
+      target_.push(']');
+    }
+
+    inline void beginObject(size_t size=0) {
+      putSeparator();
+      target_.push('{');
+      frames_.push_back(FRAME_EMPTY);
+    }
+
+    // written along with its value
+    template<typename S>
+    inline void key(const S& s) {
+      key_.assign(s.begin(), s.end());
+      keyPending_ = true;
+    }
+
+    inline void endObject() {
+      frames_.pop_back();
+      target_.push('}');
+    }
+
+    template<typename S>
+    inline void beginCustom(const S& name, size_t size=0) {
+      putSeparator();
+      target_.push('{');
+      key_.assign(customPrefix.begin(), customPrefix.end());
+      key_.insert(key_.end(), name.begin(), name.end());
+      putString(key_.begin(), key_.end());
+      target_.push(':');
+      target_.push('[');
+      frames_.push_back(FRAME_EMPTY);
+    }
+
+    inline void endCustom() {
+      frames_.pop_back();
+      target_.push(']');
+      target_.push('}');
+    }
+
+    // Writes the time value x (ms since the epoch) as Date.prototype.toISOString() does;
+    // buf needs room for 32 chars. Returns the length, 0 for an invalid date.
+    static size_t formatIsoDate(double x, char* buf) {
+      if (!(std::fabs(x) <= 8.64e15)) {
+        return 0;
+      }
+      int64_t ms = static_cast<int64_t>(x); // towards 0, as TimeClip
+      int64_t days = ms / 86400000;
+      int64_t msOfDay = ms % 86400000;
+      if (msOfDay < 0) {
+        msOfDay += 86400000;
+        --days;
+      }
+      // the civil date of days since 1970-01-01 (proleptic Gregorian)
+      int64_t z = days + 719468;
+      int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+      int64_t doe = z - era * 146097;
+      int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+      int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+      int64_t mp = (5 * doy + 2) / 153;
+      int day = doy - (153 * mp + 2) / 5 + 1;
+      int month = mp < 10 ? mp + 3 : mp - 9;
+      int64_t year = yoe + era * 400 + (month <= 2);
+      int length = year >= 0 && year <= 9999 ?
+        snprintf(buf, 32, "%04d", static_cast<int>(year)) :
+        snprintf(buf, 32, "%c%06d", year < 0 ? '-' : '+', static_cast<int>(year < 0 ? -year : year));
+      length += snprintf(buf + length, 32 - length, "-%02d-%02dT%02d:%02d:%02d.%03dZ", month, day,
+        static_cast<int>(msOfDay / 3600000), static_cast<int>(msOfDay / 60000 % 60),
+        static_cast<int>(msOfDay / 1000 % 60), static_cast<int>(msOfDay % 1000));
+      return length;
+    }
+
+    usc2vector customPrefix;
+
+  private:
+    enum {
+      FRAME_EMPTY = 1
+    };
+
+    inline void putSeparator() {
+      if (frames_.empty()) {
+        return;
+      }
+      uint8_t& frame = frames_.back();
+      if (frame & FRAME_EMPTY) {
+        frame &= ~FRAME_EMPTY;
+      } else {
+        target_.push(',');
+      }
+      if (keyPending_) {
+        keyPending_ = false;
+        putString(key_.begin(), key_.end());
+        target_.push(':');
+      }
+    }
+
+    inline void putAscii(const char* s, size_t length) {
+      uint16_t* t = target_.extend(length);
+      for (size_t i = 0; i < length; ++i) {
+        t[i] = s[i];
+      }
+    }
+
+    inline void putHex(uint16_t c) {
+      static const char digits[] = "0123456789abcdef";
+      char buf[6] = {'\\', 'u', digits[c >> 12], digits[(c >> 8) & 0xf], digits[(c >> 4) & 0xf], digits[c & 0xf]};
+      putAscii(buf, 6);
+    }
+
+    // quoted and escaped; unpaired surrogates as \udxxx, as in well-formed JSON.stringify
+    template<typename I>
+    inline void putString(I it, I end) {
+      target_.push('"');
+      while (it != end) {
+        uint16_t c = *it++;
+        if (c >= 0x20 && c != '"' && c != '\\' && (c < 0xd800 || c >= 0xe000)) {
+          target_.push(c);
+          continue;
+        }
+        switch (c) {
+          case '"':
+          case '\\':
+            target_.push('\\');
+            target_.push(c);
+            continue;
+          case '\b':
+            putAscii("\\b", 2);
+            continue;
+          case '\f':
+            putAscii("\\f", 2);
+            continue;
+          case '\n':
+            putAscii("\\n", 2);
+            continue;
+          case '\r':
+            putAscii("\\r", 2);
+            continue;
+          case '\t':
+            putAscii("\\t", 2);
+            continue;
+        }
+        if (c < 0xdc00 && c >= 0xd800 && it != end && *it >= 0xdc00 && *it < 0xe000) {
+          target_.push(c);
+          target_.push(*it++);
+        } else {
+          putHex(c); // a control char or an unpaired surrogate
+        }
+      }
+      target_.push('"');
+    }
+
+    TargetBuffer& target_;
+    std::vector<uint8_t> frames_;
+    bool keyPending_;
+    usc2vector key_;
+};
+
+#endif // WSON_JSON_WRITER_H_
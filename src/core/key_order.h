@@ -0,0 +1,168 @@
+#ifndef WSON_KEY_ORDER_H_
+#define WSON_KEY_ORDER_H_
+
+#include "types.h"
+#include <algorithm>
+
+// The order of object keys in the output: by UTF-16 code units, a prefix first.
+inline bool keyLess(const uint16_t* itA, size_t lengthA, const uint16_t* itB, size_t lengthB) {
+  const uint16_t* endA = itA + lengthA;
+  const uint16_t* endB = itB + lengthB;
+  while (itA != endA) {
+    if (itB == endB) {  // B ends -> extra A-tail
+      return false;
+    }
+    uint16_t cA = *itA++;
+    uint16_t cB = *itB++;
+    if (cA < cB) {
+      return true;
+    } else if (cA > cB) {
+      return false;
+    }
+  }
+  // A ends; B is longer (true) or equal (false)
+  return itB != endB;
+}
+
+// Puts the entries of an object in keyLess order; an entry E has its key at keyData + E.keyBeginIdx,
+// E.keyLength chars long. Keys already in order cost a pass. Those of wide objects are sorted by
+// radix on their first PREFIX_CHARS chars, kept inline; runs of the same prefix get the next ones,
+// and just small runs are left to keyLess.
+class KeySorter {
+  public:
+    // order: the indices of entries, in order
+    template<typename E>
+    void sort(const uint16_t* keyData, const std::vector<E>& entries, std::vector<size_t>& order) {
+      size_t count = entries.size();
+      order.resize(count);
+      for (size_t i = 0; i < count; ++i) {
+        order[i] = i;
+      }
+      size_t sorted = 1;
+      while (sorted < count && !less(keyData, entries[sorted], entries[sorted - 1])) {
+        ++sorted;
+      }
+      if (sorted >= count) {
+        return;
+      }
+      EntryLess<E> entryLess = {keyData, &entries};
+      if (count < RADIX_MIN_COUNT) {
+        std::sort(order.begin(), order.end(), entryLess);
+        return;
+      }
+      items_.resize(count);
+      scratch_.resize(count);
+      for (size_t i = 0; i < count; ++i) {
+        items_[i].idx = i;
+      }
+      sortRange(keyData, entries, 0, count, 0);
+      for (size_t i = 0; i < count; ++i) {
+        order[i] = items_[i].idx;
+      }
+    }
+
+    inline size_t memorySize() const {
+      return vectorMemory(items_) + vectorMemory(scratch_);
+    }
+
+    inline void trim(size_t maxSize) {
+      trimVector(items_, maxSize);
+      trimVector(scratch_, maxSize);
+    }
+
+  private:
+    enum {
+      PREFIX_CHARS = 4, // in a uint64_t
+      RADIX_MIN_COUNT = 256 // fewer are sorted by keyLess
+    };
+
+    struct Item {
+      uint64_t prefix; // the chars from depth * PREFIX_CHARS on, big-endian, 0 behind the end
+      size_t idx;
+    };
+
+    template<typename E>
+    struct EntryLess {
+      const uint16_t* keyData;
+      const std::vector<E>* entries;
+      inline bool operator()(size_t idxA, size_t idxB) const {
+        return less(keyData, (*entries)[idxA], (*entries)[idxB]);
+      }
+    };
+
+    template<typename E>
+    static inline bool less(const uint16_t* keyData, const E& a, const E& b) {
+      return keyLess(keyData + a.keyBeginIdx, a.keyLength, keyData + b.keyBeginIdx, b.keyLength);
+    }
+
+    // items_[begin, end) share their first depth * PREFIX_CHARS chars
+    template<typename E>
+    void sortRange(const uint16_t* keyData, const std::vector<E>& entries, size_t begin, size_t end, size_t depth) {
+      size_t offset = depth * PREFIX_CHARS;
+      bool longer = false; // some key goes on behind this prefix
+      for (size_t i = begin; i < end; ++i) {
+        const E& entry = entries[items_[i].idx];
+        const uint16_t* key = keyData + entry.keyBeginIdx;
+        uint64_t prefix = 0;
+        for (size_t j = offset; j < offset + PREFIX_CHARS; ++j) {
+          prefix = (prefix << 16) | (j < entry.keyLength ? key[j] : 0);
+        }
+        items_[i].prefix = prefix;
+        longer |= entry.keyLength > offset + PREFIX_CHARS;
+      }
+      radixSort(begin, end);
+      ItemLess<E> itemLess = {{keyData, &entries}};
+      for (size_t runBegin = begin; runBegin < end; ) {
+        size_t runEnd = runBegin + 1;
+        while (runEnd < end && items_[runEnd].prefix == items_[runBegin].prefix) {
+          ++runEnd;
+        }
+        if (runEnd - runBegin >= RADIX_MIN_COUNT && longer) {
+          sortRange(keyData, entries, runBegin, runEnd, depth + 1);
+        } else if (runEnd - runBegin > 1) {
+          std::sort(items_.begin() + runBegin, items_.begin() + runEnd, itemLess);
+        }
+        runBegin = runEnd;
+      }
+    }
+
+    template<typename E>
+    struct ItemLess {
+      EntryLess<E> entryLess;
+      inline bool operator()(const Item& a, const Item& b) const {
+        return entryLess(a.idx, b.idx);
+      }
+    };
+
+    // LSD by bytes of the prefixes, passing over bytes they all share
+    void radixSort(size_t begin, size_t end) {
+      size_t counts[8][256] = {{0}};
+      for (size_t i = begin; i < end; ++i) {
+        uint64_t prefix = items_[i].prefix;
+        for (int b = 0; b < 8; ++b) {
+          ++counts[b][(prefix >> (8 * b)) & 0xff];
+        }
+      }
+      for (int b = 0; b < 8; ++b) {
+        size_t* count = counts[b];
+        if (count[(items_[begin].prefix >> (8 * b)) & 0xff] == end - begin) {
+          continue;
+        }
+        size_t pos = begin;
+        for (int digit = 0; digit < 256; ++digit) {
+          size_t n = count[digit];
+          count[digit] = pos;
+          pos += n;
+        }
+        for (size_t i = begin; i < end; ++i) {
+          scratch_[count[(items_[i].prefix >> (8 * b)) & 0xff]++] = items_[i];
+        }
+        std::copy(scratch_.begin() + begin, scratch_.begin() + end, items_.begin() + begin);
+      }
+    }
+
+    std::vector<Item> items_;
+    std::vector<Item> scratch_;
+};
+
+#endif // WSON_KEY_ORDER_H_
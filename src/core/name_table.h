@@ -0,0 +1,104 @@
+#ifndef WSON_NAME_TABLE_H_
+#define WSON_NAME_TABLE_H_
+
+#include "types.h"
+#include <algorithm>
+
+// Maps names to values with open addressing, looked up by a span of chars (e.g. right in the source),
+// so nothing has to be copied. Built once, then only read.
+template<typename T>
+class NameTable {
+  public:
+    NameTable(): mask_(0), count_(0) {}
+
+    static inline uint32_t hash(const uint16_t* name, size_t length) {
+      uint32_t h = 2166136261u; // FNV-1a
+      for (size_t i = 0; i < length; ++i) {
+        h = (h ^ name[i]) * 16777619u;
+      }
+      return h;
+    }
+
+    // replaces the value of a name already present
+    void insert(const uint16_t* name, size_t length, T value) {
+      if ((count_ + 1) * 2 > slots_.size()) {
+        rehash(slots_.empty() ? 16 : slots_.size() * 2);
+      }
+      uint32_t h = hash(name, length);
+      Slot* slot = probe(name, length, h);
+      if (!slot->used) {
+        slot->used = true;
+        slot->hash = h;
+        slot->nameBegin = names_.size();
+        slot->nameLength = length;
+        names_.insert(names_.end(), name, name + length);
+        ++count_;
+      }
+      slot->value = value;
+    }
+
+    // false if the name is not present
+    inline bool find(const uint16_t* name, size_t length, T& value) const {
+      if (!count_) {
+        return false;
+      }
+      const Slot* slot = probe(name, length, hash(name, length));
+      if (!slot->used) {
+        return false;
+      }
+      value = slot->value;
+      return true;
+    }
+
+    inline size_t size() const {
+      return count_;
+    }
+
+  private:
+    struct Slot {
+      uint32_t hash;
+      uint32_t nameBegin;
+      uint32_t nameLength;
+      bool used;
+      T value;
+    };
+
+    inline Slot* probe(const uint16_t* name, size_t length, uint32_t h) {
+      return const_cast<Slot*>(static_cast<const NameTable*>(this)->probe(name, length, h));
+    }
+
+    // the slot of name, or the empty one to put it in
+    inline const Slot* probe(const uint16_t* name, size_t length, uint32_t h) const {
+      for (size_t i = h & mask_; ; i = (i + 1) & mask_) {
+        const Slot& slot = slots_[i];
+        if (!slot.used) {
+          return &slot;
+        }
+        if (
+          slot.hash == h && slot.nameLength == length &&
+          std::equal(name, name + length, names_.begin() + slot.nameBegin)
+        ) {
+          return &slot;
+        }
+      }
+    }
+
+    void rehash(size_t capacity) {
+      std::vector<Slot> oldSlots(capacity, Slot());
+      oldSlots.swap(slots_);
+      mask_ = capacity - 1;
+      for (size_t i = 0; i < oldSlots.size(); ++i) {
+        const Slot& oldSlot = oldSlots[i];
+        if (oldSlot.used) {
+          *probe(names_.data() + oldSlot.nameBegin, oldSlot.nameLength, oldSlot.hash) = oldSlot;
+        }
+      }
+    }
+
+    std::vector<Slot> slots_;
+    usc2vector names_; // all names, one after the other
+    size_t mask_;
+    size_t count_;
+};
+
+#endif // WSON_NAME_TABLE_H_
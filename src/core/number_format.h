@@ -0,0 +1,312 @@
+#ifndef WSON_NUMBER_FORMAT_H_
+#define WSON_NUMBER_FORMAT_H_
+
+#include "types.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// The shortest digits of a double, by Grisu3 (Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers", 2010), as v8 does; it gives up on about 0.5% of the doubles.
+struct DiyFp {
+  uint64_t f;
+  int e;
+
+  inline DiyFp(uint64_t f_, int e_): f(f_), e(e_) {}
+
+  // rounded
+  inline DiyFp times(const DiyFp& other) const {
+    const uint64_t m32 = 0xffffffffu;
+    uint64_t a = f >> 32, b = f & m32, c = other.f >> 32, d = other.f & m32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & m32) + (bc & m32) + (1u << 31);
+    return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + other.e + 64);
+  }
+
+  inline DiyFp normalized() const {
+    DiyFp x = *this;
+    while (!(x.f & 0xffc0000000000000ULL)) {
+      x.f <<= 10;
+      x.e -= 10;
+    }
+    while (!(x.f & 0x8000000000000000ULL)) {
+      x.f <<= 1;
+      x.e -= 1;
+    }
+    return x;
+  }
+};
+
+// the cached 10^k with a binary exponent in [minExponent, minExponent + 28)
+inline DiyFp cachedPowerOfTen(int minExponent, int& k) {
+  struct CachedPower {
+    uint64_t f;
+    int16_t e;
+    int16_t k;
+  };
+  static const CachedPower powers[] = { // 10^-348 ... 10^340, by 10^8
+      {0xfa8fd5a0081c0288ULL, -1220, -348},
+      {0xbaaee17fa23ebf76ULL, -1193, -340},
+      {0x8b16fb203055ac76ULL, -1166, -332},
+      {0xcf42894a5dce35eaULL, -1140, -324},
+      {0x9a6bb0aa55653b2dULL, -1113, -316},
+      {0xe61acf033d1a45dfULL, -1087, -308},
+      {0xab70fe17c79ac6caULL, -1060, -300},
+      {0xff77b1fcbebcdc4fULL, -1034, -292},
+      {0xbe5691ef416bd60cULL, -1007, -284},
+      {0x8dd01fad907ffc3cULL, -980, -276},
+      {0xd3515c2831559a83ULL, -954, -268},
+      {0x9d71ac8fada6c9b5ULL, -927, -260},
+      {0xea9c227723ee8bcbULL, -901, -252},
+      {0xaecc49914078536dULL, -874, -244},
+      {0x823c12795db6ce57ULL, -847, -236},
+      {0xc21094364dfb5637ULL, -821, -228},
+      {0x9096ea6f3848984fULL, -794, -220},
+      {0xd77485cb25823ac7ULL, -768, -212},
+      {0xa086cfcd97bf97f4ULL, -741, -204},
+      {0xef340a98172aace5ULL, -715, -196},
+      {0xb23867fb2a35b28eULL, -688, -188},
+      {0x84c8d4dfd2c63f3bULL, -661, -180},
+      {0xc5dd44271ad3cdbaULL, -635, -172},
+      {0x936b9fcebb25c996ULL, -608, -164},
+      {0xdbac6c247d62a584ULL, -582, -156},
+      {0xa3ab66580d5fdaf6ULL, -555, -148},
+      {0xf3e2f893dec3f126ULL, -529, -140},
+      {0xb5b5ada8aaff80b8ULL, -502, -132},
+      {0x87625f056c7c4a8bULL, -475, -124},
+      {0xc9bcff6034c13053ULL, -449, -116},
+      {0x964e858c91ba2655ULL, -422, -108},
+      {0xdff9772470297ebdULL, -396, -100},
+      {0xa6dfbd9fb8e5b88fULL, -369, -92},
+      {0xf8a95fcf88747d94ULL, -343, -84},
+      {0xb94470938fa89bcfULL, -316, -76},
+      {0x8a08f0f8bf0f156bULL, -289, -68},
+      {0xcdb02555653131b6ULL, -263, -60},
+      {0x993fe2c6d07b7facULL, -236, -52},
+      {0xe45c10c42a2b3b06ULL, -210, -44},
+      {0xaa242499697392d3ULL, -183, -36},
+      {0xfd87b5f28300ca0eULL, -157, -28},
+      {0xbce5086492111aebULL, -130, -20},
+      {0x8cbccc096f5088ccULL, -103, -12},
+      {0xd1b71758e219652cULL, -77, -4},
+      {0x9c40000000000000ULL, -50, 4},
+      {0xe8d4a51000000000ULL, -24, 12},
+      {0xad78ebc5ac620000ULL, 3, 20},
+      {0x813f3978f8940984ULL, 30, 28},
+      {0xc097ce7bc90715b3ULL, 56, 36},
+      {0x8f7e32ce7bea5c70ULL, 83, 44},
+      {0xd5d238a4abe98068ULL, 109, 52},
+      {0x9f4f2726179a2245ULL, 136, 60},
+      {0xed63a231d4c4fb27ULL, 162, 68},
+      {0xb0de65388cc8ada8ULL, 189, 76},
+      {0x83c7088e1aab65dbULL, 216, 84},
+      {0xc45d1df942711d9aULL, 242, 92},
+      {0x924d692ca61be758ULL, 269, 100},
+      {0xda01ee641a708deaULL, 295, 108},
+      {0xa26da3999aef774aULL, 322, 116},
+      {0xf209787bb47d6b85ULL, 348, 124},
+      {0xb454e4a179dd1877ULL, 375, 132},
+      {0x865b86925b9bc5c2ULL, 402, 140},
+      {0xc83553c5c8965d3dULL, 428, 148},
+      {0x952ab45cfa97a0b3ULL, 455, 156},
+      {0xde469fbd99a05fe3ULL, 481, 164},
+      {0xa59bc234db398c25ULL, 508, 172},
+      {0xf6c69a72a3989f5cULL, 534, 180},
+      {0xb7dcbf5354e9beceULL, 561, 188},
+      {0x88fcf317f22241e2ULL, 588, 196},
+      {0xcc20ce9bd35c78a5ULL, 614, 204},
+      {0x98165af37b2153dfULL, 641, 212},
+      {0xe2a0b5dc971f303aULL, 667, 220},
+      {0xa8d9d1535ce3b396ULL, 694, 228},
+      {0xfb9b7cd9a4a7443cULL, 720, 236},
+      {0xbb764c4ca7a44410ULL, 747, 244},
+      {0x8bab8eefb6409c1aULL, 774, 252},
+      {0xd01fef10a657842cULL, 800, 260},
+      {0x9b10a4e5e9913129ULL, 827, 268},
+      {0xe7109bfba19c0c9dULL, 853, 276},
+      {0xac2820d9623bf429ULL, 880, 284},
+      {0x80444b5e7aa7cf85ULL, 907, 292},
+      {0xbf21e44003acdd2dULL, 933, 300},
+      {0x8e679c2f5e44ff8fULL, 960, 308},
+      {0xd433179d9c8cb841ULL, 986, 316},
+      {0x9e19db92b4e31ba9ULL, 1013, 324},
+      {0xeb96bf6ebadf77d9ULL, 1039, 332},
+      {0xaf87023b9bf0ee6bULL, 1066, 340},
+  };
+  int index = (348 + static_cast<int>(std::ceil((minExponent + 63) * 0.30102999566398114)) - 1) / 8 + 1;
+  k = powers[index].k;
+  return DiyFp(powers[index].f, powers[index].e);
+}
+
+// Moves the last digit towards w while that is safe; false if the digits are not known to be the closest.
+inline bool grisuRoundWeed(char* digits, int length, uint64_t distanceTooHighW, uint64_t unsafeInterval,
+    uint64_t rest, uint64_t tenKappa, uint64_t unit) {
+  uint64_t smallDistance = distanceTooHighW - unit;
+  uint64_t bigDistance = distanceTooHighW + unit;
+  while (rest < smallDistance && unsafeInterval - rest >= tenKappa &&
+      (rest + tenKappa < smallDistance || smallDistance - rest >= rest + tenKappa - smallDistance)) {
+    --digits[length - 1];
+    rest += tenKappa;
+  }
+  if (rest < bigDistance && unsafeInterval - rest >= tenKappa &&
+      (rest + tenKappa < bigDistance || bigDistance - rest > rest + tenKappa - bigDistance)) {
+    return false;
+  }
+  return 2 * unit <= rest && rest <= unsafeInterval - 4 * unit;
+}
+
+// x > 0 and finite: its shortest digits, x = 0.digits * 10^n; false if Grisu3 gives up
+inline bool grisuShortest(double x, char* digits, int& length, int& n) {
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  uint64_t significand = bits & 0x000fffffffffffffULL;
+  int biasedExponent = static_cast<int>(bits >> 52);
+  DiyFp v = biasedExponent ? DiyFp(significand | 0x0010000000000000ULL, biasedExponent - 1075) : DiyFp(significand, -1074);
+  DiyFp w = v.normalized();
+  DiyFp plus = DiyFp((v.f << 1) + 1, v.e - 1).normalized();
+  DiyFp minus = significand == 0 && biasedExponent > 1 ? DiyFp((v.f << 2) - 1, v.e - 2) : DiyFp((v.f << 1) - 1, v.e - 1);
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+
+  int k;
+  DiyFp tenK = cachedPowerOfTen(-60 - (w.e + 64), k); // scaled into 2^[-60, -32]
+  DiyFp scaled = w.times(tenK);
+  DiyFp low = minus.times(tenK);
+  DiyFp high = plus.times(tenK);
+
+  uint64_t unit = 1;
+  DiyFp tooLow(low.f - unit, low.e);
+  DiyFp tooHigh(high.f + unit, high.e);
+  uint64_t unsafeInterval = tooHigh.f - tooLow.f;
+  int shift = -scaled.e;
+  uint64_t one = 1ULL << shift;
+  uint32_t integrals = static_cast<uint32_t>(tooHigh.f >> shift);
+  uint64_t fractionals = tooHigh.f & (one - 1);
+  uint32_t divisor = 1;
+  int kappa = 1;
+  if (!integrals) {
+    divisor = 0;
+    kappa = 0;
+  }
+  while (integrals / divisor >= 10) {
+    divisor *= 10;
+    ++kappa;
+  }
+  length = 0;
+  while (kappa > 0) {
+    digits[length++] = '0' + integrals / divisor;
+    integrals %= divisor;
+    --kappa;
+    uint64_t rest = (static_cast<uint64_t>(integrals) << shift) + fractionals;
+    if (rest < unsafeInterval) {
+      n = length + kappa - k;
+      return grisuRoundWeed(digits, length, tooHigh.f - scaled.f, unsafeInterval, rest,
+        static_cast<uint64_t>(divisor) << shift, unit);
+    }
+    divisor /= 10;
+  }
+  while (true) {
+    fractionals *= 10;
+    unit *= 10;
+    unsafeInterval *= 10;
+    digits[length++] = '0' + static_cast<int>(fractionals >> shift);
+    fractionals &= one - 1;
+    --kappa;
+    if (fractionals < unsafeInterval) {
+      n = length + kappa - k;
+      return grisuRoundWeed(digits, length, (tooHigh.f - scaled.f) * unit, unsafeInterval, fractionals, one, unit);
+    }
+  }
+}
+
+// Writes x as Number.prototype.toString() does: the fewest digits that read back the same,
+// in fixed notation from 1e-6 up to 1e21. buf needs room for 32 chars; returns the length.
+inline size_t formatNumber(double x, char* buf) {
+  char* t = buf;
+  if (std::isnan(x)) {
+    memcpy(buf, "NaN", 3);
+    return 3;
+  }
+  if (x < 0) {
+    *t++ = '-';
+    x = -x;
+  }
+  if (std::isinf(x)) {
+    memcpy(t, "Infinity", 8);
+    return t - buf + 8;
+  }
+  if (x == 0) {
+    buf[0] = '0'; // -0 as well
+    return 1;
+  }
+  if (x < 9007199254740992.0 && x == std::floor(x)) { // exact integers
+    char digits[20];
+    char* d = digits + sizeof(digits);
+    for (uint64_t n = static_cast<uint64_t>(x); n; n /= 10) {
+      *--d = '0' + n % 10;
+    }
+    size_t length = digits + sizeof(digits) - d;
+    memcpy(t, d, length);
+    return t - buf + length;
+  }
+
+  char digits[20];
+  int k; // #digits
+  int n; // x = 0.digits * 10^n
+  if (!grisuShortest(x, digits, k, n)) {
+    // d.ddde[+-]x with as few digits as round trip (a shorter repr rounds to itself padded with zeros,
+    // but for subnormals, with less precision)
+    char scratch[32];
+    for (int precision = x < 2.2250738585072014e-308 ? 1 : 15; precision <= 17; ++precision) {
+      snprintf(scratch, sizeof(scratch), "%.*e", precision - 1, x);
+      if (strtod(scratch, NULL) == x) {
+        break;
+      }
+    }
+    k = 0;
+    const char* s = scratch;
+    for (; *s != 'e'; ++s) {
+      if (*s != '.') {
+        digits[k++] = *s;
+      }
+    }
+    while (k > 1 && digits[k - 1] == '0') {
+      --k;
+    }
+    n = atoi(s + 1) + 1;
+  }
+
+  if (k <= n && n <= 21) {
+    memcpy(t, digits, k);
+    t += k;
+    for (int i = k; i < n; ++i) {
+      *t++ = '0';
+    }
+  } else if (0 < n && n <= 21) {
+    memcpy(t, digits, n);
+    t += n;
+    *t++ = '.';
+    memcpy(t, digits + n, k - n);
+    t += k - n;
+  } else if (-6 < n && n <= 0) {
+    *t++ = '0';
+    *t++ = '.';
+    for (int i = n; i < 0; ++i) {
+      *t++ = '0';
+    }
+    memcpy(t, digits, k);
+    t += k;
+  } else {
+    *t++ = digits[0];
+    if (k > 1) {
+      *t++ = '.';
+      memcpy(t, digits + 1, k - 1);
+      t += k - 1;
+    }
+    t += snprintf(t, 8, "e%+d", n - 1);
+  }
+  return t - buf;
+}
+
+#endif // WSON_NUMBER_FORMAT_H_
@@ -0,0 +1,420 @@
+#include "parser_tape.h"
+
+inline static size_t getPos(const SourceBuffer& source) {
+  return source.nextType == END ? source.endIdx : source.nextIdx - 1;
+}
+
+size_t ParserTape::pushNode(TapeKind kind, size_t begin) {
+  if (!recording_) {
+    return 0;
+  }
+  size_t idx = nodes.size();
+  nodes.resize(idx + 1);
+  TapeNode& node = nodes[idx];
+  node.kind = kind;
+  node.begin = begin;
+  node.size = 0;
+  node.escapes = false;
+  return idx;
+}
+
+void ParserTape::closeNode(size_t idx) {
+  TapeNode& node = nodes[idx];
+  node.end = getPos(*source_);
+  node.next = nodes.size();
+}
+
+void ParserTape::pushText() {
+  size_t idx = pushNode(TK_TEXT, source_->nextIdx - 1);
+  if (source_->skipUnescaped()) {
+    makeError();
+  }
+  closeNode(idx);
+}
+
+void ParserTape::pushLiteral(size_t begin) {
+  SourceBuffer& source = *source_;
+  size_t idx = pushNode(TK_LITERAL, begin);
+  if (source.nextType == TEXT) {
+    bool litErr = false;
+    size_t litBeginIdx = source.nextIdx - 1;
+    double x;
+    switch (source.nextChar) {
+      case 'u':
+      case 'n':
+      case 'f':
+      case 't':
+        source.next();
+        break;
+      case 'd':
+        if (source.pullUnescapedString()) {
+          makeError();
+          break;
+        }
+        if (!SourceBuffer::scanDate(source.nextString, x)) {
+          litErr = true;
+        }
+        break;
+      default: {
+        if (source.pullUnescapedString()) {
+          makeError();
+          break;
+        }
+        if (!SourceBuffer::scanNumber(source.nextString, x)) {
+          litErr = true;
+        }
+      }
+    }
+    if (litErr) {
+      TargetBuffer& msg = errorMsg_;
+      msg.clear();
+      msg.appendAscii("unexpected literal '");
+      msg.append(source.nextString);
+      msg.appendAscii("'");
+      makeError(litBeginIdx, &msg);
+    }
+  }
+  closeNode(idx);
+}
+
+void ParserTape::pushBackref(TapeFrame* frame, size_t begin) {
+  SourceBuffer& source = *source_;
+  size_t idx = pushNode(TK_BACKREF, begin);
+  nodes[idx].escapes = true;
+  bool refErr = false;
+  size_t refBeginIdx = source.nextIdx;
+  Ctype nextType = source.nextType;
+  if (nextType != TEXT) {
+    refErr = true;
+  } else {
+    if (source.pullUnescapedString()) {
+      makeError();
+    } else {
+      int64_t refIdx;
+      if (!SourceBuffer::scanInteger(source.nextString, refIdx) || refIdx < 0) {
+        refErr = true;
+      } else {
+        if (frame) {
+          --refIdx;
+        }
+        TapeFrame *idxFrame = frame;
+        while (refIdx >= 0) {
+          TapeFrame* parentIdxFrame = frame ? idxFrame->parent : NULL;
+          if (parentIdxFrame) {
+            idxFrame = parentIdxFrame;
+          } else if (externalRefs_ < 0 || refIdx < externalRefs_) {
+            idxFrame = NULL;
+            break;
+          } else {
+            refErr = true;
+            break;
+          }
+          --refIdx;
+        }
+        if (!refErr) {
+          if (idxFrame && idxFrame->vetoBackref) {
+            refErr = true;
+          } else {
+            for (TapeFrame* f = frame; f != idxFrame; f = f->parent) {
+              nodes[f->nodeIdx].escapes = true;
+            }
+          }
+        }
+      }
+    }
+  }
+  if (refErr) {
+    TargetBuffer& msg = errorMsg_;
+    msg.clear();
+    msg.appendAscii("unexpected backref '");
+    if (nextType != END) {
+      --refBeginIdx;
+    }
+    if (nextType == TEXT) {
+      msg.append(source.nextString);
+    } else {
+      msg.push(source.nextChar);
+    }
+    msg.appendAscii("'");
+    makeError(refBeginIdx, &msg);
+  }
+  closeNode(idx);
+}
+
+void ParserTape::pushValue(TapeFrame* frame) {
+  SourceBuffer& source = *source_;
+  size_t begin = source.nextIdx - 1;
+  switch (source.nextType) {
+    case TEXT:
+    case QUOTE:
+      pushText();
+      break;
+    case LITERAL:
+      source.next();
+      pushLiteral(begin);
+      break;
+    case ARRAY:
+    case OBJECT:
+      if (depth_ == MAX_NESTING) {
+        TargetBuffer& msg = errorMsg_;
+        msg.clear();
+        msg.appendAscii("nested too deeply");
+        makeError(begin, &msg);
+        break;
+      }
+      ++depth_;
+      if (source.nextType == ARRAY) {
+        source.next();
+        pushArray(frame, begin);
+      } else {
+        source.next();
+        pushObject(frame, begin);
+      }
+      --depth_; // a custom value is an array too
+      break;
+    case PIPE:
+      source.next();
+      pushBackref(frame, begin);
+      break;
+    default:
+      makeError();
+  }
+}
+
+void ParserTape::pushArray(TapeFrame* parentFrame, size_t begin) {
+  SourceBuffer& source = *source_;
+  size_t idx = pushNode(TK_ARRAY, begin);
+  if (source.nextType == IS) {
+    source.next();
+    nodes[idx].kind = TK_CUSTOM;
+    pushCustom(idx, parentFrame);
+    return;
+  }
+
+  TapeFrame frame(idx, parentFrame);
+  switch (source.nextType) {
+    case ENDARRAY:
+      source.next();
+      break;
+    default:
+      goto stageNext;
+  }
+  goto end;
+
+stageNext:
+  switch (source.nextType) {
+    case TEXT:
+    case QUOTE:
+    case LITERAL:
+    case ARRAY:
+    case OBJECT:
+    case PIPE:
+      ++nodes[idx].size;
+      pushValue(&frame);
+      if (hasError) goto end;
+      goto stageHave;
+    default:
+      makeError();
+  }
+  goto end;
+
+stageHave:
+  switch (source.nextType) {
+    case ENDARRAY:
+      source.next();
+      break;
+    case PIPE:
+      source.next();
+      goto stageNext;
+    default:
+      makeError();
+  }
+  goto end;
+
+end:
+  closeNode(idx);
+}
+
+void ParserTape::pushObject(TapeFrame* parentFrame, size_t begin) {
+  SourceBuffer& source = *source_;
+  size_t idx = pushNode(TK_OBJECT, begin);
+  size_t keyIdx = 0;
+  TapeFrame frame(idx, parentFrame);
+
+  switch (source.nextType) {
+    case ENDOBJECT:
+      source.next();
+      break;
+    default:
+      goto stageNext;
+  }
+  goto end;
+
+stageNext:
+  ++nodes[idx].size;
+  switch (source.nextType) {
+    case TEXT:
+    case QUOTE:
+      keyIdx = pushNode(TK_KEY, source.nextIdx - 1);
+      if (source.skipUnescaped()) {
+        makeError();
+        closeNode(keyIdx);
+        goto end;
+      }
+      closeNode(keyIdx);
+      goto stageHaveKey;
+    case LITERAL:
+      source.next();
+      keyIdx = pushNode(TK_KEY, getPos(source));
+      closeNode(keyIdx);
+      goto stageHaveKey;
+    default:
+      makeError();
+  }
+  goto end;
+
+stageHaveKey:
+  switch (source.nextType) {
+    case ENDOBJECT:
+      source.next();
+      break;
+    case PIPE:
+      source.next();
+      goto stageNext;
+    case IS:
+      source.next();
+      goto stageHaveColon;
+    default:
+      makeError();
+  }
+  goto end;
+
+stageHaveColon:
+  switch (source.nextType) {
+    case TEXT:
+    case QUOTE:
+    case LITERAL:
+    case ARRAY:
+    case OBJECT:
+    case PIPE:
+      nodes[keyIdx].size = 1;
+      pushValue(&frame);
+      if (hasError) goto end;
+      goto stageHaveValue;
+    default:
+      makeError();
+  }
+  goto end;
+
+stageHaveValue:
+  switch (source.nextType) {
+    case ENDOBJECT:
+      source.next();
+      break;
+    case PIPE:
+      source.next();
+      goto stageNext;
+    default:
+      makeError();
+  }
+  goto end;
+
+end:
+  closeNode(idx);
+}
+
+void ParserTape::pushCustom(size_t idx, TapeFrame* parentFrame) {
+  SourceBuffer& source = *source_;
+  TapeFrame frame(idx, parentFrame);
+  bool hasCreate = false;
+  size_t nameIdx = source.nextIdx - 1;
+  size_t nameEnd;
+  switch (source.nextType) {
+    case TEXT:
+    case QUOTE:
+      if (source.skipUnescaped()) {
+        makeError();
+        break;
+      }
+      nameEnd = getPos(source);
+      if (connectors_ && !connectors_->findConnector(source.getBuffer().data() + nameIdx, nameEnd - nameIdx, hasCreate)) {
+        TargetBuffer& msg = errorMsg_;
+        msg.clear();
+        msg.appendAscii("no connector for '");
+        msg.appendUnescaped(source.getBuffer(), nameIdx, nameEnd - nameIdx);
+        msg.appendAscii("'");
+        makeError(nameIdx, &msg);
+        break;
+      }
+      frame.vetoBackref = hasCreate;
+      goto stageHave;
+    default:
+      makeError();
+  }
+  goto end;
+
+stageNext:
+  switch (source.nextType) {
+    case TEXT:
+    case QUOTE:
+    case LITERAL:
+    case ARRAY:
+    case OBJECT:
+    case PIPE:
+      ++nodes[idx].size;
+      pushValue(&frame);
+      if (hasError) goto end;
+      goto stageHave;
+    default:
+      makeError();
+  }
+  goto end;
+
+stageHave:
+  switch (source.nextType) {
+    case ENDARRAY:
+      source.next();
+      break;
+    case PIPE:
+      source.next();
+      goto stageNext;
+    default:
+      makeError();
+  }
+  goto end;
+
+end:
+  closeNode(idx);
+}
+
+void ParserTape::build(SourceBuffer& source, int64_t externalRefs, bool recording) {
+  source_ = &source;
+  externalRefs_ = externalRefs;
+  recording_ = recording;
+  depth_ = 0;
+  hasError = false;
+  nodes.clear();
+  if (!recording_) {
+    nodes.resize(1);
+  }
+  pushValue(NULL);
+  if (!hasError && source.nextType != END) {
+    makeError(); // extra chars after end
+  }
+  source_ = NULL;
+}
+
+void ParserTape::makeError(int pos, const BaseBuffer* cause) {
+  if (hasError) {
+    return;
+  }
+  if (pos < 0) {
+    pos = getPos(*source_);
+  }
+  errorPos = pos;
+  errorCause.clear();
+  if (cause) {
+    errorCause.append(cause->getBuffer());
+  }
+  hasError = true;
+}
@@ -0,0 +1,97 @@
+#ifndef WSON_PARSER_TAPE_H_
+#define WSON_PARSER_TAPE_H_
+
+#include "source_buffer.h"
+
+// What the tape needs to know of the connectors of a parser.
+class ConnectorIndex {
+  public:
+    virtual ~ConnectorIndex() {}
+
+    // false if there is no connector of that name (as escaped in the source)
+    virtual bool findConnector(const uint16_t* name, size_t length, bool& hasCreate) const = 0;
+};
+
+enum TapeKind {
+  TK_TEXT,
+  TK_LITERAL,
+  TK_BACKREF,
+  TK_ARRAY,
+  TK_OBJECT,
+  TK_CUSTOM,
+  TK_KEY,
+};
+
+struct TapeNode {
+  uint32_t begin;   // source index of the first char
+  uint32_t end;     // source index behind the last char
+  uint32_t next;    // tape index behind the subtree
+  uint32_t size;    // #items (ARRAY, CUSTOM), #entries (OBJECT), has a value (KEY)
+  uint8_t kind;
+  bool escapes;     // subtree holds a backref to something outside
+};
+
+struct TapeFrame {
+  size_t nodeIdx;
+  TapeFrame *parent;
+  bool vetoBackref;
+
+  inline TapeFrame(size_t idx, TapeFrame *p):
+    nodeIdx(idx),
+    parent(p),
+    vetoBackref(false)
+  {}
+};
+
+// One pass over a SourceBuffer that checks the full grammar (as ParserSource would)
+// and records a flat tape of the values, without creating any v8 values.
+// Without connectors, custom values of any name are accepted (as if they had no create).
+// Values nested deeper than MAX_NESTING are an error.
+class ParserTape {
+  public:
+    explicit ParserTape(const ConnectorIndex* connectors=NULL): connectors_(connectors), source_(NULL) {}
+
+    // externalRefs: #backrefs accepted beyond the top level, -1 for any.
+    // Without recording, all nodes are folded into a single scratch node.
+    void build(SourceBuffer& source, int64_t externalRefs, bool recording=true);
+
+    inline size_t skipNode(size_t idx) const {
+      return nodes[idx].next;
+    }
+
+    inline size_t memorySize() const {
+      return vectorMemory(nodes) + errorCause.memorySize() + errorMsg_.memorySize();
+    }
+
+    inline void trim(size_t maxSize) {
+      trimVector(nodes, maxSize);
+      errorCause.trim(maxSize);
+      errorMsg_.trim(maxSize);
+    }
+
+    std::vector<TapeNode> nodes;
+    bool hasError;
+    size_t errorPos;
+    TargetBuffer errorCause;
+
+  private:
+    TargetBuffer errorMsg_; // scratch
+    const ConnectorIndex* connectors_;
+    SourceBuffer* source_;
+    int64_t externalRefs_;
+    bool recording_;
+    size_t depth_;
+
+    inline size_t pushNode(TapeKind kind, size_t begin);
+    inline void closeNode(size_t idx);
+    void pushValue(TapeFrame* frame);
+    inline void pushText();
+    inline void pushLiteral(size_t begin);
+    inline void pushBackref(TapeFrame* frame, size_t begin);
+    void pushArray(TapeFrame* parentFrame, size_t begin);
+    void pushObject(TapeFrame* parentFrame, size_t begin);
+    void pushCustom(size_t idx, TapeFrame* parentFrame);
+    void makeError(int pos = -1, const BaseBuffer* cause=NULL);
+};
+
+#endif // WSON_PARSER_TAPE_H_
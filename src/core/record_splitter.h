@@ -0,0 +1,165 @@
+#ifndef WSON_RECORD_SPLITTER_H_
+#define WSON_RECORD_SPLITTER_H_
+
+#include "structural_index.h"
+
+// Finds the top-level values in a sequence of WSON texts, concatenated or one per line,
+// without parsing them. Escapes never produce brackets or newlines, so counting brackets is enough:
+// a value starting with '{' or '[' ends at its closing bracket, any other value at the end of its line.
+// Newlines (and "\r\n") between values are skipped. Works on UTF-16 chars as well as on UTF-8 bytes.
+
+inline bool isSplitChar(uint16_t c) {
+  switch (c) {
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case '\n':
+      return true;
+  }
+  return false;
+}
+
+// the first bracket or newline at or behind pos (or len)
+inline size_t nextSplitChar(const uint16_t* data, size_t pos, size_t len) {
+#if defined(WSON_INDEX_SSE2)
+  const __m128i cOpenObject = _mm_set1_epi16('{');
+  const __m128i cCloseObject = _mm_set1_epi16('}');
+  const __m128i cOpenArray = _mm_set1_epi16('[');
+  const __m128i cCloseArray = _mm_set1_epi16(']');
+  const __m128i cNewline = _mm_set1_epi16('\n');
+  for (; pos + 8 <= len; pos += 8) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    __m128i hits = _mm_or_si128(
+      _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi16(chunk, cOpenObject), _mm_cmpeq_epi16(chunk, cCloseObject)),
+        _mm_or_si128(_mm_cmpeq_epi16(chunk, cOpenArray), _mm_cmpeq_epi16(chunk, cCloseArray))
+      ),
+      _mm_cmpeq_epi16(chunk, cNewline)
+    );
+    unsigned mask = _mm_movemask_epi8(hits);
+    if (mask) {
+      return pos + (countTrailingZeros(mask) >> 1);
+    }
+  }
+#elif defined(WSON_INDEX_NEON)
+  const uint16x8_t cOpenObject = vdupq_n_u16('{');
+  const uint16x8_t cCloseObject = vdupq_n_u16('}');
+  const uint16x8_t cOpenArray = vdupq_n_u16('[');
+  const uint16x8_t cCloseArray = vdupq_n_u16(']');
+  const uint16x8_t cNewline = vdupq_n_u16('\n');
+  for (; pos + 8 <= len; pos += 8) {
+    uint16x8_t chunk = vld1q_u16(data + pos);
+    uint16x8_t hits = vorrq_u16(
+      vorrq_u16(
+        vorrq_u16(vceqq_u16(chunk, cOpenObject), vceqq_u16(chunk, cCloseObject)),
+        vorrq_u16(vceqq_u16(chunk, cOpenArray), vceqq_u16(chunk, cCloseArray))
+      ),
+      vceqq_u16(chunk, cNewline)
+    );
+    if (vmaxvq_u16(hits)) {
+      break;
+    }
+  }
+#endif
+  for (; pos < len && !isSplitChar(data[pos]); ++pos) {}
+  return pos;
+}
+
+inline size_t nextSplitChar(const uint8_t* data, size_t pos, size_t len) {
+#if defined(WSON_INDEX_SSE2)
+  const __m128i cOpenObject = _mm_set1_epi8('{');
+  const __m128i cCloseObject = _mm_set1_epi8('}');
+  const __m128i cOpenArray = _mm_set1_epi8('[');
+  const __m128i cCloseArray = _mm_set1_epi8(']');
+  const __m128i cNewline = _mm_set1_epi8('\n');
+  for (; pos + 16 <= len; pos += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    __m128i hits = _mm_or_si128(
+      _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, cOpenObject), _mm_cmpeq_epi8(chunk, cCloseObject)),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, cOpenArray), _mm_cmpeq_epi8(chunk, cCloseArray))
+      ),
+      _mm_cmpeq_epi8(chunk, cNewline)
+    );
+    unsigned mask = _mm_movemask_epi8(hits);
+    if (mask) {
+      return pos + countTrailingZeros(mask);
+    }
+  }
+#elif defined(WSON_INDEX_NEON)
+  const uint8x16_t cOpenObject = vdupq_n_u8('{');
+  const uint8x16_t cCloseObject = vdupq_n_u8('}');
+  const uint8x16_t cOpenArray = vdupq_n_u8('[');
+  const uint8x16_t cCloseArray = vdupq_n_u8(']');
+  const uint8x16_t cNewline = vdupq_n_u8('\n');
+  for (; pos + 16 <= len; pos += 16) {
+    uint8x16_t chunk = vld1q_u8(data + pos);
+    uint8x16_t hits = vorrq_u8(
+      vorrq_u8(
+        vorrq_u8(vceqq_u8(chunk, cOpenObject), vceqq_u8(chunk, cCloseObject)),
+        vorrq_u8(vceqq_u8(chunk, cOpenArray), vceqq_u8(chunk, cCloseArray))
+      ),
+      vceqq_u8(chunk, cNewline)
+    );
+    if (vmaxvq_u8(hits)) {
+      break;
+    }
+  }
+#endif
+  for (; pos < len && !isSplitChar(data[pos]); ++pos) {}
+  return pos;
+}
+
+// Appends the bounds of the values in data[pos, len) to starts and ends, at most maxCount of them (0: no limit).
+// more: data goes on behind len, so a value running up to len is left for the next call.
+// Returns the position to go on from: behind the last value found and the newlines following it.
+template<typename C>
+size_t splitRecords(const C* data, size_t pos, size_t len, bool more, size_t maxCount, indexVector& starts, indexVector& ends) {
+  size_t count = 0;
+  while (true) {
+    while (pos < len && (data[pos] == '\n' || data[pos] == '\r')) {
+      ++pos;
+    }
+    if (pos == len || (maxCount && count == maxCount)) {
+      return pos;
+    }
+    size_t begin = pos;
+    size_t end;
+    if (data[pos] == '{' || data[pos] == '[') {
+      int depth = 0;
+      while (true) {
+        pos = nextSplitChar(data, pos, len);
+        if (pos == len) {
+          break;
+        }
+        C c = data[pos++];
+        if (c == '{' || c == '[') {
+          ++depth;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+          break;
+        }
+      }
+      if (depth > 0 && more) {
+        return begin;
+      }
+      end = pos;
+    } else {
+      do {
+        pos = nextSplitChar(data, pos, len);
+      } while (pos < len && data[pos++] != '\n');
+      if (pos == len && more && data[pos - 1] != '\n') {
+        return begin;
+      }
+      end = data[pos - 1] == '\n' ? pos - 1 : pos;
+      if (end > begin && data[end - 1] == '\r') {
+        --end;
+      }
+    }
+    starts.push_back(begin);
+    ends.push_back(end);
+    ++count;
+  }
+}
+
+#endif // WSON_RECORD_SPLITTER_H_
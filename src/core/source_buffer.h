@@ -0,0 +1,362 @@
+#ifndef WSON_SOURCE_BUFFER_H_
+#define WSON_SOURCE_BUFFER_H_
+
+#include "base_buffer.h"
+#include "target_buffer.h"
+#include "structural_index.h"
+#include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+
+class SourceBuffer: public BaseBuffer {
+
+  public:
+
+    static inline Ctype getCtype(uint16_t c) {
+      switch (c) {
+        case '{':
+          return OBJECT;
+        case '}':
+          return ENDOBJECT;
+        case '[':
+          return ARRAY;
+        case ']':
+          return ENDARRAY;
+        case ':':
+          return IS;
+        case '#':
+          return LITERAL;
+        case '|':
+          return PIPE;
+        case '`':
+          return QUOTE;
+      }
+      return TEXT;
+    }
+
+    enum {
+      INDEX_MIN_SIZE = 256, // smaller sources are scanned char by char only
+      MAX_SIZE = 0x7fffffff // positions fit an int and the uint32_t structure index
+    };
+
+    SourceBuffer():
+      nextIdx(0),
+      endIdx(0),
+      indexed_(false),
+      structureIdx_(0)
+    {}
+
+    // the first structural char or escape at or behind pos (or endIdx)
+    inline size_t nextStructural(size_t pos) {
+      const uint32_t* structureData = structure_.data();
+      size_t structureSize = structure_.size();
+      while (structureIdx_ < structureSize && structureData[structureIdx_] < pos) {
+        ++structureIdx_;
+      }
+      return structureIdx_ < structureSize ? structureData[structureIdx_] : endIdx;
+    }
+
+    inline void next() {
+      if (nextIdx >= endIdx) {
+        nextType = END;
+      } else {
+        nextChar = buffer_[nextIdx++];
+        nextType = SourceBuffer::getCtype(nextChar);
+      }
+    }
+
+    inline void skip(size_t n) {
+      if (n > 0) {
+        nextIdx = nextIdx - 1 + n;
+        next();
+      }
+    }
+
+    inline int pullUnescaped(TargetBuffer& target) {
+      if (indexed_) {
+        // copy whole runs up to the next structural char
+        size_t pos = nextIdx - 1;
+        while (true) {
+          size_t stop = nextStructural(pos);
+          target.append(buffer_, pos, stop - pos);
+          if (stop == endIdx || buffer_[stop] != '`') {
+            nextIdx = stop;
+            next();
+            return 0;
+          }
+          nextIdx = stop + 2;
+          if (stop + 1 == endIdx) {
+            nextType = QUOTE;
+            return SYNTAX_ERROR;
+          }
+          nextChar = getUnescapeChar(buffer_[stop + 1]);
+          if (!nextChar) {
+            nextType = QUOTE;
+            return SYNTAX_ERROR;
+          }
+          target.push(nextChar);
+          pos = stop + 2;
+        }
+      }
+      size_t len = endIdx;
+      while (true) {
+        if (nextType == QUOTE) {
+          if (nextIdx == len) {
+            ++nextIdx;
+            return SYNTAX_ERROR;
+          }
+          nextChar = getUnescapeChar(buffer_[nextIdx++]);
+          if (!nextChar) {
+            return SYNTAX_ERROR;
+          }
+        }
+        target.push(nextChar);
+        next();
+        if (nextType != TEXT && nextType != QUOTE) {
+          break;
+        }
+      }
+      return 0;
+    }
+
+    inline int pullUnescaped(std::string& target) {
+      size_t len = endIdx;
+      while (true) {
+        if (nextType == QUOTE) {
+          if (nextIdx == len) {
+            return SYNTAX_ERROR;
+          }
+          nextChar = getUnescapeChar(buffer_[nextIdx++]);
+          if (!nextChar) {
+            return SYNTAX_ERROR;
+          }
+        }
+        target.push_back(nextChar);
+        next();
+        if (nextType != TEXT && nextType != QUOTE) {
+          break;
+        }
+      }
+      return 0;
+    }
+
+    inline int skipUnescaped() {
+      // like pullUnescaped(TargetBuffer&), but just validates
+      if (indexed_) {
+        size_t pos = nextIdx - 1;
+        while (true) {
+          size_t stop = nextStructural(pos);
+          if (stop == endIdx || buffer_[stop] != '`') {
+            nextIdx = stop;
+            next();
+            return 0;
+          }
+          nextIdx = stop + 2;
+          if (stop + 1 == endIdx || !(nextChar = getUnescapeChar(buffer_[stop + 1]))) {
+            nextType = QUOTE;
+            return SYNTAX_ERROR;
+          }
+          pos = stop + 2;
+        }
+      }
+      size_t len = endIdx;
+      while (true) {
+        if (nextType == QUOTE) {
+          if (nextIdx == len) {
+            ++nextIdx;
+            return SYNTAX_ERROR;
+          }
+          nextChar = getUnescapeChar(buffer_[nextIdx++]);
+          if (!nextChar) {
+            return SYNTAX_ERROR;
+          }
+        }
+        next();
+        if (nextType != TEXT && nextType != QUOTE) {
+          break;
+        }
+      }
+      return 0;
+    }
+
+    // Skips a value without checking its grammar, just minding escapes and brackets.
+    inline int skipValue() {
+      switch (nextType) {
+        case TEXT:
+        case QUOTE:
+          break;
+        case LITERAL:
+          next();
+          if (nextType != TEXT && nextType != QUOTE) {
+            return 0;
+          }
+          break;
+        case PIPE:
+          next();
+          if (nextType != TEXT) {
+            return SYNTAX_ERROR;
+          }
+          break;
+        case ARRAY:
+        case OBJECT:
+          return skipNested();
+        default:
+          return SYNTAX_ERROR;
+      }
+      return skipUnescaped();
+    }
+
+    inline int skipNested() {
+      size_t idx = nextIdx;
+      size_t depth = 1;
+      while (idx < endIdx) {
+        if (indexed_) {
+          // jump to the next structural char
+          idx = nextStructural(idx);
+          if (idx == endIdx) {
+            break;
+          }
+        }
+        switch (buffer_[idx++]) {
+          case '[':
+          case '{':
+            ++depth;
+            break;
+          case ']':
+          case '}':
+            if (--depth == 0) {
+              nextIdx = idx;
+              next();
+              return 0;
+            }
+            break;
+          case '`':
+            if (idx == endIdx) {
+              ++idx;
+            }
+            if (idx > endIdx || !getUnescapeChar(buffer_[idx++])) {
+              nextIdx = idx;
+              nextType = QUOTE;
+              return SYNTAX_ERROR;
+            }
+        }
+      }
+      nextIdx = idx;
+      next();
+      return SYNTAX_ERROR;
+    }
+
+    inline int pullUnescapedBuffer() {
+      nextBuffer.clear();
+      return pullUnescaped(nextBuffer);
+    }
+
+    inline int pullUnescapedString() {
+      nextString.clear();
+      return pullUnescaped(nextString);
+    }
+
+    static inline bool scanNumber(const std::string& s, double& value) {
+      const char* begin = s.data();
+      char* end;
+      long x = strtol(begin, &end, 10);
+      if (end == begin + s.size() && x >= INT32_MIN && x <= INT32_MAX) {
+        value = x;
+        return true;
+      } else {
+        double x = strtod(begin, &end);
+        if (end == begin + s.size()) {
+          value = x;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    static inline bool scanDate(const std::string& s, double& value) {
+      const char* begin = s.data();
+      char* end;
+      double x = strtod(begin + 1, &end);
+      if (end == begin + s.size()) {
+        value = x;
+        return true;
+      }
+      return false;
+    }
+
+    static inline bool scanInteger(const std::string& s, int64_t& value) {
+      const char* begin = s.data();
+      char* end;
+      errno = 0;
+      long long x = strtoll(begin, &end, 10);
+      if (end == begin + s.size() && errno != ERANGE) {
+        value = x;
+        return true;
+      }
+      return false;
+    }
+
+    void clear() {
+      BaseBuffer::clear();
+      nextIdx = 0;
+      endIdx = 0;
+      indexed_ = false;
+    }
+
+    void init(const uint16_t* s, size_t length) {
+      clear();
+      std::copy(s, s + length, extend(length));
+      init();
+    }
+
+    // Starts on the chars appended since clear().
+    void init() {
+      endIdx = buffer_.size();
+      if (endIdx >= INDEX_MIN_SIZE) {
+        indexStructure(buffer_.data(), endIdx, structure_);
+        structureIdx_ = 0;
+        indexed_ = true;
+      }
+      next();
+    }
+
+    inline size_t memorySize() const {
+      return BaseBuffer::memorySize() + vectorMemory(structure_) + nextBuffer.memorySize() + vectorMemory(nextString);
+    }
+
+    inline void trim(size_t maxSize) {
+      BaseBuffer::trim(maxSize);
+      trimVector(structure_, maxSize);
+      nextBuffer.trim(maxSize);
+      trimVector(nextString, maxSize);
+    }
+
+    // Borrow the (already validated) text, restricted to [begin, end).
+    // The text has to be given back by detach().
+    void attach(usc2vector& text, size_t begin, size_t end) {
+      clear();
+      buffer_.swap(text);
+      nextIdx = begin;
+      endIdx = end;
+      next();
+    }
+
+    void detach(usc2vector& text) {
+      buffer_.swap(text);
+      clear();
+    }
+
+    size_t nextIdx;
+    size_t endIdx;
+    uint16_t nextChar;
+    Ctype nextType;
+    TargetBuffer nextBuffer;
+    std::string nextString;
+
+  private:
+    bool indexed_;
+    indexVector structure_;
+    size_t structureIdx_;
+};
+
+#endif // WSON_SOURCE_BUFFER_H_
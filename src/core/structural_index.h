@@ -0,0 +1,116 @@
+#ifndef WSON_STRUCTURAL_INDEX_H_
+#define WSON_STRUCTURAL_INDEX_H_
+
+#include <stdint.h>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WSON_INDEX_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define WSON_INDEX_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef std::vector<uint32_t> indexVector;
+
+// Stage 1 of parsing large sources: the positions of all structural chars and escapes.
+
+inline bool isStructural(uint16_t c) {
+  switch (c) {
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case ':':
+    case '#':
+    case '|':
+    case '`':
+      return true;
+  }
+  return false;
+}
+
+inline void indexStructureScalar(const uint16_t* data, size_t begin, size_t end, indexVector& index) {
+  for (size_t i=begin; i<end; ++i) {
+    if (isStructural(data[i])) {
+      index.push_back(i);
+    }
+  }
+}
+
+#ifdef WSON_INDEX_SSE2
+inline unsigned countTrailingZeros(unsigned x) {
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanForward(&idx, x);
+  return idx;
+#else
+  return __builtin_ctz(x);
+#endif
+}
+#endif
+
+inline void indexStructure(const uint16_t* data, size_t len, indexVector& index) {
+  index.clear();
+  size_t i = 0;
+#if defined(WSON_INDEX_SSE2)
+  const __m128i cOpenObject = _mm_set1_epi16('{');
+  const __m128i cCloseObject = _mm_set1_epi16('}');
+  const __m128i cOpenArray = _mm_set1_epi16('[');
+  const __m128i cCloseArray = _mm_set1_epi16(']');
+  const __m128i cIs = _mm_set1_epi16(':');
+  const __m128i cLiteral = _mm_set1_epi16('#');
+  const __m128i cPipe = _mm_set1_epi16('|');
+  const __m128i cQuote = _mm_set1_epi16('`');
+  for (; i + 8 <= len; i += 8) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i hits = _mm_or_si128(
+      _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi16(chunk, cOpenObject), _mm_cmpeq_epi16(chunk, cCloseObject)),
+        _mm_or_si128(_mm_cmpeq_epi16(chunk, cOpenArray), _mm_cmpeq_epi16(chunk, cCloseArray))
+      ),
+      _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi16(chunk, cIs), _mm_cmpeq_epi16(chunk, cLiteral)),
+        _mm_or_si128(_mm_cmpeq_epi16(chunk, cPipe), _mm_cmpeq_epi16(chunk, cQuote))
+      )
+    );
+    unsigned mask = _mm_movemask_epi8(hits) & 0x5555; // one bit per 16-bit lane
+    while (mask) {
+      index.push_back(i + (countTrailingZeros(mask) >> 1));
+      mask &= mask - 1;
+    }
+  }
+#elif defined(WSON_INDEX_NEON)
+  const uint16x8_t cOpenObject = vdupq_n_u16('{');
+  const uint16x8_t cCloseObject = vdupq_n_u16('}');
+  const uint16x8_t cOpenArray = vdupq_n_u16('[');
+  const uint16x8_t cCloseArray = vdupq_n_u16(']');
+  const uint16x8_t cIs = vdupq_n_u16(':');
+  const uint16x8_t cLiteral = vdupq_n_u16('#');
+  const uint16x8_t cPipe = vdupq_n_u16('|');
+  const uint16x8_t cQuote = vdupq_n_u16('`');
+  for (; i + 8 <= len; i += 8) {
+    uint16x8_t chunk = vld1q_u16(data + i);
+    uint16x8_t hits = vorrq_u16(
+      vorrq_u16(
+        vorrq_u16(vceqq_u16(chunk, cOpenObject), vceqq_u16(chunk, cCloseObject)),
+        vorrq_u16(vceqq_u16(chunk, cOpenArray), vceqq_u16(chunk, cCloseArray))
+      ),
+      vorrq_u16(
+        vorrq_u16(vceqq_u16(chunk, cIs), vceqq_u16(chunk, cLiteral)),
+        vorrq_u16(vceqq_u16(chunk, cPipe), vceqq_u16(chunk, cQuote))
+      )
+    );
+    if (vmaxvq_u16(hits)) {
+      indexStructureScalar(data, i, i + 8, index);
+    }
+  }
+#endif
+  indexStructureScalar(data, i, len, index);
+}
+
+#endif // WSON_STRUCTURAL_INDEX_H_
@@ -0,0 +1,227 @@
+#ifndef WSON_TAPE_DIFF_H_
+#define WSON_TAPE_DIFF_H_
+
+#include "parser_tape.h"
+#include <algorithm>
+
+enum DiffStepKind {
+  DS_INDEX,  // value: an item index of an array or custom value
+  DS_KEY_A,  // value: a key node of tape a
+  DS_KEY_B,  // value: a key node of tape b
+};
+
+struct DiffStep {
+  uint32_t value;
+  uint8_t kind;
+};
+
+// Walks two tapes in lockstep and collects the paths where they differ. Values of another kind, text
+// (as written), connector or length are one path each, not looked into. Object entries are merge-joined
+// by key (the stringifier sorts them; others get sorted here), so an entry on one side only is one path.
+// Subtrees of the same text are passed over by comparing that text.
+class TapeDiff {
+  public:
+    // maxPaths: stop after that many, 0: no limit; returns false if stopped
+    bool run(const usc2vector& textA, const ParserTape& a, const usc2vector& textB, const ParserTape& b, size_t maxPaths) {
+      textA_ = &textA;
+      textB_ = &textB;
+      nodesA_ = &a.nodes;
+      nodesB_ = &b.nodes;
+      maxPaths_ = maxPaths;
+      steps.clear();
+      pathEnds.clear();
+      path_.clear();
+      keysA_.clear();
+      keysB_.clear();
+      return compare(0, 0);
+    }
+
+    inline size_t memorySize() const {
+      return vectorMemory(steps) + vectorMemory(pathEnds) + vectorMemory(path_) + vectorMemory(keysA_) + vectorMemory(keysB_);
+    }
+
+    inline void trim(size_t maxSize) {
+      trimVector(steps, maxSize);
+      trimVector(pathEnds, maxSize);
+      trimVector(path_, maxSize);
+      trimVector(keysA_, maxSize);
+      trimVector(keysB_, maxSize);
+    }
+
+    std::vector<DiffStep> steps; // of all paths, one after another
+    std::vector<uint32_t> pathEnds; // into steps
+
+  private:
+    // the raw text of a key node, for ordering entries
+    struct KeyLess {
+      const usc2vector* text;
+      const std::vector<TapeNode>* nodes;
+      inline bool operator()(uint32_t x, uint32_t y) const {
+        const TapeNode& nx = (*nodes)[x];
+        const TapeNode& ny = (*nodes)[y];
+        return std::lexicographical_compare(
+          text->begin() + nx.begin, text->begin() + nx.end,
+          text->begin() + ny.begin, text->begin() + ny.end
+        );
+      }
+    };
+
+    inline bool sameText(const TapeNode& x, const TapeNode& y) const {
+      size_t length = x.end - x.begin;
+      return length == y.end - y.begin &&
+        std::equal(textA_->begin() + x.begin, textA_->begin() + x.end, textB_->begin() + y.begin);
+    }
+
+    inline int compareKeys(const TapeNode& x, const TapeNode& y) const {
+      for (uint32_t i = x.begin, j = y.begin; ; ++i, ++j) {
+        bool xEnd = i == x.end;
+        bool yEnd = j == y.end;
+        if (xEnd || yEnd) {
+          return xEnd == yEnd ? 0 : xEnd ? -1 : 1;
+        }
+        if ((*textA_)[i] != (*textB_)[j]) {
+          return (*textA_)[i] < (*textB_)[j] ? -1 : 1;
+        }
+      }
+    }
+
+    // an entry without value ({a}) is the same as one with #t
+    inline bool isTrue(const usc2vector& text, const TapeNode& node) const {
+      return node.kind == TK_LITERAL && node.end - node.begin == 2 && text[node.begin + 1] == 't';
+    }
+
+    // false: maxPaths reached
+    inline bool report() {
+      steps.insert(steps.end(), path_.begin(), path_.end());
+      pathEnds.push_back(steps.size());
+      return !maxPaths_ || pathEnds.size() < maxPaths_;
+    }
+
+    inline bool compareItem(uint32_t index, size_t idxA, size_t idxB) {
+      DiffStep step = {index, DS_INDEX};
+      path_.push_back(step);
+      bool goOn = compare(idxA, idxB);
+      path_.pop_back();
+      return goOn;
+    }
+
+    inline bool reportKey(uint32_t keyIdx, uint8_t kind) {
+      DiffStep step = {keyIdx, kind};
+      path_.push_back(step);
+      bool goOn = report();
+      path_.pop_back();
+      return goOn;
+    }
+
+    bool compare(size_t idxA, size_t idxB) {
+      const TapeNode& nodeA = (*nodesA_)[idxA];
+      const TapeNode& nodeB = (*nodesB_)[idxB];
+      if (sameText(nodeA, nodeB)) {
+        return true;
+      }
+      if (nodeA.kind != nodeB.kind) {
+        return report();
+      }
+      switch (nodeA.kind) {
+        case TK_ARRAY:
+        case TK_CUSTOM:
+          return compareItems(idxA, idxB);
+        case TK_OBJECT:
+          return compareObjects(idxA, idxB);
+        default:
+          return report(); // leaves of other text
+      }
+    }
+
+    bool compareItems(size_t idxA, size_t idxB) {
+      const TapeNode& nodeA = (*nodesA_)[idxA];
+      const TapeNode& nodeB = (*nodesB_)[idxB];
+      if (nodeA.size != nodeB.size) {
+        return report();
+      }
+      if (nodeA.kind == TK_CUSTOM) {
+        // the name runs from behind "[:" up to the first '|' or ']' (escapes never hold these)
+        size_t i = nodeA.begin + 2;
+        size_t j = nodeB.begin + 2;
+        for (; (*textA_)[i] == (*textB_)[j]; ++i, ++j) {
+          if ((*textA_)[i] == '|' || (*textA_)[i] == ']') {
+            break;
+          }
+        }
+        if ((*textA_)[i] != (*textB_)[j]) {
+          return report();
+        }
+      }
+      size_t childA = idxA + 1;
+      size_t childB = idxB + 1;
+      for (uint32_t i = 0; i < nodeA.size; ++i) {
+        if (!compareItem(i, childA, childB)) {
+          return false;
+        }
+        childA = (*nodesA_)[childA].next;
+        childB = (*nodesB_)[childB].next;
+      }
+      return true;
+    }
+
+    // puts the key nodes of the object at idx on keys, in order
+    static void collectKeys(const usc2vector& text, const std::vector<TapeNode>& nodes, size_t idx, std::vector<uint32_t>& keys) {
+      size_t begin = keys.size();
+      size_t keyIdx = idx + 1;
+      for (uint32_t i = 0; i < nodes[idx].size; ++i) {
+        keys.push_back(keyIdx);
+        keyIdx = nodes[keyIdx].size ? nodes[keyIdx + 1].next : keyIdx + 1;
+      }
+      KeyLess less = {&text, &nodes};
+      if (!std::is_sorted(keys.begin() + begin, keys.end(), less)) {
+        std::sort(keys.begin() + begin, keys.end(), less);
+      }
+    }
+
+    bool compareObjects(size_t idxA, size_t idxB) {
+      size_t beginA = keysA_.size(); // on top of those of enclosing objects
+      size_t beginB = keysB_.size();
+      collectKeys(*textA_, *nodesA_, idxA, keysA_);
+      collectKeys(*textB_, *nodesB_, idxB, keysB_);
+      size_t endA = keysA_.size();
+      size_t endB = keysB_.size();
+      size_t i = beginA;
+      size_t j = beginB;
+      bool goOn = true;
+      while (goOn && (i < endA || j < endB)) {
+        int order = i == endA ? 1 : j == endB ? -1 : compareKeys((*nodesA_)[keysA_[i]], (*nodesB_)[keysB_[j]]);
+        if (order < 0) {
+          goOn = reportKey(keysA_[i++], DS_KEY_A);
+        } else if (order > 0) {
+          goOn = reportKey(keysB_[j++], DS_KEY_B);
+        } else {
+          uint32_t keyA = keysA_[i++];
+          uint32_t keyB = keysB_[j++];
+          bool hasA = (*nodesA_)[keyA].size != 0;
+          bool hasB = (*nodesB_)[keyB].size != 0;
+          DiffStep step = {keyA, DS_KEY_A};
+          if (hasA && hasB) {
+            path_.push_back(step);
+            goOn = compare(keyA + 1, keyB + 1);
+            path_.pop_back();
+          } else if (hasA != hasB && !(hasA ? isTrue(*textA_, (*nodesA_)[keyA + 1]) : isTrue(*textB_, (*nodesB_)[keyB + 1]))) {
+            goOn = reportKey(keyA, DS_KEY_A);
+          }
+        }
+      }
+      keysA_.resize(beginA);
+      keysB_.resize(beginB);
+      return goOn;
+    }
+
+    const usc2vector* textA_;
+    const usc2vector* textB_;
+    const std::vector<TapeNode>* nodesA_;
+    const std::vector<TapeNode>* nodesB_;
+    size_t maxPaths_;
+    std::vector<DiffStep> path_;
+    std::vector<uint32_t> keysA_; // of the objects being compared, innermost last
+    std::vector<uint32_t> keysB_;
+};
+
+#endif // WSON_TAPE_DIFF_H_
@@ -0,0 +1,132 @@
+#ifndef WSON_TAPE_READER_H_
+#define WSON_TAPE_READER_H_
+
+#include "parser_tape.h"
+
+// Replays a recorded tape to a visitor, decoding texts and literals on the way.
+// V has to provide:
+//   void text(const usc2vector&);
+//   void undefinedValue(); void nullValue(); void boolValue(bool);
+//   void numberValue(double); void dateValue(double);
+//   void backref(int64_t refIdx); // as written: 0 is the innermost enclosing value
+//   void beginArray(size_t size); void endArray();
+//   void beginObject(size_t size); void key(const usc2vector&); void endObject();
+//   void beginCustom(const usc2vector& name, size_t size); void endCustom();
+// An entry without value ({a}) is reported as key() followed by boolValue(true).
+template<typename V>
+class TapeReader {
+  public:
+    // source: the text the tape was built from
+    TapeReader(const usc2vector& source, const ParserTape& tape):
+      source_(source),
+      nodes_(tape.nodes)
+    {}
+
+    // returns the tape index behind the value at idx
+    size_t read(V& visitor, size_t idx=0) {
+      const TapeNode& node = nodes_[idx];
+      switch (node.kind) {
+        case TK_TEXT:
+          visitor.text(decode(node.begin, node.end));
+          break;
+        case TK_LITERAL:
+          readLiteral(visitor, node);
+          break;
+        case TK_BACKREF: {
+          int64_t refIdx = 0;
+          SourceBuffer::scanInteger(decodeString(node.begin + 1, node.end), refIdx);
+          visitor.backref(refIdx);
+          break;
+        }
+        case TK_ARRAY: {
+          visitor.beginArray(node.size);
+          size_t childIdx = idx + 1;
+          for (size_t i = 0; i < node.size; ++i) {
+            childIdx = read(visitor, childIdx);
+          }
+          visitor.endArray();
+          break;
+        }
+        case TK_OBJECT: {
+          visitor.beginObject(node.size);
+          size_t keyIdx = idx + 1;
+          for (size_t i = 0; i < node.size; ++i) {
+            const TapeNode& keyNode = nodes_[keyIdx];
+            visitor.key(decode(keyNode.begin, keyNode.end));
+            if (keyNode.size) {
+              keyIdx = read(visitor, keyIdx + 1);
+            } else {
+              visitor.boolValue(true);
+              keyIdx = keyIdx + 1;
+            }
+          }
+          visitor.endObject();
+          break;
+        }
+        case TK_CUSTOM: {
+          // the name runs from behind "[:" up to the first '|' or ']' (escapes never hold these)
+          size_t nameEnd = node.begin + 2;
+          while (source_[nameEnd] != '|' && source_[nameEnd] != ']') {
+            ++nameEnd;
+          }
+          visitor.beginCustom(decode(node.begin + 2, nameEnd), node.size);
+          size_t childIdx = idx + 1;
+          for (size_t i = 0; i < node.size; ++i) {
+            childIdx = read(visitor, childIdx);
+          }
+          visitor.endCustom();
+          break;
+        }
+      }
+      return node.next;
+    }
+
+  private:
+    inline const usc2vector& decode(size_t begin, size_t end) {
+      buffer_.clear();
+      buffer_.appendUnescaped(source_, begin, end - begin);
+      return buffer_.getBuffer();
+    }
+
+    inline const std::string& decodeString(size_t begin, size_t end) {
+      const usc2vector& chars = decode(begin, end);
+      string_.assign(chars.begin(), chars.end());
+      return string_;
+    }
+
+    inline void readLiteral(V& visitor, const TapeNode& node) {
+      double x = 0;
+      if (node.end == node.begin + 1) {
+        visitor.text(decode(node.end, node.end)); // '#' alone
+        return;
+      }
+      switch (source_[node.begin + 1]) {
+        case 'u':
+          visitor.undefinedValue();
+          break;
+        case 'n':
+          visitor.nullValue();
+          break;
+        case 'f':
+          visitor.boolValue(false);
+          break;
+        case 't':
+          visitor.boolValue(true);
+          break;
+        case 'd':
+          SourceBuffer::scanDate(decodeString(node.begin + 1, node.end), x);
+          visitor.dateValue(x);
+          break;
+        default:
+          SourceBuffer::scanNumber(decodeString(node.begin + 1, node.end), x);
+          visitor.numberValue(x);
+      }
+    }
+
+    const usc2vector& source_;
+    const std::vector<TapeNode>& nodes_;
+    TargetBuffer buffer_;
+    std::string string_;
+};
+
+#endif // WSON_TAPE_READER_H_
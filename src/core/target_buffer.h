@@ -8,7 +8,14 @@ class TargetBuffer: public BaseBuffer {
 
   public:
 
-    TargetBuffer() {}
+    TargetBuffer(): escapes_(0) {}
+
+    // #escaped chars since the last call
+    inline size_t takeEscapes() {
+      size_t escapes = escapes_;
+      escapes_ = 0;
+      return escapes;
+    }
 
     template<typename S>
     inline void appendEscaped(const S& source, int start=0, int length=-1) {
@@ -18,11 +25,12 @@ class TargetBuffer: public BaseBuffer {
       typename S::const_iterator sourceBegin = source.begin() + start;
       typename S::const_iterator sourceEnd = sourceBegin + length;
       typename S::const_iterator sourcePick = sourceBegin;
-      buffer_.reserve(buffer_.size() + length  + 10);
+      grow(buffer_.size() + length + 10);
       while (sourcePick != sourceEnd) {
         uint16_t c = *sourcePick++;
         uint16_t xc = getEscapeChar(c);
         if (xc) {
+          ++escapes_;
           push('`');
           push(xc);
         } else {
@@ -40,7 +48,7 @@ class TargetBuffer: public BaseBuffer {
       typename S::const_iterator sourceBegin = source.begin() + start;
       typename S::const_iterator sourceEnd = sourceBegin + length;
       typename S::const_iterator sourcePick = sourceBegin;
-      buffer_.reserve(buffer_.size() + length);
+      grow(buffer_.size() + length);
       while (sourcePick != sourceEnd) {
         uint16_t xc = *sourcePick++;
         if (xc == '`') {
@@ -60,20 +68,13 @@ class TargetBuffer: public BaseBuffer {
       return -1;
     }
 
-    inline void appendHandleEscaped(v8::Local<v8::String> source, int start=0, int length=-1) {
-      v8::Isolate* isolate = v8::Isolate::GetCurrent();
-      size_t oldSize = buffer_.size();
-      if (length < 0) {
-        length = source->Length() - start;
-      }
-      buffer_.resize(oldSize + length);
-      uint16_t* putBegin = buffer_.data() + oldSize;
-      source->Write(isolate, putBegin, start, length, v8::String::NO_NULL_TERMINATION);
-
-      uint16_t* checkIt = putBegin;
+    // Escapes the chars from begin on in place (after they were written by extend()).
+    inline void escapeTail(size_t begin) {
+      uint16_t* checkIt = buffer_.data() + begin;
+      uint16_t* checkEnd = buffer_.data() + buffer_.size();
       int escCount = 0;
 
-      while (checkIt != putBegin + length) {
+      while (checkIt != checkEnd) {
         uint16_t c = *checkIt++;
         uint16_t xc = getEscapeChar(c);
         if (xc) {
@@ -81,6 +82,8 @@ class TargetBuffer: public BaseBuffer {
         }
       }
       if (escCount) {
+        escapes_ += escCount;
+        countGrow(buffer_.size() + escCount);
         buffer_.resize(buffer_.size() + escCount, 'X');
         uint16_t* replBegin = buffer_.data();
         uint16_t* replTo = replBegin + buffer_.size();
@@ -101,20 +104,13 @@ class TargetBuffer: public BaseBuffer {
       }
     }
 
-    inline int appendHandleUnescaped(v8::Local<v8::String> source, int start=0, int length=-1) {
-      // return error pos; -1 for ok
-      v8::Isolate* isolate = v8::Isolate::GetCurrent();
-      size_t oldSize = buffer_.size();
-      if (length < 0) {
-        length = source->Length() - start;
-      }
-      buffer_.resize(oldSize + length);
-      uint16_t* putBegin = buffer_.data() + oldSize;
-      source->Write(isolate, putBegin, start, length, v8::String::NO_NULL_TERMINATION);
-
+    // Unescapes the chars from begin on in place (after they were written by extend()).
+    inline int unescapeTail(size_t begin) {
+      // return error pos (relative to begin); -1 for ok
+      uint16_t* putBegin = buffer_.data() + begin;
       uint16_t* replTo = putBegin;
       uint16_t* replFrom = putBegin;
-      uint16_t* replEnd = putBegin + length;
+      uint16_t* replEnd = buffer_.data() + buffer_.size();
       while (replFrom != replEnd) {
         uint16_t xc = *replFrom++;
         if (xc == '`') {
@@ -131,10 +127,12 @@ class TargetBuffer: public BaseBuffer {
           *replTo++ = xc;
         }
       }
-      buffer_.resize(oldSize + (replTo - putBegin));
+      buffer_.resize(begin + (replTo - putBegin));
       return -1;
     }
 
+  protected:
+    size_t escapes_;
 };
 
 #endif // WSON_TARGET_BUFFER_H_
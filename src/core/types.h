@@ -0,0 +1,44 @@
+#ifndef WSON_CORE_TYPES_H_
+#define WSON_CORE_TYPES_H_
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// The core (src/core) knows nothing about v8: it works on UTF-16 chars, as v8 strings are written.
+
+typedef std::vector<uint16_t> usc2vector;
+
+enum Ctype {
+  TEXT,
+  OBJECT,
+  ENDOBJECT,
+  ARRAY,
+  ENDARRAY,
+  IS,
+  LITERAL,
+  PIPE,
+  QUOTE,
+  END,
+};
+
+
+#define SYNTAX_ERROR -1
+
+// The deepest nesting of arrays, objects and custom values the core walks: it recurses into them.
+#define MAX_NESTING 1000
+
+template<typename V>
+inline size_t vectorMemory(const V& v) {
+  return v.capacity() * sizeof(typename V::value_type);
+}
+
+template<typename V>
+inline void trimVector(V& v, size_t maxSize) {
+  if (vectorMemory(v) > maxSize) {
+    V().swap(v);
+  }
+}
+
+#endif // WSON_CORE_TYPES_H_
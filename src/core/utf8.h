@@ -0,0 +1,60 @@
+#ifndef WSON_UTF8_H_
+#define WSON_UTF8_H_
+
+#include "types.h"
+
+// Appends chars as UTF-8 to bytes; unpaired surrogates become U+FFFD.
+// Unless final, a high surrogate at the end is left for the next call.
+// Returns the #chars taken.
+inline size_t encodeUtf8(const uint16_t* chars, size_t length, std::vector<char>& bytes, bool final) {
+  if (!final && length > 0 && chars[length - 1] >= 0xd800 && chars[length - 1] < 0xdc00) {
+    --length;
+  }
+  size_t oldSize = bytes.size();
+  bytes.resize(oldSize + length * 3); // never more bytes than that
+  char* t = bytes.data() + oldSize;
+  for (size_t i = 0; i < length; ++i) {
+    uint32_t c = chars[i];
+    if (c < 0x80) {
+      *t++ = c;
+    } else if (c < 0x800) {
+      *t++ = 0xc0 | (c >> 6);
+      *t++ = 0x80 | (c & 0x3f);
+    } else {
+      if (c >= 0xd800 && c < 0xe000) {
+        if (c < 0xdc00 && i + 1 < length && chars[i + 1] >= 0xdc00 && chars[i + 1] < 0xe000) {
+          c = 0x10000 + ((c - 0xd800) << 10) + (chars[++i] - 0xdc00);
+          *t++ = 0xf0 | (c >> 18);
+          *t++ = 0x80 | ((c >> 12) & 0x3f);
+          *t++ = 0x80 | ((c >> 6) & 0x3f);
+          *t++ = 0x80 | (c & 0x3f);
+          continue;
+        }
+        c = 0xfffd;
+      }
+      *t++ = 0xe0 | (c >> 12);
+      *t++ = 0x80 | ((c >> 6) & 0x3f);
+      *t++ = 0x80 | (c & 0x3f);
+    }
+  }
+  bytes.resize(t - bytes.data());
+  return length;
+}
+
+// The length of the longest prefix of bytes[0, length) that does not end within a UTF-8 sequence.
+inline size_t utf8Boundary(const uint8_t* bytes, size_t length) {
+  size_t end = length;
+  for (int back = 0; back < 3 && end > 0 && (bytes[end - 1] & 0xc0) == 0x80; ++back) {
+    --end;
+  }
+  if (end > 0 && bytes[end - 1] >= 0xc0) {
+    uint8_t lead = bytes[end - 1];
+    size_t sequence = lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : 2;
+    if (end - 1 + sequence > length) {
+      return end - 1; // the sequence is cut
+    }
+  }
+  return length;
+}
+
+#endif // WSON_UTF8_H_
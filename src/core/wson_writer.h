@@ -0,0 +1,265 @@
+#ifndef WSON_WSON_WRITER_H_
+#define WSON_WSON_WRITER_H_
+
+#include "target_buffer.h"
+#include "key_order.h"
+#include "number_format.h"
+#include <algorithm>
+
+// Writes values as WSON into a TargetBuffer, minding the separators; it takes the calls
+// of a TapeReader visitor. Object keys are written in the order given (StringifierTarget sorts them),
+// or, with sortKeys, as stringify would: the entries of each object get sorted when it ends,
+// and of those with the same key only the last is kept.
+class WsonWriter {
+  public:
+    WsonWriter(TargetBuffer& target, bool sortKeys=false): target_(target), keyPending_(false), sortKeys_(sortKeys) {}
+
+    inline void clear() {
+      target_.clear();
+      frames_.clear();
+      keyPending_ = false;
+      entries_.clear();
+      keys_.clear();
+      objects_.clear();
+    }
+
+    inline void setSortKeys(bool sortKeys) {
+      sortKeys_ = sortKeys;
+    }
+
+    inline size_t memorySize() const {
+      return vectorMemory(frames_) + vectorMemory(entries_) + vectorMemory(keys_) + vectorMemory(objects_) +
+        vectorMemory(order_) + vectorMemory(sorted_);
+    }
+
+    inline void trim(size_t maxSize) {
+      trimVector(frames_, maxSize);
+      trimVector(entries_, maxSize);
+      trimVector(keys_, maxSize);
+      trimVector(objects_, maxSize);
+      trimVector(order_, maxSize);
+      trimVector(sorted_, maxSize);
+    }
+
+    template<typename S>
+    inline void text(const S& s) {
+      putSeparator();
+      putText(s);
+    }
+
+    inline void undefinedValue() {
+      putLiteral('u');
+    }
+
+    inline void nullValue() {
+      putLiteral('n');
+    }
+
+    inline void boolValue(bool x) {
+      if (x && keyPending_) {
+        keyPending_ = false; // {a} for {a:#t}
+        return;
+      }
+      putLiteral(x ? 't' : 'f');
+    }
+
+    inline void numberValue(double x) {
+      putSeparator();
+      target_.push('#');
+      putNumber(x);
+    }
+
+    inline void dateValue(double x) {
+      putSeparator();
+      target_.push('#');
+      target_.push('d');
+      putNumber(x);
+    }
+
+    inline void backref(int64_t refIdx) {
+      putSeparator();
+      target_.push('|');
+      putNumber(refIdx);
+    }
+
+    inline void beginArray(size_t size=0) {
+      putSeparator();
+      target_.push('[');
+      frames_.push_back(FRAME_EMPTY);
+    }
+
+    inline void endArray() {
+      frames_.pop_back();
+      target_.push(']');
+    }
+
+    inline void beginObject(size_t size=0) {
+      putSeparator();
+      target_.push('{');
+      frames_.push_back(FRAME_EMPTY);
+      if (sortKeys_) {
+        objects_.push_back(entries_.size());
+      }
+    }
+
+    template<typename S>
+    inline void key(const S& s) {
+      keyPending_ = false;
+      if (sortKeys_) {
+        endEntry();
+      }
+      putSeparator();
+      if (sortKeys_) {
+        Entry entry = {keys_.size(), keys_.size() + s.size(), target_.size(), 0};
+        keys_.insert(keys_.end(), s.begin(), s.end());
+        entries_.push_back(entry);
+      }
+      putText(s);
+      keyPending_ = true;
+    }
+
+    inline void endObject() {
+      keyPending_ = false; // a key without value reads as true
+      if (sortKeys_) {
+        endEntry();
+        sortEntries();
+      }
+      frames_.pop_back();
+      target_.push('}');
+    }
+
+    template<typename S>
+    inline void beginCustom(const S& name, size_t size=0) {
+      putSeparator();
+      target_.push('[');
+      target_.push(':');
+      target_.appendEscaped(name);
+      frames_.push_back(0); // every arg follows a '|'
+    }
+
+    inline void endCustom() {
+      frames_.pop_back();
+      target_.push(']');
+    }
+
+  private:
+    enum {
+      FRAME_EMPTY = 1
+    };
+
+    inline void putSeparator() {
+      if (keyPending_) {
+        keyPending_ = false;
+        target_.push(':');
+        return;
+      }
+      if (frames_.empty()) {
+        return;
+      }
+      uint8_t& frame = frames_.back();
+      if (frame & FRAME_EMPTY) {
+        frame &= ~FRAME_EMPTY;
+      } else {
+        target_.push('|');
+      }
+    }
+
+    template<typename S>
+    inline void putText(const S& s) {
+      if (s.size() == 0) {
+        target_.push('#');
+      } else {
+        target_.appendEscaped(s);
+      }
+    }
+
+    struct Entry {
+      size_t keyBegin; // in keys_
+      size_t keyEnd;
+      size_t begin; // in target_, from the key on
+      size_t end;
+    };
+
+    struct EntryLess {
+      const WsonWriter* writer;
+      inline bool operator()(uint32_t x, uint32_t y) const {
+        return writer->entryLess(writer->entries_[x], writer->entries_[y]);
+      }
+    };
+
+    inline bool entryLess(const Entry& x, const Entry& y) const {
+      return keyLess(keys_.data() + x.keyBegin, x.keyEnd - x.keyBegin, keys_.data() + y.keyBegin, y.keyEnd - y.keyBegin);
+    }
+
+    // the entry written last in the object at hand is complete
+    inline void endEntry() {
+      if (entries_.size() > objects_.back()) {
+        entries_.back().end = target_.size();
+      }
+    }
+
+    // Puts the entries of the object at hand in order, if they are not yet, and drops their stack.
+    void sortEntries() {
+      size_t first = objects_.back();
+      objects_.pop_back();
+      size_t end = entries_.size();
+      if (first == end) {
+        return;
+      }
+      size_t i = first + 1;
+      while (i < end && entryLess(entries_[i - 1], entries_[i])) {
+        ++i;
+      }
+      if (i < end) {
+        order_.clear();
+        for (uint32_t j = first; j < end; ++j) {
+          order_.push_back(j);
+        }
+        EntryLess less = {this};
+        std::stable_sort(order_.begin(), order_.end(), less);
+        sorted_.clear();
+        for (size_t j = 0; j < order_.size(); ++j) {
+          const Entry& entry = entries_[order_[j]];
+          if (j + 1 < order_.size() && !entryLess(entry, entries_[order_[j + 1]])) {
+            continue; // the same key again: the later one wins, as in JS
+          }
+          if (!sorted_.empty()) {
+            sorted_.push_back('|');
+          }
+          const usc2vector& chars = target_.getBuffer();
+          sorted_.insert(sorted_.end(), chars.begin() + entry.begin, chars.begin() + entry.end);
+        }
+        target_.truncate(entries_[first].begin);
+        target_.append(sorted_);
+      }
+      keys_.resize(entries_[first].keyBegin);
+      entries_.resize(first);
+    }
+
+    inline void putLiteral(char c) {
+      putSeparator();
+      target_.push('#');
+      target_.push(c);
+    }
+
+    inline void putNumber(double x) {
+      char buf[32];
+      size_t length = formatNumber(x, buf);
+      uint16_t* t = target_.extend(length);
+      for (size_t i = 0; i < length; ++i) {
+        t[i] = buf[i];
+      }
+    }
+
+    TargetBuffer& target_;
+    std::vector<uint8_t> frames_;
+    bool keyPending_;
+    bool sortKeys_;
+    std::vector<Entry> entries_; // of the objects being written, innermost last
+    usc2vector keys_; // of entries_, unescaped
+    std::vector<size_t> objects_; // where the entries of each open object begin
+    std::vector<uint32_t> order_; // scratch
+    usc2vector sorted_; // scratch
+};
+
+#endif // WSON_WSON_WRITER_H_
@@ -0,0 +1,246 @@
+#ifndef WSON_FILE_IO_H_
+#define WSON_FILE_IO_H_
+
+#include "types.h"
+#include "trace.h"
+#include "core/utf8.h"
+#include <uv.h>
+#include <fcntl.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Files of parseFile and stringifyToFile, by the synchronous calls of libuv.
+// Errors are negative libuv codes, for node::UVException.
+
+inline uv_loop_t* fileLoop() {
+  return Nan::GetCurrentEventLoop();
+}
+
+// The bytes of a file: mapped where there is mmap, else read.
+class MappedFile {
+  public:
+    MappedFile(): data_(NULL), size_(0), mapped_(false) {}
+    ~MappedFile() {
+      close();
+    }
+
+    int open(const char* path) {
+      uv_fs_t req;
+      int fd = uv_fs_open(fileLoop(), &req, path, O_RDONLY, 0, NULL);
+      uv_fs_req_cleanup(&req);
+      if (fd < 0) {
+        return fd;
+      }
+      int err = uv_fs_fstat(fileLoop(), &req, fd, NULL);
+      size_t size = static_cast<size_t>(req.statbuf.st_size);
+      uv_fs_req_cleanup(&req);
+      if (err == 0 && size > 0) {
+#ifndef _WIN32
+        void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+          err = uv_translate_sys_error(errno);
+        } else {
+          madvise(data, size, MADV_SEQUENTIAL);
+          data_ = static_cast<const uint8_t*>(data);
+          size_ = size;
+          mapped_ = true;
+        }
+#else
+        err = readAll(fd, size);
+#endif
+      }
+      uv_fs_close(fileLoop(), &req, fd, NULL);
+      uv_fs_req_cleanup(&req);
+      return err;
+    }
+
+    inline const uint8_t* data() const {
+      return data_;
+    }
+
+    inline size_t size() const {
+      return size_;
+    }
+
+    // The bytes [begin, end) are done with: their pages need not stay resident.
+    void release(size_t begin, size_t end) {
+#ifndef _WIN32
+      if (!mapped_) {
+        return;
+      }
+      static const size_t pageSize = sysconf(_SC_PAGESIZE);
+      size_t pageBegin = (begin + pageSize - 1) / pageSize * pageSize;
+      size_t pageEnd = end / pageSize * pageSize;
+      if (pageBegin < pageEnd) {
+        madvise(const_cast<uint8_t*>(data_) + pageBegin, pageEnd - pageBegin, MADV_DONTNEED);
+      }
+#endif
+    }
+
+    void close() {
+#ifndef _WIN32
+      if (mapped_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+      }
+#endif
+      mapped_ = false;
+      data_ = NULL;
+      size_ = 0;
+      std::vector<uint8_t>().swap(bytes_);
+    }
+
+  private:
+#ifdef _WIN32
+    int readAll(int fd, size_t size) {
+      bytes_.resize(size);
+      size_t pos = 0;
+      while (pos < size) {
+        uv_fs_t req;
+        uv_buf_t buf = uv_buf_init(reinterpret_cast<char*>(bytes_.data()) + pos, static_cast<unsigned int>(size - pos));
+        int n = uv_fs_read(fileLoop(), &req, fd, &buf, 1, pos, NULL);
+        uv_fs_req_cleanup(&req);
+        if (n < 0) {
+          return n;
+        }
+        if (n == 0) {
+          break; // shrunk meanwhile
+        }
+        pos += n;
+      }
+      bytes_.resize(pos);
+      data_ = bytes_.data();
+      size_ = pos;
+      return 0;
+    }
+#endif
+
+    const uint8_t* data_;
+    size_t size_;
+    bool mapped_;
+    std::vector<uint8_t> bytes_;
+};
+
+// Takes the chars of a StringifierTarget as they come, and writes them as UTF-8:
+// the chunks of a few takes go out in one gathering write.
+class FileSink {
+  public:
+    FileSink(): fd_(-1), error_(0), chars_(0), bytes_(0), pendingCount_(0) {}
+    ~FileSink() {
+      close();
+    }
+
+    int open(const char* path) {
+      uv_fs_t req;
+      fd_ = uv_fs_open(fileLoop(), &req, path, O_WRONLY | O_CREAT | O_TRUNC, 0666, NULL);
+      uv_fs_req_cleanup(&req);
+      error_ = fd_ < 0 ? fd_ : 0;
+      chars_ = 0;
+      bytes_ = 0;
+      pendingCount_ = 0;
+      return error_;
+    }
+
+    // Takes all of buffer (but a high surrogate at its end, unless final) and clears it.
+    void take(BaseBuffer& buffer, bool final) {
+      if (pendingCount_ == chunks_.size()) {
+        chunks_.push_back(std::vector<char>());
+      }
+      std::vector<char>& chunk = chunks_[pendingCount_++];
+      chunk.clear();
+      const usc2vector& chars = buffer.getBuffer();
+      size_t taken = encodeUtf8(chars.data(), chars.size(), chunk, final);
+      chars_ += taken;
+      uint16_t rest = taken < chars.size() ? chars[taken] : 0;
+      buffer.clear();
+      if (rest) {
+        buffer.push(rest);
+      }
+      if (final || pendingCount_ == MAX_PENDING_NUM) {
+        writePending();
+      }
+    }
+
+    // The first error of open, writes or close.
+    int close() {
+      if (fd_ >= 0) {
+        writePending();
+        uv_fs_t req;
+        int err = uv_fs_close(fileLoop(), &req, fd_, NULL);
+        uv_fs_req_cleanup(&req);
+        if (!error_) {
+          error_ = err;
+        }
+        fd_ = -1;
+      }
+      return error_;
+    }
+
+    inline int error() const {
+      return error_;
+    }
+
+    inline uint64_t chars() const {
+      return chars_;
+    }
+
+    inline uint64_t bytes() const {
+      return bytes_;
+    }
+
+    inline size_t memorySize() const {
+      size_t size = 0;
+      for (size_t i=0; i<chunks_.size(); ++i) {
+        size += vectorMemory(chunks_[i]);
+      }
+      return size;
+    }
+
+  private:
+    enum {
+      MAX_PENDING_NUM = 4
+    };
+
+    void writePending() {
+      TraceSpan span("wson.write");
+      uv_buf_t bufs[MAX_PENDING_NUM];
+      size_t bufCount = 0;
+      for (size_t i=0; i<pendingCount_; ++i) {
+        if (!chunks_[i].empty()) {
+          bufs[bufCount++] = uv_buf_init(chunks_[i].data(), static_cast<unsigned int>(chunks_[i].size()));
+        }
+      }
+      pendingCount_ = 0;
+      uv_buf_t* buf = bufs;
+      while (bufCount > 0 && !error_) {
+        uv_fs_t req;
+        int n = uv_fs_write(fileLoop(), &req, fd_, buf, bufCount, -1, NULL);
+        uv_fs_req_cleanup(&req);
+        if (n < 0) {
+          error_ = n;
+          break;
+        }
+        bytes_ += n;
+        size_t written = n;
+        while (bufCount > 0 && written >= buf->len) { // a short write: go on with the rest
+          written -= buf->len;
+          ++buf;
+          --bufCount;
+        }
+        if (bufCount > 0) {
+          buf->base += written;
+          buf->len -= written;
+        }
+      }
+    }
+
+    int fd_;
+    int error_;
+    uint64_t chars_;
+    uint64_t bytes_;
+    std::vector<std::vector<char> > chunks_;
+    size_t pendingCount_;
+};
+
+#endif // WSON_FILE_IO_H_
@@ -0,0 +1,254 @@
+#include "lazy_value.h"
+#include "parser.h"
+
+LazyDoc::LazyDoc(Parser& p):
+  parser(p),
+  tape(&p),
+  busy(false)
+{}
+
+v8::Local<v8::Object> LazyValue::create(const std::shared_ptr<LazyDoc>& doc, uint32_t nodeIdx, const std::vector<LazyStep>& path) {
+  v8::Local<v8::Function> cons = Nan::New<v8::Function>(doc->parser.addon_->lazyValueConstructor);
+  v8::Local<v8::Object> obj = Nan::NewInstance(cons, 0, NULL).ToLocalChecked();
+  LazyValue* lv = node::ObjectWrap::Unwrap<LazyValue>(obj);
+  lv->doc_ = doc;
+  lv->nodeIdx_ = nodeIdx;
+  lv->path_ = path;
+  return obj;
+}
+
+v8::Local<v8::Value> LazyValue::parseRange(uint32_t nodeIdx, v8::Local<v8::Value>& error) const {
+  LazyDoc& doc = *doc_;
+  if (doc.busy) {
+    error = Nan::Error("Lazy value is already being materialized");
+    return v8::Local<v8::Value>();
+  }
+  const TapeNode& node = doc.tape.nodes[nodeIdx];
+  ParserSource* ps = doc.parser.acquirePs();
+  doc.busy = true;
+  ps->attach(doc.text, node.begin, node.end, Nan::New(doc.backrefs));
+  v8::Local<v8::Value> result = ps->getValue(NULL);
+  ps->detach(doc.text);
+  doc.busy = false;
+  if (ps->hasError) {
+    error = ps->error;
+    result = v8::Local<v8::Value>();
+  }
+  doc.parser.releasePs(ps);
+  return result;
+}
+
+v8::Local<v8::Value> LazyValue::materialize(uint32_t nodeIdx, const std::vector<LazyStep>& path, v8::Local<v8::Value>& error) const {
+  const std::vector<TapeNode>& nodes = doc_->tape.nodes;
+  if (nodeIdx != 0 && !nodes[nodeIdx].escapes) {
+    return parseRange(nodeIdx, error);
+  }
+  // the whole value is materialized only once; subtrees with backrefs leaving them are picked from it
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  v8::Local<v8::Value> value;
+  if (doc_->root.IsEmpty()) {
+    value = parseRange(0, error);
+    if (value.IsEmpty()) {
+      return value;
+    }
+    doc_->root.Reset(value);
+  } else {
+    value = Nan::New(doc_->root);
+  }
+  uint32_t parentIdx = 0;
+  for (std::vector<LazyStep>::const_iterator it=path.begin(); it != path.end(); ++it) {
+    v8::Local<v8::Object> parent = value.As<v8::Object>();
+    if (nodes[parentIdx].kind == TK_ARRAY) {
+      value = parent->Get(context, it->keyOrPos).ToLocalChecked();
+    } else {
+      value = parent->Get(context, getKey(it->keyOrPos)).ToLocalChecked();
+    }
+    parentIdx = it->nodeIdx;
+  }
+  return value;
+}
+
+v8::Local<v8::String> LazyValue::getKey(uint32_t keyIdx) const {
+  const TapeNode& keyNode = doc_->tape.nodes[keyIdx];
+  const usc2vector& text = doc_->text;
+  if (std::find(text.begin() + keyNode.begin, text.begin() + keyNode.end, '`') == text.begin() + keyNode.end) {
+    return Nan::New<v8::String>(text.data() + keyNode.begin, keyNode.end - keyNode.begin).ToLocalChecked();
+  }
+  TargetBuffer& key = doc_->keyBuffer;
+  key.clear();
+  key.appendUnescaped(text, keyNode.begin, keyNode.end - keyNode.begin);
+  return getHandle(key);
+}
+
+bool LazyValue::findKey(uint32_t nodeIdx, v8::Local<v8::String> key, uint32_t& keyIdx) const {
+  // escaping is unique, so compare the escaped key with the source
+  TargetBuffer& xKey = doc_->keyBuffer;
+  xKey.clear();
+  appendHandleEscaped(xKey, key);
+  const usc2vector& xKeyBuffer = xKey.getBuffer();
+  const usc2vector& text = doc_->text;
+  const std::vector<TapeNode>& nodes = doc_->tape.nodes;
+  uint32_t len = nodes[nodeIdx].size;
+  uint32_t idx = nodeIdx + 1;
+  for (uint32_t i=0; i<len; ++i) {
+    const TapeNode& keyNode = nodes[idx];
+    if (keyNode.end - keyNode.begin == xKeyBuffer.size() &&
+      std::equal(xKeyBuffer.begin(), xKeyBuffer.end(), text.begin() + keyNode.begin)
+    ) {
+      keyIdx = idx;
+      return true;
+    }
+    idx = keyNode.size ? nodes[idx + 1].next : idx + 1;
+  }
+  return false;
+}
+
+NAN_METHOD(LazyValue::New) {
+  Nan::HandleScope();
+  if (info.IsConstructCall()) {
+    LazyValue* obj = new LazyValue();
+    obj->Wrap(info.This());
+    info.GetReturnValue().Set(info.This());
+  } else {
+    return Nan::ThrowTypeError("LazyValue has to be constructed with new");
+  }
+}
+
+NAN_METHOD(LazyValue::Get) {
+  Nan::HandleScope();
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  LazyValue* self = unwrapChecked(info.This());
+  if (!self) {
+    return;
+  }
+  if (info.Length() < 1) {
+    return Nan::ThrowTypeError("Missing first argument");
+  }
+  v8::Local<v8::Array> pathArray;
+  uint32_t pathLen = 1;
+  if (info[0]->IsArray()) {
+    pathArray = info[0].As<v8::Array>();
+    pathLen = pathArray->Length();
+  }
+  const std::vector<TapeNode>& nodes = self->doc_->tape.nodes;
+  uint32_t nodeIdx = self->nodeIdx_;
+  std::vector<LazyStep> path(self->path_);
+  for (uint32_t i=0; i<pathLen; ++i) {
+    v8::Local<v8::Value> part = pathArray.IsEmpty() ? info[0] : pathArray->Get(context, i).ToLocalChecked();
+    const TapeNode& node = nodes[nodeIdx];
+    LazyStep step;
+    if (node.kind == TK_ARRAY) {
+      v8::Local<v8::Uint32> pos;
+      if (part->IsUint32()) {
+        step.keyOrPos = Nan::To<uint32_t>(part).ToChecked();
+      } else if (part->IsString() && part->ToArrayIndex(context).ToLocal(&pos)) {
+        step.keyOrPos = pos->Value();
+      } else {
+        return;
+      }
+      if (step.keyOrPos >= node.size) {
+        return;
+      }
+      step.nodeIdx = nodeIdx + 1;
+      for (uint32_t j=0; j<step.keyOrPos; ++j) {
+        step.nodeIdx = nodes[step.nodeIdx].next;
+      }
+    } else if (node.kind == TK_OBJECT) {
+      v8::Local<v8::String> key = part->IsString() ? part.As<v8::String>() : Nan::To<v8::String>(part).ToLocalChecked();
+      if (!self->findKey(nodeIdx, key, step.keyOrPos)) {
+        return;
+      }
+      if (!nodes[step.keyOrPos].size) {
+        if (i + 1 == pathLen) {
+          info.GetReturnValue().Set(Nan::True());
+        }
+        return;
+      }
+      step.nodeIdx = step.keyOrPos + 1;
+    } else {
+      return;
+    }
+    path.push_back(step);
+    nodeIdx = step.nodeIdx;
+  }
+
+  switch (nodes[nodeIdx].kind) {
+    case TK_ARRAY:
+    case TK_OBJECT:
+      info.GetReturnValue().Set(create(self->doc_, nodeIdx, path));
+      break;
+    default: {
+      v8::Local<v8::Value> error;
+      v8::Local<v8::Value> result = self->materialize(nodeIdx, path, error);
+      if (result.IsEmpty()) {
+        return Nan::ThrowError(error);
+      }
+      info.GetReturnValue().Set(result);
+    }
+  }
+}
+
+NAN_METHOD(LazyValue::Keys) {
+  Nan::HandleScope();
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  LazyValue* self = unwrapChecked(info.This());
+  if (!self) {
+    return;
+  }
+  const std::vector<TapeNode>& nodes = self->doc_->tape.nodes;
+  const TapeNode& node = nodes[self->nodeIdx_];
+  v8::Local<v8::Array> result = Nan::New<v8::Array>();
+  if (node.kind == TK_OBJECT) {
+    uint32_t idx = self->nodeIdx_ + 1;
+    for (uint32_t i=0; i<node.size; ++i) {
+      result->Set(context, i, self->getKey(idx)).ToChecked();
+      idx = nodes[idx].size ? nodes[idx + 1].next : idx + 1;
+    }
+  } else if (node.kind == TK_ARRAY) {
+    for (uint32_t i=0; i<node.size; ++i) {
+      result->Set(context, i, Nan::To<v8::String>(Nan::New<v8::Number>(i)).ToLocalChecked()).ToChecked();
+    }
+  }
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(LazyValue::Materialize) {
+  Nan::HandleScope();
+  LazyValue* self = unwrapChecked(info.This());
+  if (!self) {
+    return;
+  }
+  v8::Local<v8::Value> error;
+  v8::Local<v8::Value> result = self->materialize(self->nodeIdx_, self->path_, error);
+  if (result.IsEmpty()) {
+    return Nan::ThrowError(error);
+  }
+  info.GetReturnValue().Set(result);
+}
+
+NAN_GETTER(LazyValue::GetLength) {
+  Nan::HandleScope();
+  LazyValue* self = unwrapChecked(info.This());
+  if (!self) {
+    return;
+  }
+  const TapeNode& node = self->doc_->tape.nodes[self->nodeIdx_];
+  uint32_t len = (node.kind == TK_ARRAY || node.kind == TK_OBJECT) ? node.size : 0;
+  info.GetReturnValue().Set(Nan::New<v8::Number>(len));
+}
+
+void LazyValue::Init(AddonData* addon) {
+  Nan::HandleScope();
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+
+  v8::Local<v8::FunctionTemplate> newTpl = Nan::New<v8::FunctionTemplate>(New);
+  newTpl->SetClassName(Nan::New("LazyValue").ToLocalChecked());
+  newTpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  Nan::SetPrototypeMethod(newTpl, "get", Get);
+  Nan::SetPrototypeMethod(newTpl, "keys", Keys);
+  Nan::SetPrototypeMethod(newTpl, "materialize", Materialize);
+  Nan::SetAccessor(newTpl->InstanceTemplate(), Nan::New("length").ToLocalChecked(), GetLength);
+
+  addon->lazyValueConstructor.Reset(newTpl->GetFunction(context).ToLocalChecked());
+}
@@ -0,0 +1,69 @@
+#ifndef WSON_LAZY_VALUE_H_
+#define WSON_LAZY_VALUE_H_
+
+#include "core/parser_tape.h"
+#include "addon_data.h"
+#include <memory>
+
+class Parser;
+
+// Everything a tree of LazyValue handles shares: the source text and its tape.
+struct LazyDoc {
+  LazyDoc(Parser& p);
+
+  ~LazyDoc() {
+    parserHandle.Reset();
+    root.Reset();
+    backrefs.Reset();
+  }
+
+  Parser& parser;
+  Nan::Persistent<v8::Object> parserHandle; // keeps parser alive
+  usc2vector text;
+  ParserTape tape;
+  Nan::Persistent<v8::Value> backrefs; // a backrefCb or an array, empty: none
+  Nan::Persistent<v8::Value> root; // the whole value, once some backreffing subtree needed it
+  TargetBuffer keyBuffer; // scratch of key lookups, keeps its capacity
+  bool busy; // text is lent to a ParserSource
+};
+
+struct LazyStep {
+  uint32_t nodeIdx;
+  uint32_t keyOrPos; // tape index of the key (in an OBJECT) or position (in an ARRAY)
+};
+
+class LazyValue: public node::ObjectWrap {
+  public:
+    static void Init(AddonData*);
+    static v8::Local<v8::Object> create(const std::shared_ptr<LazyDoc>& doc, uint32_t nodeIdx, const std::vector<LazyStep>& path);
+
+  private:
+    LazyValue(): nodeIdx_(0) {}
+
+    v8::Local<v8::Value> materialize(uint32_t nodeIdx, const std::vector<LazyStep>& path, v8::Local<v8::Value>& error) const;
+    v8::Local<v8::Value> parseRange(uint32_t nodeIdx, v8::Local<v8::Value>& error) const;
+    v8::Local<v8::String> getKey(uint32_t keyIdx) const;
+    bool findKey(uint32_t nodeIdx, v8::Local<v8::String> key, uint32_t& keyIdx) const;
+    static inline LazyValue* unwrapChecked(v8::Local<v8::Object>);
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Get);
+    static NAN_METHOD(Keys);
+    static NAN_METHOD(Materialize);
+    static NAN_GETTER(GetLength);
+
+    std::shared_ptr<LazyDoc> doc_;
+    uint32_t nodeIdx_;
+    std::vector<LazyStep> path_; // from the root (exclusive) down to this node
+};
+
+LazyValue* LazyValue::unwrapChecked(v8::Local<v8::Object> self) {
+  LazyValue* lv = node::ObjectWrap::Unwrap<LazyValue>(self);
+  if (!lv->doc_) {
+    Nan::ThrowTypeError("Not a parsed lazy value");
+    return NULL;
+  }
+  return lv;
+}
+
+#endif // WSON_LAZY_VALUE_H_
@@ -0,0 +1,128 @@
+#ifndef WSON_MEMO_CACHE_H_
+#define WSON_MEMO_CACHE_H_
+
+#include "types.h"
+#include "retention.h"
+#include <unordered_map>
+
+// The serialized fragments of immutable subtrees, weakly keyed by their roots (options.memoize).
+class MemoCache {
+  public:
+    enum {
+      DEFAULT_MAX_SIZE = 16 << 20,
+      MIN_FRAGMENT_SIZE = 16 // smaller ones are cheaper to redo than to keep
+    };
+
+    MemoCache():
+      frozen(false),
+      maxSize(DEFAULT_MAX_SIZE),
+      size_(0)
+    {}
+
+    ~MemoCache() {
+      clear();
+      marker.Reset();
+    }
+
+    void configure(v8::Local<v8::Object> options) {
+      const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+      v8::Local<v8::Value> memoizeValue = options->Get(context, Nan::New("memoize").ToLocalChecked()).ToLocalChecked();
+      if (!memoizeValue->IsObject()) {
+        return;
+      }
+      v8::Local<v8::Object> memoize = memoizeValue.As<v8::Object>();
+      v8::Local<v8::Value> value = memoize->Get(context, Nan::New("frozen").ToLocalChecked()).ToLocalChecked();
+      frozen = value->IsTrue();
+      value = memoize->Get(context, Nan::New("marker").ToLocalChecked()).ToLocalChecked();
+      if (value->IsName()) {
+        marker.Reset(value.As<v8::Name>());
+      }
+      value = memoize->Get(context, Nan::New("maxSize").ToLocalChecked()).ToLocalChecked();
+      if (value->IsNumber()) {
+        maxSize = toSize(value);
+      }
+    }
+
+    inline bool enabled() const {
+      return frozen || !marker.IsEmpty();
+    }
+
+    inline const usc2vector* find(v8::Local<v8::Object> x, int hash) const {
+      std::pair<EntryMap::const_iterator, EntryMap::const_iterator> range = entries_.equal_range(hash);
+      for (EntryMap::const_iterator it = range.first; it != range.second; ++it) {
+        if (Nan::New(it->second->key) == x) {
+          return &it->second->fragment;
+        }
+      }
+      return NULL;
+    }
+
+    // false if the fragment is too small or the cache is full
+    inline bool insert(v8::Local<v8::Object> x, int hash, const usc2vector& source, size_t begin, size_t end) {
+      size_t fragmentSize = (end - begin) * sizeof(uint16_t);
+      if (end - begin < MIN_FRAGMENT_SIZE || size_ + fragmentSize > maxSize) {
+        return false;
+      }
+      Entry* entry = new Entry(*this, hash);
+      entry->key.Reset(x);
+      entry->key.SetWeak(entry, onCollected, Nan::WeakCallbackType::kParameter);
+      entry->fragment.assign(source.begin() + begin, source.begin() + end);
+      entries_.insert(EntryMap::value_type(hash, entry));
+      size_ += fragmentSize;
+      return true;
+    }
+
+    inline void clear() {
+      for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+        delete it->second;
+      }
+      entries_.clear();
+      size_ = 0;
+    }
+
+    inline size_t memorySize() const {
+      return size_ + entries_.size() * (sizeof(Entry) + sizeof(EntryMap::value_type));
+    }
+
+    bool frozen; // memoize frozen subtrees
+    Nan::Persistent<v8::Name> marker; // memoize subtrees having this property, empty: none
+    size_t maxSize; // bytes of fragments
+
+  private:
+    struct Entry {
+      Entry(MemoCache& c, int h): cache(c), hash(h) {}
+      ~Entry() {
+        key.Reset();
+      }
+
+      MemoCache& cache;
+      int hash;
+      Nan::Persistent<v8::Object> key;
+      usc2vector fragment;
+    };
+
+    typedef std::unordered_multimap<int, Entry*> EntryMap;
+
+    static void onCollected(const Nan::WeakCallbackInfo<Entry>& info) {
+      Entry* entry = info.GetParameter();
+      entry->key.Reset();
+      entry->cache.erase(entry);
+    }
+
+    inline void erase(Entry* entry) {
+      std::pair<EntryMap::iterator, EntryMap::iterator> range = entries_.equal_range(entry->hash);
+      for (EntryMap::iterator it = range.first; it != range.second; ++it) {
+        if (it->second == entry) {
+          entries_.erase(it);
+          break;
+        }
+      }
+      size_ -= entry->fragment.size() * sizeof(uint16_t);
+      delete entry;
+    }
+
+    EntryMap entries_;
+    size_t size_;
+};
+
+#endif // WSON_MEMO_CACHE_H_
@@ -0,0 +1,100 @@
+#ifndef WSON_OP_STATS_H_
+#define WSON_OP_STATS_H_
+
+#include "types.h"
+#include "trace.h"
+#include <uv.h>
+#include <cstring>
+
+// Counters of a Stringifier or Parser. An instance is only used from the thread of its isolate,
+// so plain counters do.
+
+struct CallStats {
+  uint64_t calls;
+  uint64_t nanos;
+
+  inline void add(uint64_t startTime) {
+    ++calls;
+    nanos += uv_hrtime() - startTime;
+  }
+};
+
+enum {
+  LATENCY_BUCKETS = 32
+};
+
+struct OpStats {
+  uint64_t calls;
+  uint64_t errors;
+  uint64_t inputLength;
+  uint64_t outputLength;
+  uint64_t escapes;
+  uint64_t refCbCalls;
+  uint64_t bufferGrows;
+  uint64_t memoHits;
+  uint64_t memoStores;
+  uint64_t schemaFallbacks; // records that did not fit their compiled schema
+  CallStats split;
+  CallStats create;
+  CallStats precreate;
+  CallStats postcreate;
+  uint64_t latency[LATENCY_BUCKETS]; // bucket i counts calls taking [2^(i-1), 2^i) ns, the last one all longer
+
+  OpStats() {
+    reset();
+  }
+
+  inline void reset() {
+    memset(this, 0, sizeof(OpStats));
+  }
+
+  inline void addLatency(uint64_t nanos) {
+    size_t bucket = 0;
+    while (nanos && bucket < LATENCY_BUCKETS - 1) {
+      nanos >>= 1;
+      ++bucket;
+    }
+    ++latency[bucket];
+  }
+
+  static inline void set(v8::Local<v8::Object> obj, const char* name, double value) {
+    obj->Set(Nan::GetCurrentContext(), Nan::New(name).ToLocalChecked(), Nan::New<v8::Number>(value)).ToChecked();
+  }
+
+  static inline void set(v8::Local<v8::Object> obj, const char* name, const CallStats& callStats) {
+    set(obj, (std::string(name) + "Calls").c_str(), callStats.calls);
+    set(obj, (std::string(name) + "Nanos").c_str(), callStats.nanos);
+  }
+
+  inline v8::Local<v8::Object> newObject() const {
+    const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    set(obj, "calls", calls);
+    set(obj, "bufferGrows", bufferGrows);
+    v8::Local<v8::Array> latencyArray = Nan::New<v8::Array>(LATENCY_BUCKETS);
+    for (size_t i=0; i<LATENCY_BUCKETS; ++i) {
+      latencyArray->Set(context, i, Nan::New<v8::Number>(latency[i])).ToChecked();
+    }
+    obj->Set(context, Nan::New("latency").ToLocalChecked(), latencyArray).ToChecked();
+    return obj;
+  }
+};
+
+// Counts one call and its latency, and traces it as name.
+class OpTimer {
+  public:
+    inline OpTimer(OpStats& stats, const char* name): stats_(stats), span_(name), startTime_(uv_hrtime()) {
+      ++stats.calls;
+    }
+
+    inline ~OpTimer() {
+      stats_.addLatency(uv_hrtime() - startTime_);
+    }
+
+  private:
+    OpStats& stats_;
+    TraceSpan span_;
+    uint64_t startTime_;
+};
+
+#endif // WSON_OP_STATS_H_
@@ -0,0 +1,57 @@
+#ifndef WSON_PARSE_PROJECTION_H_
+#define WSON_PARSE_PROJECTION_H_
+
+#include "buffer_handles.h"
+#include <map>
+
+// A nested key whitelist: {a: true, b: {c: true}} keeps a and b.c of objects
+// (arrays pass it on to their items).
+class ParseProjection {
+
+  public:
+
+    ParseProjection() {}
+
+    ~ParseProjection() {
+      for (ChildMap::iterator it=children_.begin(); it != children_.end(); ++it) {
+        delete it->second;
+      }
+    }
+
+    void build(v8::Local<v8::Object> spec) {
+      const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+      v8::Local<v8::Array> names = spec->GetOwnPropertyNames(context).ToLocalChecked();
+      uint32_t len = names->Length();
+      for (uint32_t i=0; i<len; ++i) {
+        v8::Local<v8::Value> name = names->Get(context, i).ToLocalChecked();
+        v8::Local<v8::Value> value = spec->Get(context, name).ToLocalChecked();
+        if (!Nan::To<bool>(value).ToChecked()) {
+          continue;
+        }
+        ParseProjection* child = NULL;
+        if (value->IsObject()) {
+          child = new ParseProjection();
+          child->build(value.As<v8::Object>());
+        }
+        BaseBuffer key;
+        appendHandle(key, name->IsString() ? name.As<v8::String>() : Nan::To<v8::String>(name).ToLocalChecked());
+        children_[key.getBuffer()] = child;
+      }
+    }
+
+    // child is NULL if the whole value is wanted
+    inline bool select(const usc2vector& key, const ParseProjection*& child) const {
+      ChildMap::const_iterator it = children_.find(key);
+      if (it == children_.end()) {
+        return false;
+      }
+      child = it->second;
+      return true;
+    }
+
+  private:
+    typedef std::map<usc2vector, ParseProjection*> ChildMap;
+    ChildMap children_;
+};
+
+#endif // WSON_PARSE_PROJECTION_H_
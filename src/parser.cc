@@ -1,5 +1,6 @@
 
 #include "parser.h"
+#include "lazy_value.h"
 
 using v8::Local;
 using v8::Value;
@@ -9,37 +10,43 @@ using v8::Function;
 using v8::FunctionTemplate;
 
 
-Parser::Parser(Local<Function> errorClass, v8::Local<v8::Object> options) {
+Parser::Parser(AddonData* addon, Local<Function> errorClass, v8::Local<v8::Object> options): addon_(addon) {
   const v8::Local<v8::Context> context = Nan::GetCurrentContext();
   errorClass_.Reset(errorClass);
+  retention_.configure(options);
   Local<Value> conDefsValue = options->Get(context, Nan::New("connectors").ToLocalChecked()).ToLocalChecked();
   if (conDefsValue->IsObject()) {
     Local<Object> conDefs = conDefsValue.As<Object>();
     v8::Local<v8::Array> names = conDefs->GetOwnPropertyNames(context).ToLocalChecked();
     uint32_t len = names->Length();
-    // connectors_.resize(len);
+    connectors_.reserve(len);
     for (uint32_t i=0; i<len; ++i) {
       Local<String> name = names->Get(context, i).ToLocalChecked().As<v8::String>();
       Local<Object> conDef = conDefs->Get(context, name).ToLocalChecked().As<Object>();
       ParseConnector *connector = new ParseConnector();
       connector->self.Reset(conDef);
+      connector->native = wsonNativeConnectorOf(conDef->Get(context, Nan::New(addon_->sNative)).ToLocalChecked());
       Local<Value> hasCreateValue = conDef->Get(context, Nan::New("hasCreate").ToLocalChecked()).ToLocalChecked();
       connector->hasCreate = hasCreateValue->IsBoolean() && hasCreateValue->IsTrue();
-      if (connector->hasCreate) {
+      if (connector->native && connector->native->create) {
+        connector->hasCreate = true;
+      } else if (connector->hasCreate) {
         connector->create.Reset(
-          conDef->Get(context, Nan::New(sCreate)).ToLocalChecked().As<Function>()
+          conDef->Get(context, Nan::New(addon_->sCreate)).ToLocalChecked().As<Function>()
         );
       } else {
         connector->precreate.Reset(
-          conDef->Get(context, Nan::New(sPrecreate)).ToLocalChecked().As<Function>()
+          conDef->Get(context, Nan::New(addon_->sPrecreate)).ToLocalChecked().As<Function>()
         );
         connector->postcreate.Reset(
-          conDef->Get(context, Nan::New(sPostcreate)).ToLocalChecked().As<Function>()
+          conDef->Get(context, Nan::New(addon_->sPostcreate)).ToLocalChecked().As<Function>()
         );
       }
       // std::cout << i << " hasCreate=" << connector.hasCreate << std::endl;
-      connector->name.appendHandleEscaped(name);
-      connectors_[connector->name.getBuffer()] = connector;
+      appendHandleEscaped(connector->name, name);
+      connectors_.push_back(connector);
+      const usc2vector& connectorName = connector->name.getBuffer();
+      connectorTable_.insert(connectorName.data(), connectorName.size(), connector);
     }
   }
   // std::cout << "Parser connectors_.size()=" << connectors_.size() << std::endl;
@@ -48,13 +55,14 @@ Parser::Parser(Local<Function> errorClass, v8::Local<v8::Object> options) {
 Parser::~Parser() {
   // std::cout << "Parser::~Parser" << std::endl;
   errorClass_.Reset();
-  for (ConnectorMap::iterator it=connectors_.begin(); it != connectors_.end(); ++it) {
-    delete it->second;
+  for (ConnectorVector::iterator it=connectors_.begin(); it != connectors_.end(); ++it) {
+    delete *it;
   }
   connectors_.clear();
   for (std::vector<ParserSource*>::iterator it=psPool_.begin(); it != psPool_.end(); ++it) {
     delete *it;
   }
+  psPool_.clear();
 };
 
 ParserSource* Parser::acquirePs() {
@@ -71,15 +79,24 @@ ParserSource* Parser::acquirePs() {
 
 void Parser::releasePs(ParserSource* ps) {
   // std::cout << "Parser::releasePs #=" << psPool_.size() << std::endl;
-  psPool_.push_back(ps);
+  stats_.bufferGrows += ps->source.takeGrows() + ps->source.nextBuffer.takeGrows();
+  if (psPool_.size() < retention_.maxPoolSize) {
+    ps->trim(retention_.maxBufferSize);
+    psPool_.push_back(ps);
+  } else {
+    delete ps;
+  }
+  updateMemory();
 }
 
+void Parser::updateMemory() {
+  size_t size = 0;
+  for (std::vector<ParserSource*>::const_iterator it=psPool_.begin(); it != psPool_.end(); ++it) {
+    size += (*it)->memorySize();
+  }
+  memory_.update(size);
+}
 
-Nan::Persistent<Function> Parser::constructor;
-Nan::Persistent<String> Parser::sEmpty;
-Nan::Persistent<String> Parser::sCreate;
-Nan::Persistent<String> Parser::sPrecreate;
-Nan::Persistent<String> Parser::sPostcreate;
 
 NAN_METHOD(Parser::New) {
   Nan::HandleScope();
@@ -91,14 +108,15 @@ NAN_METHOD(Parser::New) {
   }
   Local<Function> errorClass = info[0].As<Function>();
   Local<Object> options = info[1].As<Object>();
+  AddonData* addon = AddonData::fromData(info.Data());
   if (info.IsConstructCall()) {
-    Parser* obj = new Parser(errorClass, options);
+    Parser* obj = new Parser(addon, errorClass, options);
     obj->Wrap(info.This());
     info.GetReturnValue().Set(info.This());
   } else {
     const int argc = 2;
     Local<Value> argv[argc] = {errorClass, errorClass};
-    Local<Function> cons = Nan::New<Function>(constructor);
+    Local<Function> cons = Nan::New<Function>(addon->parserConstructor);
     // info.GetReturnValue().Set(cons->NewInstance(argc, argv));
     Nan::MaybeLocal<v8::Object> result = Nan::NewInstance(cons, argc, argv);
     if (!result.IsEmpty()) {
@@ -116,42 +134,91 @@ NAN_METHOD(Parser::Unescape) {
   v8::Local<v8::String> s = info[0].As<v8::String>();
 
   Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
-  int errPos = target.appendHandleUnescaped(s);
+  OpTimer timer(self->stats_, "wson.unescape");
+  self->stats_.inputLength += s->Length();
+  int errPos = appendHandleUnescaped(target, s);
+  self->stats_.bufferGrows += target.takeGrows();
   if (errPos >= 0) {
+    ++self->stats_.errors;
     const int argc = 2;
     v8::Local<v8::Value> argv[argc] = { s, Nan::New<v8::Number>(errPos) };
     return Nan::ThrowError(self->createError(argc, argv));
   }
-  info.GetReturnValue().Set(target.getHandle());
+  info.GetReturnValue().Set(getHandle(target));
 }
 
 
-NAN_METHOD(Parser::Parse) {
-  Nan::HandleScope();
+void Parser::parse(const Nan::FunctionCallbackInfo<v8::Value>& info, Parser* self, RecordSchema* schema) {
   if (info.Length() < 1 || !(info[0]->IsString())) {
     return Nan::ThrowTypeError("First argument should be a string");
   }
   Local<String> s = info[0].As<String>();
 
-  Nan::Callback *backrefCb = NULL;
-  if (info.Length() >= 2 && (info[1]->IsFunction())) {
-    Local<Function> backrefCbHandle = info[1].As<Function>();
-    backrefCb = new Nan::Callback(backrefCbHandle);
+  Local<Value> backrefs; // a backrefCb or an array
+  if (info.Length() >= 2) {
+    backrefs = info[1];
   }
 
-  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  ParseProjection projection;
+  bool hasProjection = !schema && info.Length() >= 3 && info[2]->IsObject();
+  if (hasProjection) {
+    projection.build(info[2].As<Object>());
+  }
+
+  OpTimer timer(self->stats_, "wson.parse");
+  self->stats_.inputLength += s->Length();
   ParserSource *ps = self->acquirePs();
-  ps->init(s, backrefCb);
-  Local<Value> result = ps->getValue(NULL);
+  ps->init(s, backrefs, hasProjection ? &projection : NULL);
+  Local<Value> result;
+  if (schema) {
+    bool fits;
+    result = ps->getRecord(*schema, fits);
+    if (!fits) {
+      ++self->stats_.schemaFallbacks;
+    }
+  } else {
+    result = ps->getValue(NULL);
+  }
+  bool hasError = ps->hasError;
+  Local<Value> error = ps->error;
   self->releasePs(ps);
-  delete backrefCb;
-  if (ps->hasError) {
-    return Nan::ThrowError(ps->error);
+  if (hasError) {
+    ++self->stats_.errors;
+    return Nan::ThrowError(error);
   } else {
     info.GetReturnValue().Set(result);
   }
 }
 
+NAN_METHOD(Parser::Parse) {
+  Nan::HandleScope();
+  parse(info, node::ObjectWrap::Unwrap<Parser>(info.This()), NULL);
+}
+
+// Returns a parse function for records of the shape given by the spec.
+NAN_METHOD(Parser::CompileSchema) {
+  Nan::HandleScope();
+  if (info.Length() < 1 || !(info[0]->IsObject())) {
+    return Nan::ThrowTypeError("First argument should be a schema object");
+  }
+  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  RecordSchema* schema = new RecordSchema(self);
+  if (!schema->compile(info[0].As<Object>(), info[1])) {
+    delete schema;
+    return Nan::ThrowTypeError("Schema kinds should be 'string', 'number', 'boolean' or 'any'");
+  }
+  Local<Function> fn = Nan::New<Function>(ParseRecord, Nan::New<v8::External>(schema)); // not from a template, that would keep it for good
+  Nan::SetPrivate(fn, Nan::New("wson:owner").ToLocalChecked(), info.This()); // keeps the owner alive
+  schema->bind(fn);
+  info.GetReturnValue().Set(fn);
+}
+
+NAN_METHOD(Parser::ParseRecord) {
+  Nan::HandleScope();
+  RecordSchema* schema = static_cast<RecordSchema*>(info.Data().As<v8::External>()->Value());
+  parse(info, static_cast<Parser*>(schema->owner), schema);
+}
+
 NAN_METHOD(Parser::ParsePartial) {
   Nan::HandleScope();
   const v8::Local<v8::Context> context = Nan::GetCurrentContext();
@@ -165,18 +232,18 @@ NAN_METHOD(Parser::ParsePartial) {
   Local<String> s = info[0].As<String>();
   Local<Value> howNext = info[1];
 
-  Local<Function> cbHandle = info[2].As<Function>();
-  Nan::Callback *cb = new Nan::Callback(cbHandle);
+  Local<Function> cb = info[2].As<Function>();
 
-  Nan::Callback *backrefCb = NULL;
-  if (info.Length() >= 4 && (info[3]->IsFunction())) {
-    Local<Function> backrefCbHandle = info[3].As<Function>();
-    backrefCb = new Nan::Callback(backrefCbHandle);
+  Local<Value> backrefs; // a backrefCb or an array
+  if (info.Length() >= 4) {
+    backrefs = info[3];
   }
 
   Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  OpTimer timer(self->stats_, "wson.parsePartial");
+  self->stats_.inputLength += s->Length();
   ParserSource *ps = self->acquirePs();
-  ps->init(s, backrefCb);
+  ps->init(s, backrefs);
   bool reqAbort = false;
   Local<Value> error;
   while (true) {
@@ -214,27 +281,497 @@ NAN_METHOD(Parser::ParsePartial) {
       result,
       Nan::New<v8::Number>(pos)
     };
-    howNext = cb->Call(3, cbArgv);
+    if (!cb->Call(context, context->Global(), 3, cbArgv).ToLocal(&howNext)) {
+      howNext = Nan::Undefined();
+    }
   }
   self->releasePs(ps);
-  delete cb;
-  delete backrefCb;
   if (error.IsEmpty()) {
     info.GetReturnValue().Set(Nan::New<v8::Boolean>(!reqAbort));
   } else {
+    ++self->stats_.errors;
     return Nan::ThrowError(error);
   }
 }
 
+NAN_METHOD(Parser::ParseLazy) {
+  Nan::HandleScope();
+  if (info.Length() < 1 || !(info[0]->IsString())) {
+    return Nan::ThrowTypeError("First argument should be a string");
+  }
+  Local<String> s = info[0].As<String>();
+
+  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  OpTimer timer(self->stats_, "wson.parseLazy");
+  self->stats_.inputLength += s->Length();
+  std::shared_ptr<LazyDoc> doc = std::make_shared<LazyDoc>(*self);
+  doc->parserHandle.Reset(info.This());
+  int64_t externalRefs = 0;
+  if (info.Length() >= 2 && (info[1]->IsFunction() || info[1]->IsArray())) {
+    doc->backrefs.Reset(info[1]);
+    externalRefs = info[1]->IsArray() ? info[1].As<v8::Array>()->Length() : -1;
+  }
+
+  ParserSource *ps = self->acquirePs();
+  initSource(ps->source, s);
+  doc->tape.build(ps->source, externalRefs);
+  ps->source.detach(doc->text);
+  self->releasePs(ps);
+  if (doc->tape.hasError) {
+    ++self->stats_.errors;
+    const int argc = 3;
+    Local<Value> argv[argc] = {
+      s,
+      Nan::New<v8::Number>(doc->tape.errorPos),
+      getHandle(doc->tape.errorCause)
+    };
+    return Nan::ThrowError(self->createError(argc, argv));
+  }
+  info.GetReturnValue().Set(LazyValue::create(doc, 0, std::vector<LazyStep>()));
+}
+
+NAN_METHOD(Parser::Tokenize) {
+  Nan::HandleScope();
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  if (info.Length() < 1 || !(info[0]->IsString())) {
+    return Nan::ThrowTypeError("First argument should be a string");
+  }
+  Local<String> s = info[0].As<String>();
+
+  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  OpTimer timer(self->stats_, "wson.tokenize");
+  self->stats_.inputLength += s->Length();
+  ParserSource *ps = self->acquirePs();
+  ps->init(s, Local<Function>());
+  if (!ps->tokenize()) {
+    Local<Value> error = ps->error;
+    self->releasePs(ps);
+    ++self->stats_.errors;
+    return Nan::ThrowError(error);
+  }
+  Local<Object> result = Nan::New<Object>();
+  result->Set(context, Nan::New(self->addon_->sKinds), newTypedArray<v8::Uint8Array>(ps->tokenKinds_)).ToChecked();
+  result->Set(context, Nan::New(self->addon_->sStarts), newTypedArray<v8::Uint32Array>(ps->tokenStarts_)).ToChecked();
+  result->Set(context, Nan::New(self->addon_->sEnds), newTypedArray<v8::Uint32Array>(ps->tokenEnds_)).ToChecked();
+  self->releasePs(ps);
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(Parser::Validate) {
+  Nan::HandleScope();
+  if (info.Length() < 1 || !(info[0]->IsString())) {
+    return Nan::ThrowTypeError("First argument should be a string");
+  }
+  Local<String> s = info[0].As<String>();
+  int64_t externalRefs = 0;
+  if (info.Length() >= 2) {
+    if (info[1]->IsTrue()) {
+      externalRefs = -1;
+    } else if (info[1]->IsUint32()) {
+      externalRefs = Nan::To<uint32_t>(info[1]).FromJust();
+    }
+  }
+
+  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  OpTimer timer(self->stats_, "wson.validate");
+  self->stats_.inputLength += s->Length();
+  ParserSource *ps = self->acquirePs();
+  initSource(ps->source, s);
+  ParserTape& tape = ps->tape_;
+  tape.build(ps->source, externalRefs, false);
+  if (tape.hasError) {
+    ++self->stats_.errors;
+    const int argc = 2;
+    Local<Value> items[argc] = {
+      Nan::New<v8::Number>(tape.errorPos),
+      getHandle(tape.errorCause)
+    };
+    info.GetReturnValue().Set(v8::Array::New(v8::Isolate::GetCurrent(), items, argc));
+  } else {
+    info.GetReturnValue().Set(Nan::True());
+  }
+  self->releasePs(ps);
+}
+
+// Finds the top-level values in a sequence of WSON texts: {starts, ends, next}.
+NAN_METHOD(Parser::SplitRecords) {
+  Nan::HandleScope();
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  RecordInput input;
+  if (info.Length() < 1 || !input.init(info[0])) {
+    return Nan::ThrowTypeError("First argument should be a string or an ArrayBufferView (below 4 GiB)");
+  }
+  bool more = info.Length() >= 2 && info[1]->IsTrue();
+
+  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  OpTimer timer(self->stats_, "wson.splitRecords");
+  self->stats_.inputLength += input.length();
+  ParserSource *ps = self->acquirePs();
+  ps->recordStarts_.clear();
+  ps->recordEnds_.clear();
+  size_t pos = 0;
+  size_t next = 0;
+  do { // window by window
+    pos = next;
+    next = input.split(pos, more, 0, ps->recordStarts_, ps->recordEnds_);
+  } while (next != pos && next < input.length());
+  Local<Object> result = Nan::New<Object>();
+  result->Set(context, Nan::New(self->addon_->sStarts), newTypedArray<v8::Uint32Array>(ps->recordStarts_)).ToChecked();
+  result->Set(context, Nan::New(self->addon_->sEnds), newTypedArray<v8::Uint32Array>(ps->recordEnds_)).ToChecked();
+  result->Set(context, Nan::New(self->addon_->sNext), Nan::New<v8::Number>(next)).ToChecked();
+  self->releasePs(ps);
+  info.GetReturnValue().Set(result);
+}
+
+// Parses the top-level values in a sequence of WSON texts, from start on and at most maxCount of them: {values, next}.
+NAN_METHOD(Parser::ParseRecords) {
+  Nan::HandleScope();
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  RecordInput input;
+  if (info.Length() < 1 || !input.init(info[0])) {
+    return Nan::ThrowTypeError("First argument should be a string or an ArrayBufferView (below 4 GiB)");
+  }
+  size_t pos = 0;
+  if (info.Length() >= 2 && info[1]->IsUint32()) {
+    pos = std::min(static_cast<size_t>(Nan::To<uint32_t>(info[1]).FromJust()), input.length());
+  }
+  size_t maxCount = 0;
+  if (info.Length() >= 3 && info[2]->IsUint32()) {
+    maxCount = Nan::To<uint32_t>(info[2]).FromJust();
+  }
+  bool more = info.Length() >= 4 && info[3]->IsTrue();
+
+  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  OpTimer timer(self->stats_, "wson.parseRecords");
+  self->stats_.inputLength += input.length() - pos;
+  ParserSource *ps = self->acquirePs();
+  Local<v8::Array> values = Nan::New<v8::Array>();
+  uint32_t count = 0;
+  Local<Value> error;
+  while (pos < input.length() && (!maxCount || count < maxCount)) {
+    ps->recordStarts_.clear();
+    ps->recordEnds_.clear();
+    size_t next = input.split(pos, more, maxCount ? maxCount - count : 0, ps->recordStarts_, ps->recordEnds_);
+    for (size_t i = 0; i < ps->recordStarts_.size(); ++i) {
+      ps->init(input, ps->recordStarts_[i], ps->recordEnds_[i]);
+      Local<Value> value = ps->getValue(NULL);
+      if (ps->hasError) {
+        error = ps->error;
+        pos = ps->recordStarts_[i]; // to resume at
+        break;
+      }
+      values->Set(context, count++, value).ToChecked();
+    }
+    if (!error.IsEmpty() || next == pos) {
+      break;
+    }
+    pos = next;
+  }
+  self->releasePs(ps);
+  if (!error.IsEmpty()) {
+    ++self->stats_.errors;
+    if (error->IsObject()) { // else thrown by a callback
+      // the error of the record at index, along with the batch before it
+      Local<Object> errorObj = error.As<Object>();
+      errorObj->Set(context, Nan::New("index").ToLocalChecked(), Nan::New<v8::Number>(count)).ToChecked();
+      errorObj->Set(context, Nan::New(self->addon_->sValues), values).ToChecked();
+      errorObj->Set(context, Nan::New(self->addon_->sNext), Nan::New<v8::Number>(pos)).ToChecked();
+    }
+    return Nan::ThrowError(error);
+  }
+  Local<Object> result = Nan::New<Object>();
+  result->Set(context, Nan::New(self->addon_->sValues), values).ToChecked();
+  result->Set(context, Nan::New(self->addon_->sNext), Nan::New<v8::Number>(pos)).ToChecked();
+  info.GetReturnValue().Set(result);
+}
+
+// Parses the UTF-8 file at path: its mapped bytes are decoded chunk by chunk into the UTF-16 source, the
+// pages of each released when done.
+NAN_METHOD(Parser::ParseFile) {
+  Nan::HandleScope();
+  if (info.Length() < 1 || !(info[0]->IsString())) {
+    return Nan::ThrowTypeError("First argument should be a path");
+  }
+  Nan::Utf8String path(info[0]);
+  Local<Value> backrefs; // a backrefCb or an array
+  if (info.Length() >= 2) {
+    backrefs = info[1];
+  }
+
+  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  OpTimer timer(self->stats_, "wson.parseFile");
+  MappedFile file;
+  int err = file.open(*path);
+  if (err) {
+    ++self->stats_.errors;
+    return Nan::ThrowError(node::UVException(v8::Isolate::GetCurrent(), err, "open", NULL, *path));
+  }
+  if (file.size() > SourceBuffer::MAX_SIZE) { // it decodes to as many chars at most
+    ++self->stats_.errors;
+    return Nan::ThrowRangeError("File too large to parse (2 GiB at most)");
+  }
+  self->stats_.inputLength += file.size();
+  ParserSource *ps = self->acquirePs();
+  {
+    TraceSpan span("wson.copy");
+    ps->source.clear();
+    size_t pos = 0;
+    while (pos < file.size()) {
+      size_t end = pos + std::min(file.size() - pos, static_cast<size_t>(DECODE_CHUNK_SIZE));
+      if (end < file.size()) {
+        end = pos + utf8Boundary(file.data() + pos, end - pos);
+      }
+      ps->source.appendUtf8(file.data() + pos, end - pos);
+      file.release(pos, end);
+      pos = end;
+    }
+  }
+  file.close();
+  ps->init(backrefs);
+  Local<Value> result = ps->getValue(NULL);
+  bool hasError = ps->hasError;
+  Local<Value> error = ps->error;
+  self->releasePs(ps);
+  if (hasError) {
+    ++self->stats_.errors;
+    return Nan::ThrowError(error);
+  }
+  info.GetReturnValue().Set(result);
+}
+
+// Compares two WSON texts without creating their values: the paths (arrays of keys and indices) where they
+// differ, at most maxPaths of them.
+NAN_METHOD(Parser::Diff) {
+  Nan::HandleScope();
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  if (info.Length() < 2 || !(info[0]->IsString()) || !(info[1]->IsString())) {
+    return Nan::ThrowTypeError("First and second argument should be strings");
+  }
+  Local<String> a = info[0].As<String>();
+  Local<String> b = info[1].As<String>();
+  size_t maxPaths = 0;
+  if (info.Length() >= 3 && info[2]->IsUint32()) {
+    maxPaths = Nan::To<uint32_t>(info[2]).FromJust();
+  }
+
+  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  OpTimer timer(self->stats_, "wson.diff");
+  self->stats_.inputLength += a->Length() + b->Length();
+  Local<v8::Array> result = Nan::New<v8::Array>();
+  if (a->StringEquals(b)) {
+    return info.GetReturnValue().Set(result);
+  }
+  ParserSource *psA = self->acquirePs();
+  ParserSource *psB = self->acquirePs();
+  initSource(psA->source, a);
+  initSource(psB->source, b);
+  ParserSource* sides[2] = {psA, psB};
+  Local<String> texts[2] = {a, b};
+  for (int side = 0; side < 2; ++side) {
+    ParserTape& tape = sides[side]->tape_;
+    tape.build(sides[side]->source, -1);
+    if (tape.hasError) {
+      ++self->stats_.errors;
+      const int argc = 3;
+      Local<Value> argv[argc] = {
+        texts[side],
+        Nan::New<v8::Number>(tape.errorPos),
+        getHandle(tape.errorCause)
+      };
+      Local<Value> error = self->createError(argc, argv);
+      self->releasePs(psB);
+      self->releasePs(psA);
+      return Nan::ThrowError(error);
+    }
+  }
+  TapeDiff& diff = psA->diff_;
+  diff.run(psA->source.getBuffer(), psA->tape_, psB->source.getBuffer(), psB->tape_, maxPaths);
+  TargetBuffer& key = psA->errorMsg_;
+  size_t stepIdx = 0;
+  for (size_t i = 0; i < diff.pathEnds.size(); ++i) {
+    Local<v8::Array> path = Nan::New<v8::Array>();
+    for (uint32_t j = 0; stepIdx < diff.pathEnds[i]; ++stepIdx, ++j) {
+      const DiffStep& step = diff.steps[stepIdx];
+      Local<Value> item;
+      if (step.kind == DS_INDEX) {
+        item = Nan::New<v8::Number>(step.value);
+      } else {
+        ParserSource* ps = step.kind == DS_KEY_A ? psA : psB;
+        const TapeNode& node = ps->tape_.nodes[step.value];
+        key.clear();
+        key.appendUnescaped(ps->source.getBuffer(), node.begin, node.end - node.begin);
+        item = getHandle(key);
+      }
+      path->Set(context, j, item).ToChecked();
+    }
+    result->Set(context, i, path).ToChecked();
+  }
+  self->releasePs(psB);
+  self->releasePs(psA);
+  info.GetReturnValue().Set(result);
+}
+
+// toJSON, fromJSON and canonicalize: from text to text through the core, without creating values.
+// A string gives a string; UTF-8 bytes give a Buffer of UTF-8 bytes.
+void Parser::transcode(const Nan::FunctionCallbackInfo<v8::Value>& info, Parser* self, TranscodeKind kind) {
+  bool isBytes = info.Length() >= 1 && info[0]->IsArrayBufferView();
+  if (info.Length() < 1 || !(info[0]->IsString() || isBytes)) {
+    return Nan::ThrowTypeError("First argument should be a string or an ArrayBufferView");
+  }
+  static const char* const opNames[] = {"wson.toJSON", "wson.fromJSON", "wson.canonicalize"};
+  OpTimer timer(self->stats_, opNames[kind]);
+  ParserSource *ps = self->acquirePs();
+  SourceBuffer& source = ps->source;
+  {
+    TraceSpan span("wson.copy");
+    source.clear();
+    if (isBytes) {
+      v8::Local<v8::ArrayBufferView> view = info[0].As<v8::ArrayBufferView>();
+      const uint8_t* bytes = static_cast<const uint8_t*>(view->Buffer()->GetBackingStore()->Data()) + view->ByteOffset();
+      source.appendUtf8(bytes, view->ByteLength());
+      self->stats_.inputLength += view->ByteLength();
+    } else {
+      appendHandle(source, info[0].As<String>());
+      self->stats_.inputLength += source.size();
+    }
+  }
+  usc2vector& customPrefix = kind == TC_FROM_JSON ? ps->jsonReader_.customPrefix : ps->jsonWriter_.customPrefix;
+  customPrefix.clear();
+  if (info.Length() >= 2 && info[1]->IsString()) {
+    Local<String> prefix = info[1].As<String>();
+    customPrefix.resize(prefix->Length());
+    prefix->Write(v8::Isolate::GetCurrent(), customPrefix.data(), 0, customPrefix.size(), v8::String::NO_NULL_TERMINATION);
+  }
+
+  TargetBuffer& output = ps->transcoded_;
+  int errorPos = -1;
+  const TargetBuffer* errorCause = NULL;
+  if (kind == TC_FROM_JSON) {
+    ps->wsonWriter_.clear();
+    JsonReader<WsonWriter>& reader = ps->jsonReader_;
+    if (!reader.read(ps->wsonWriter_, source.getBuffer())) {
+      errorPos = reader.errorPos;
+      errorCause = &reader.errorCause;
+    }
+  } else {
+    {
+      TraceSpan span("wson.index");
+      source.init();
+    }
+    ParserTape& tape = ps->tape_;
+    tape.build(source, -1);
+    if (tape.hasError) {
+      errorPos = tape.errorPos;
+      errorCause = &tape.errorCause;
+    } else if (kind == TC_TO_JSON) {
+      for (size_t i = 0; i < tape.nodes.size() && errorPos < 0; ++i) {
+        const TapeNode& node = tape.nodes[i];
+        const char* cause = node.kind == TK_BACKREF ? "no JSON for backrefs" :
+          node.kind == TK_CUSTOM && customPrefix.empty() ? "no JSON for custom values without a customPrefix" : NULL;
+        if (cause) {
+          ps->errorMsg_.clear();
+          ps->errorMsg_.appendAscii(cause);
+          errorPos = node.begin;
+          errorCause = &ps->errorMsg_;
+        }
+      }
+      if (errorPos < 0) {
+        ps->jsonWriter_.clear();
+        TapeReader<JsonWriter> reader(source.getBuffer(), tape);
+        reader.read(ps->jsonWriter_);
+      }
+    } else {
+      ps->wsonWriter_.clear();
+      TapeReader<WsonWriter> reader(source.getBuffer(), tape);
+      reader.read(ps->wsonWriter_);
+    }
+  }
+
+  if (errorPos >= 0) {
+    ++self->stats_.errors;
+    const int argc = 3;
+    Local<Value> argv[argc] = {
+      isBytes ? Local<Value>(getHandle(source)) : info[0],
+      Nan::New<v8::Number>(errorPos),
+      getHandle(*errorCause)
+    };
+    Local<Value> error = self->createError(argc, argv);
+    self->releasePs(ps);
+    return Nan::ThrowError(error);
+  }
+  if (output.size() > 0) { // toJSON of undefined gives undefined, as JSON.stringify
+    if (isBytes) {
+      std::vector<char>& bytes = ps->transcodedBytes_;
+      bytes.clear();
+      encodeUtf8(output.getBuffer().data(), output.size(), bytes, true);
+      info.GetReturnValue().Set(Nan::CopyBuffer(bytes.data(), bytes.size()).ToLocalChecked());
+    } else {
+      info.GetReturnValue().Set(getHandle(output));
+    }
+  }
+  self->releasePs(ps);
+}
+
+// Writes a WSON text as JSON; custom values as {"<customPrefix><name>":[args]}.
+NAN_METHOD(Parser::ToJSON) {
+  Nan::HandleScope();
+  transcode(info, node::ObjectWrap::Unwrap<Parser>(info.This()), TC_TO_JSON);
+}
+
+// Writes a JSON text as WSON, as stringify would write it parsed.
+NAN_METHOD(Parser::FromJSON) {
+  Nan::HandleScope();
+  transcode(info, node::ObjectWrap::Unwrap<Parser>(info.This()), TC_FROM_JSON);
+}
+
+// Writes a WSON text as stringify would write it parsed: keys in order, numbers in their shortest form.
+NAN_METHOD(Parser::Canonicalize) {
+  Nan::HandleScope();
+  transcode(info, node::ObjectWrap::Unwrap<Parser>(info.This()), TC_CANONICALIZE);
+}
+
+NAN_METHOD(Parser::GetStats) {
+  Nan::HandleScope();
+  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  const OpStats& stats = self->stats_;
+  Local<Object> result = stats.newObject();
+  OpStats::set(result, "errors", stats.errors);
+  OpStats::set(result, "inputLength", stats.inputLength);
+  OpStats::set(result, "backrefCbCalls", stats.refCbCalls);
+  OpStats::set(result, "create", stats.create);
+  OpStats::set(result, "precreate", stats.precreate);
+  OpStats::set(result, "postcreate", stats.postcreate);
+  OpStats::set(result, "schemaFallbacks", stats.schemaFallbacks);
+  OpStats::set(result, "psPoolSize", self->psPool_.size());
+  OpStats::set(result, "retainedBytes", self->memory_.size());
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(Parser::ResetStats) {
+  Nan::HandleScope();
+  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  self->stats_.reset();
+}
+
+NAN_METHOD(Parser::Trim) {
+  Nan::HandleScope();
+  Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
+  for (std::vector<ParserSource*>::iterator it=self->psPool_.begin(); it != self->psPool_.end(); ++it) {
+    delete *it;
+  }
+  self->psPool_.clear();
+  self->updateMemory();
+}
+
 NAN_METHOD(Parser::ConnectorOfCname) {
   Nan::HandleScope();
   if (info.Length() < 1 || !(info[0]->IsString())) {
     return Nan::ThrowTypeError("First argument should be a string");
   }
   Parser* self = node::ObjectWrap::Unwrap<Parser>(info.This());
-  BaseBuffer name;
-  name.appendHandle(info[0].As<String>());
-  const ParseConnector* connector = self->getConnector(name.getBuffer());
+  TargetBuffer name;
+  appendHandleEscaped(name, info[0].As<String>());
+  const ParseConnector* connector = self->getConnector(name.getBuffer().data(), name.size());
   Local<Value> result;
   if (connector) {
     result = Nan::New<Object>(connector->self);
@@ -244,26 +781,38 @@ NAN_METHOD(Parser::ConnectorOfCname) {
   info.GetReturnValue().Set(result);
 }
 
-void Parser::Init(v8::Local<v8::Object> exports) {
+void Parser::Init(v8::Local<v8::Object> exports, AddonData* addon) {
   Nan::HandleScope();
   const v8::Local<v8::Context> context = Nan::GetCurrentContext();
 
-  Local<FunctionTemplate> newTpl = Nan::New<FunctionTemplate>(New);
+  Local<FunctionTemplate> newTpl = Nan::New<FunctionTemplate>(New, addon->newExternal());
   newTpl->SetClassName(Nan::New("Parser").ToLocalChecked());
   newTpl->InstanceTemplate()->SetInternalFieldCount(1);
 
   Nan::SetPrototypeMethod(newTpl, "unescape", Unescape);
   Nan::SetPrototypeMethod(newTpl, "parse", Parse);
+  Nan::SetPrototypeMethod(newTpl, "compileSchema", CompileSchema);
   Nan::SetPrototypeMethod(newTpl, "parsePartial", ParsePartial);
+  Nan::SetPrototypeMethod(newTpl, "parseLazy", ParseLazy);
+  Nan::SetPrototypeMethod(newTpl, "tokenize", Tokenize);
+  Nan::SetPrototypeMethod(newTpl, "validate", Validate);
+  Nan::SetPrototypeMethod(newTpl, "splitRecords", SplitRecords);
+  Nan::SetPrototypeMethod(newTpl, "parseRecords", ParseRecords);
+  Nan::SetPrototypeMethod(newTpl, "parseFile", ParseFile);
+  Nan::SetPrototypeMethod(newTpl, "diff", Diff);
+  Nan::SetPrototypeMethod(newTpl, "toJSON", ToJSON);
+  Nan::SetPrototypeMethod(newTpl, "fromJSON", FromJSON);
+  Nan::SetPrototypeMethod(newTpl, "canonicalize", Canonicalize);
+  Nan::SetPrototypeMethod(newTpl, "getStats", GetStats);
+  Nan::SetPrototypeMethod(newTpl, "resetStats", ResetStats);
+  Nan::SetPrototypeMethod(newTpl, "trim", Trim);
   Nan::SetPrototypeMethod(newTpl, "connectorOfCname", ConnectorOfCname);
 
-  constructor.Reset(newTpl->GetFunction(context).ToLocalChecked());
-  sEmpty.Reset(Nan::New("").ToLocalChecked());
-  sCreate.Reset(Nan::New("create").ToLocalChecked());
-  sPrecreate.Reset(Nan::New("precreate").ToLocalChecked());
-  sPostcreate.Reset(Nan::New("postcreate").ToLocalChecked());
+  addon->parserConstructor.Reset(newTpl->GetFunction(context).ToLocalChecked());
 
   exports->Set(context, Nan::New("Parser").ToLocalChecked(), newTpl->GetFunction(context).ToLocalChecked()).ToChecked();
+
+  LazyValue::Init(addon);
 }
 
 
@@ -274,4 +823,13 @@ Local<Value> Parser::createError(int argc, Local<Value> *argv) const {
   // return Nan::New<v8::Function>(errorClass_)->NewInstance(argc, argv);
 }
 
+bool Parser::findConnector(const uint16_t* name, size_t length, bool& hasCreate) const {
+  const ParseConnector* connector = getConnector(name, length);
+  if (!connector) {
+    return false;
+  }
+  hasCreate = connector->hasCreate;
+  return true;
+}
+
 
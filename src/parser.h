@@ -2,17 +2,25 @@
 #define WSON_PARSER_H_
 
 #include "parser_source.h"
+#include "core/parser_tape.h"
+#include "core/name_table.h"
+#include "op_stats.h"
+#include "addon_data.h"
+#include "retention.h"
+#include "file_io.h"
 
-class Parser: public node::ObjectWrap {
+class Parser: public node::ObjectWrap, public ConnectorIndex {
 
   friend class ParserSource;
+  friend class LazyValue;
 
   public:
-    static void Init(v8::Local<v8::Object>);
+    static void Init(v8::Local<v8::Object>, AddonData*);
     v8::Local<v8::Value> createError(int argc, v8::Local<v8::Value> argv[]) const;
+    virtual bool findConnector(const uint16_t*, size_t, bool& hasCreate) const;
 
   private:
-    Parser(v8::Local<v8::Function>, v8::Local<v8::Object>);
+    Parser(AddonData*, v8::Local<v8::Function>, v8::Local<v8::Object>);
     ~Parser();
 
     struct ParseConnector {
@@ -21,6 +29,7 @@ class Parser: public node::ObjectWrap {
       Nan::Persistent<v8::Function> precreate;
       Nan::Persistent<v8::Function> postcreate;
       TargetBuffer name;
+      const WsonNativeConnector* native; // its create, if any, stands in for the one above
       bool hasCreate;
 
       ~ParseConnector() {
@@ -31,34 +40,60 @@ class Parser: public node::ObjectWrap {
       }
     };
 
-    inline const ParseConnector* getConnector(const usc2vector&) const;
+    inline const ParseConnector* getConnector(const uint16_t*, size_t) const;
     ParserSource* acquirePs();
     void releasePs(ParserSource*);
+    void updateMemory();
+    static void parse(const Nan::FunctionCallbackInfo<v8::Value>&, Parser*, RecordSchema*);
 
-    static Nan::Persistent<v8::Function> constructor;
-    static Nan::Persistent<v8::String> sEmpty;
-    static Nan::Persistent<v8::String> sCreate;
-    static Nan::Persistent<v8::String> sPrecreate;
-    static Nan::Persistent<v8::String> sPostcreate;
     static NAN_METHOD(New);
     static NAN_METHOD(Unescape);
     static NAN_METHOD(Parse);
+    static NAN_METHOD(CompileSchema);
+    static NAN_METHOD(ParseRecord);
     static NAN_METHOD(ParsePartial);
+    static NAN_METHOD(ParseLazy);
+    static NAN_METHOD(Tokenize);
+    static NAN_METHOD(Validate);
+    static NAN_METHOD(SplitRecords);
+    static NAN_METHOD(ParseRecords);
+    static NAN_METHOD(ParseFile);
+    static NAN_METHOD(Diff);
+    static NAN_METHOD(ToJSON);
+    static NAN_METHOD(FromJSON);
+    static NAN_METHOD(Canonicalize);
     static NAN_METHOD(ConnectorOfCname);
+    static NAN_METHOD(GetStats);
+    static NAN_METHOD(ResetStats);
+    static NAN_METHOD(Trim);
 
-    typedef std::map<usc2vector, ParseConnector* > ConnectorMap;
+    enum {
+      DECODE_CHUNK_SIZE = 1 << 24 // bytes of a file decoded at a time
+    };
+
+    enum TranscodeKind {
+      TC_TO_JSON,
+      TC_FROM_JSON,
+      TC_CANONICALIZE
+    };
+    static void transcode(const Nan::FunctionCallbackInfo<v8::Value>&, Parser*, TranscodeKind);
+
+    typedef std::vector<ParseConnector*> ConnectorVector;
 
+    AddonData* addon_;
     Nan::Persistent<v8::Function> errorClass_;
-    ConnectorMap connectors_;
+    ConnectorVector connectors_;
+    NameTable<const ParseConnector*> connectorTable_; // by escaped name
     std::vector<ParserSource*> psPool_;
+    OpStats stats_;
+    Retention retention_;
+    ExternalMemory memory_;
 };
 
-const Parser::ParseConnector* Parser::getConnector(const usc2vector& name) const {
-  ConnectorMap::const_iterator it = connectors_.find(name);
-  if (it == connectors_.end()) {
-    return NULL;
-  }
-  return it->second;
+const Parser::ParseConnector* Parser::getConnector(const uint16_t* name, size_t length) const {
+  const ParseConnector* connector = NULL;
+  connectorTable_.find(name, length, connector);
+  return connector;
 }
 
 #endif // WSON_PARSER_H_
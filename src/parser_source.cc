@@ -3,58 +3,53 @@
 #include <cstdlib>
 
 
+ParserSource::ParserSource(Parser& parser):
+  parser_(parser),
+  tape_(&parser),
+  wsonWriter_(transcoded_, true),
+  jsonWriter_(transcoded_)
+{
+  // std::cout << "ParserSource::ParserSource" << std::endl;
+}
 
 inline bool getNumber(const std::string& s, v8::Local<v8::Value>& value) {
-  const char* begin = s.data();
-  char* end;
-  int x = strtol(begin, &end, 10);
-  if (end == begin + s.size()) {
+  double x;
+  if (SourceBuffer::scanNumber(s, x)) {
     value = Nan::New<v8::Number>(x);
     return true;
-  } else {
-    double x = strtod(begin, &end);
-    if (end == begin + s.size()) {
-      value = Nan::New<v8::Number>(x);
-      return true;
-    }
   }
   return false;
 }
 
 inline bool getDate(const std::string& s, v8::Local<v8::Value>& value) {
   // std::cout << "getDate: " << s << std::endl;
-  const char* begin = s.data();
-  char* end;
-  double x = strtod(begin + 1, &end);
-  if (end == begin + s.size()) {
+  double x;
+  if (SourceBuffer::scanDate(s, x)) {
     value = Nan::New<v8::Date>(x).ToLocalChecked();
     return true;
   }
   return false;
 }
 
-inline bool getInteger(const std::string& s, int& value) {
-  const char* begin = s.data();
-  char* end;
-  int x = strtol(begin, &end, 10);
-  if (end == begin + s.size()) {
-    value = x;
-    return true;
-  }
-  return false;
-}
-
 v8::Local<v8::String> ParserSource::getText() {
+ size_t begin = getPos();
  int err = source.pullUnescapedBuffer();
  if (err) {
    makeError();
-   return Nan::New(Parser::sEmpty);
+   return Nan::New(parser_.addon_->sEmpty);
+ }
+ if (source.nextBuffer.size() > static_cast<size_t>(v8::String::kMaxLength)) { // only from a file
+   TargetBuffer& msg = errorMsg_;
+   msg.clear();
+   msg.appendAscii("text too long");
+   makeError(begin, &msg);
+   return Nan::New(parser_.addon_->sEmpty);
  }
- return source.nextBuffer.getHandle();
+ return getHandle(source.nextBuffer);
 }
 
 v8::Local<v8::Value> ParserSource::getLiteral() {
-  v8::Local<v8::Value> value;
+  v8::Local<v8::Value> value = Nan::Undefined(); // on error, still fit for Set
   if (hasError) return value;
   if (source.nextType == TEXT) {
     bool litErr = false;
@@ -96,14 +91,15 @@ v8::Local<v8::Value> ParserSource::getLiteral() {
       }
     }
     if (litErr) {
-      TargetBuffer msg;
-      msg.append(std::string("unexpected literal '"));
+      TargetBuffer& msg = errorMsg_;
+      msg.clear();
+      msg.appendAscii("unexpected literal '");
       msg.append(source.nextString);
-      msg.append(std::string("'"));
+      msg.appendAscii("'");
       makeError(litBeginIdx, &msg);
     }
   } else {
-    value = Nan::New(Parser::sEmpty);
+    value = Nan::New(parser_.addon_->sEmpty);
   }
   return value;
 }
@@ -119,8 +115,8 @@ v8::Local<v8::Object> ParserSource::getBackreffed(ParseFrame* frame) {
     if (source.pullUnescapedString()) {
       makeError();
     } else {
-      int refIdx;
-      if (!getInteger(source.nextString, refIdx) || refIdx < 0) {
+      int64_t refIdx;
+      if (!SourceBuffer::scanInteger(source.nextString, refIdx) || refIdx < 0) {
         refErr = true;
       } else {
         if (frame) {
@@ -131,12 +127,26 @@ v8::Local<v8::Object> ParserSource::getBackreffed(ParseFrame* frame) {
           ParseFrame* parentIdxFrame = frame ? idxFrame->parent : NULL;
           if (parentIdxFrame) {
             idxFrame = parentIdxFrame;
-          } else if (backrefCb) {
+          } else if (!backrefCb.IsEmpty()) {
+            const v8::Local<v8::Context> context = Nan::GetCurrentContext();
             v8::Local<v8::Value> cbArgv[] = {
               Nan::New<v8::Number>(refIdx)
             };
-            v8::Local<v8::Value> brValue = backrefCb->Call(1, cbArgv);
-            if (brValue->IsObject()) {
+            ++parser_.stats_.refCbCalls;
+            v8::Local<v8::Value> brValue;
+            if (backrefCb->Call(context, context->Global(), 1, cbArgv).ToLocal(&brValue) && brValue->IsObject()) {
+              value = brValue.As<v8::Object>();
+            } else {
+              refErr = true;
+            }
+            idxFrame = NULL;
+            break;
+          } else if (!backrefArray.IsEmpty()) {
+            v8::Local<v8::Value> brValue;
+            if (
+              refIdx < backrefArrayLength_ &&
+              backrefArray->Get(Nan::GetCurrentContext(), static_cast<uint32_t>(refIdx)).ToLocal(&brValue) && brValue->IsObject()
+            ) {
               value = brValue.As<v8::Object>();
             } else {
               refErr = true;
@@ -162,8 +172,9 @@ v8::Local<v8::Object> ParserSource::getBackreffed(ParseFrame* frame) {
   }
   if (refErr) {
     // std::cout << "getBackreffed refErr nextType=" << source.nextType << std::endl;
-    TargetBuffer msg;
-    msg.append(std::string("unexpected backref '"));
+    TargetBuffer& msg = errorMsg_;
+    msg.clear();
+    msg.appendAscii("unexpected backref '");
     if (nextType != END) {
       --refBeginIdx;
     }
@@ -172,7 +183,7 @@ v8::Local<v8::Object> ParserSource::getBackreffed(ParseFrame* frame) {
     } else {
       msg.push(source.nextChar);
     }
-    msg.append(std::string("'"));
+    msg.appendAscii("'");
     makeError(refBeginIdx, &msg);
   }
   return value;
@@ -246,11 +257,28 @@ end:
 }
 
 v8::Local<v8::Object> ParserSource::getObject(ParseFrame* parentFrame) {
-  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
   ParseFrame frame(Nan::New<v8::Object>(), parentFrame);
+  getEntries(frame, STAGE_BEGIN);
+  return frame.value;
+}
+
+// Parses the entries of an object into frame.value, from stage on.
+void ParserSource::getEntries(ParseFrame& frame, EntryStage stage) {
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
   v8::Local<v8::String> key;
+  const ParseProjection* projection = projection_;
+  const ParseProjection* childProjection = NULL;
+  bool skipEntry = false;
   if (hasError) goto end;
 
+  switch (stage) {
+    case STAGE_NEXT:
+      goto stageNext;
+    case STAGE_HAVE_ENTRY:
+      goto stageHaveValue;
+    default:
+      break;
+  }
   switch (source.nextType) {
     case ENDOBJECT:
       next();
@@ -264,10 +292,24 @@ stageNext:
   switch (source.nextType) {
     case TEXT:
     case QUOTE:
-      key = getText();
+      if (projection) {
+        if (source.pullUnescapedBuffer()) {
+          makeError();
+          goto end;
+        }
+        skipEntry = !projection->select(source.nextBuffer.getBuffer(), childProjection);
+        if (!skipEntry) {
+          key = getHandle(source.nextBuffer);
+        }
+      } else {
+        key = getText();
+      }
       goto stageHaveKey;
     case LITERAL:
       next();
+      if (projection) {
+        skipEntry = !projection->select(usc2vector(), childProjection);
+      }
       key = Nan::New<v8::String>().ToLocalChecked();
       goto stageHaveKey;
     default:
@@ -279,11 +321,15 @@ stageHaveKey:
   switch (source.nextType) {
     case ENDOBJECT:
       next();
-      frame.value->Set(context, key, Nan::True()).ToChecked();
+      if (!skipEntry) {
+        frame.value->Set(context, key, Nan::True()).ToChecked();
+      }
       break;
     case PIPE:
       next();
-      frame.value->Set(context, key, Nan::True()).ToChecked();
+      if (!skipEntry) {
+        frame.value->Set(context, key, Nan::True()).ToChecked();
+      }
       goto stageNext;
     case IS:
       next();
@@ -294,6 +340,14 @@ stageHaveKey:
   goto end;
 
 stageHaveColon:
+  if (skipEntry) {
+    if (source.skipValue()) {
+      makeError();
+      goto end;
+    }
+    goto stageHaveValue;
+  }
+  projection_ = childProjection;
   switch (source.nextType) {
     case TEXT:
     case QUOTE:
@@ -325,6 +379,7 @@ stageHaveColon:
   goto end;
 
 stageHaveValue:
+  projection_ = projection;
   switch (source.nextType) {
     case ENDOBJECT:
       next();
@@ -338,7 +393,7 @@ stageHaveValue:
   goto end;
 
 end:
-  return frame.value;
+  projection_ = projection;
 }
 
 v8::Local<v8::Object> ParserSource::getCustom(ParseFrame* parentFrame) {
@@ -346,23 +401,29 @@ v8::Local<v8::Object> ParserSource::getCustom(ParseFrame* parentFrame) {
   const v8::Local<v8::Context> context = Nan::GetCurrentContext();
   bool stolenBackref = false;
   ParseFrame frame(Nan::New<v8::Object>(), parentFrame);
-  v8::Local<v8::Array> args = Nan::New<v8::Array>();
+  size_t argsBegin = customArgs_.size(); // the args go on top of those of enclosing custom values
   const Parser::ParseConnector* connector(NULL);
-  size_t nameIdx = source.nextIdx - 1; // for error
+  size_t nameIdx = source.nextIdx - 1;
+  size_t nameEnd;
+  const ParseProjection* projection = projection_;
+  projection_ = NULL;
   if (hasError) goto end;
   switch (source.nextType) {
     case TEXT:
     case QUOTE:
-      if (source.pullUnescapedBuffer()) {
+      // look the name up right in the source, as escaped there
+      if (source.skipUnescaped()) {
         makeError();
         break;
       }
-      connector = parser_.getConnector(source.nextBuffer.getBuffer());
+      nameEnd = getPos();
+      connector = parser_.getConnector(source.getBuffer().data() + nameIdx, nameEnd - nameIdx);
       if (!connector) {
-        TargetBuffer msg;
-        msg.append(std::string("no connector for '"));
-        msg.append(source.nextBuffer.getBuffer());
-        msg.append(std::string("'"));
+        TargetBuffer& msg = errorMsg_;
+        msg.clear();
+        msg.appendAscii("no connector for '");
+        msg.appendUnescaped(source.getBuffer(), nameIdx, nameEnd - nameIdx);
+        msg.appendAscii("'");
         makeError(nameIdx, &msg);
         break;
       }
@@ -373,7 +434,10 @@ v8::Local<v8::Object> ParserSource::getCustom(ParseFrame* parentFrame) {
           v8::Local<v8::Function> precreate = Nan::New<v8::Function>(connector->precreate);
           const int argc = 0;
           v8::Local<v8::Value> argv[argc] = {};
+          TraceSpan span("wson.precreate");
+          uint64_t startTime = uv_hrtime();
           frame.value = precreate->Call(context, Nan::New<v8::Object>(connector->self), argc, argv).ToLocalChecked().As<v8::Object>();
+          parser_.stats_.precreate.add(startTime);
           // std::cout << "precreate" << std::endl;
         }
       }
@@ -387,26 +451,26 @@ stageNext:
   switch (source.nextType) {
     case TEXT:
     case QUOTE:
-      args->Set(context, args->Length(), getText()).ToChecked();
+      customArgs_.push_back(getText());
       goto stageHave;
     case LITERAL:
       next();
-      args->Set(context, args->Length(), getLiteral()).ToChecked();
+      customArgs_.push_back(getLiteral());
       if (hasError) goto end;
       goto stageHave;
     case ARRAY:
       next();
-      args->Set(context, args->Length(), getArray(&frame)).ToChecked();
+      customArgs_.push_back(getArray(&frame));
       if (hasError) goto end;
       goto stageHave;
     case OBJECT:
       next();
-      args->Set(context, args->Length(), getObject(&frame)).ToChecked();
+      customArgs_.push_back(getObject(&frame));
       if (hasError) goto end;
       goto stageHave;
     case PIPE:
       next();
-      args->Set(context, args->Length(), getBackreffed(&frame)).ToChecked();
+      customArgs_.push_back(getBackreffed(&frame));
       if (hasError) goto end;
       goto stageHave;
     default:
@@ -418,17 +482,51 @@ stageHave:
     case ENDARRAY:
       next();
       {
-        if (connector->hasCreate) {
+        v8::Local<v8::Value>* argsData = customArgs_.data() + argsBegin;
+        size_t argsLength = customArgs_.size() - argsBegin;
+        if (connector->native && connector->native->create) {
+          TraceSpan span("wson.create");
+          uint64_t startTime = uv_hrtime();
+          Nan::TryCatch tryCatch;
+          v8::Local<v8::Value> value = connector->native->create(
+            connector->native->data, v8::Isolate::GetCurrent(), argsData, static_cast<int>(argsLength)
+          );
+          parser_.stats_.create.add(startTime);
+          if (value.IsEmpty()) {
+            error = tryCatch.Exception();
+            hasError = true;
+            goto end;
+          }
+          if (!value->IsObject()) {
+            TargetBuffer& msg = errorMsg_;
+            msg.clear();
+            msg.appendAscii("native create of '");
+            msg.appendUnescaped(source.getBuffer(), nameIdx, nameEnd - nameIdx);
+            msg.appendAscii("' gave no object");
+            makeError(nameIdx, &msg);
+            goto end;
+          }
+          frame.value = value.As<v8::Object>();
+        } else if (connector->hasCreate) {
           v8::Local<v8::Function> create = Nan::New<v8::Function>(connector->create);
           const int argc = 1;
-          v8::Local<v8::Value> argv[argc] = {args};
+          v8::Local<v8::Value> argv[argc] = {v8::Array::New(v8::Isolate::GetCurrent(), argsData, argsLength)};
+          TraceSpan span("wson.create");
+          uint64_t startTime = uv_hrtime();
           frame.value = create->Call(context, Nan::New<v8::Object>(connector->self), argc, argv).ToLocalChecked().As<v8::Object>();
+          parser_.stats_.create.add(startTime);
           // std::cout << "create" << std::endl;
         } else {
           v8::Local<v8::Function> postcreate = Nan::New<v8::Function>(connector->postcreate);
           const int argc = 2;
-          v8::Local<v8::Value> argv[argc] = {frame.value, args};
-          v8::Local<v8::Value> newValue = postcreate->Call(context, Nan::New<v8::Object>(connector->self), argc, argv).ToLocalChecked();
+          v8::Local<v8::Value> argv[argc] = {frame.value, v8::Array::New(v8::Isolate::GetCurrent(), argsData, argsLength)};
+          v8::Local<v8::Value> newValue;
+          {
+            TraceSpan span("wson.postcreate");
+            uint64_t startTime = uv_hrtime();
+            newValue = postcreate->Call(context, Nan::New<v8::Object>(connector->self), argc, argv).ToLocalChecked();
+            parser_.stats_.postcreate.add(startTime);
+          }
           if (newValue->IsObject()) {
             if (newValue != frame.value) {
               if (frame.isBackreffed) {
@@ -451,9 +549,12 @@ stageHave:
   goto end;
 
 end:
+  customArgs_.resize(argsBegin);
+  projection_ = projection;
   if (stolenBackref) {
-    TargetBuffer msg;
-    msg.append(std::string("backreffed value is replaced by postcreate"));
+    TargetBuffer& msg = errorMsg_;
+    msg.clear();
+    msg.appendAscii("backreffed value is replaced by postcreate");
     // msg.append(source.nextString);
     // msg.append(std::string("'"));
     // makeError(litBeginIdx, &msg);
@@ -501,6 +602,94 @@ v8::Local<v8::Value> ParserSource::getValue(bool* isValue) {
   return value;
 }
 
+// The fast path of a compiled schema: the keys are expected in order and compared right in the source.
+// From the first entry that does not fit on, getEntries parses the rest into the same object, as
+// the generic path would, and fits is cleared.
+v8::Local<v8::Value> ParserSource::getRecord(const RecordSchema& schema, bool& fits) {
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  fits = source.nextType == OBJECT;
+  if (!fits) {
+    return getValue(NULL);
+  }
+  next();
+  ParseFrame frame(Nan::New<v8::Object>(), NULL);
+  EntryStage stage = STAGE_BEGIN;
+  const usc2vector& chars = source.getBuffer();
+  size_t len = schema.fields.size();
+  for (size_t i=0; fits && i<len; ++i) {
+    const RecordSchema::Field& field = *schema.fields[i];
+    if (i > 0) {
+      if (source.nextType != PIPE) {
+        fits = false;
+        break;
+      }
+      next();
+      stage = STAGE_NEXT;
+    }
+    const usc2vector& key = field.escapedKey.getBuffer();
+    size_t keyBegin = source.nextIdx - 1;
+    size_t keyEnd = keyBegin + key.size();
+    if (
+      isEnd() || keyEnd > source.endIdx ||
+      !std::equal(key.begin(), key.end(), chars.begin() + keyBegin)
+    ) {
+      fits = false;
+      break;
+    }
+    Ctype afterKey = keyEnd < source.endIdx ? SourceBuffer::getCtype(chars[keyEnd]) : END;
+    if (afterKey == TEXT || afterKey == QUOTE) {
+      fits = false; // a longer key
+      break;
+    }
+    skip(key.size());
+    v8::Local<v8::Value> value;
+    if (source.nextType == IS) {
+      next();
+      switch (source.nextType) {
+        case TEXT:
+        case QUOTE:
+          value = getText();
+          break;
+        case LITERAL:
+          next();
+          value = getLiteral();
+          break;
+        case ARRAY:
+          next();
+          value = getArray(&frame);
+          break;
+        case OBJECT:
+          next();
+          value = getObject(&frame);
+          break;
+        case PIPE:
+          next();
+          value = getBackreffed(&frame);
+          break;
+        default:
+          makeError();
+      }
+      if (hasError) {
+        return frame.value;
+      }
+    } else {
+      value = Nan::True();
+    }
+    frame.value->Set(context, Nan::New(field.key), value).ToChecked();
+    stage = STAGE_HAVE_ENTRY;
+  }
+  if (fits && source.nextType == ENDOBJECT) {
+    next();
+  } else {
+    fits = false;
+    getEntries(frame, stage);
+  }
+  if (!hasError && !isEnd()) {
+    makeError(); // extra chars after end
+  }
+  return frame.value;
+}
+
 v8::Local<v8::Value> ParserSource::getRawValue(bool* isValue) {
   v8::Local<v8::Value> value;
   switch (source.nextType) {
@@ -516,24 +705,59 @@ v8::Local<v8::Value> ParserSource::getRawValue(bool* isValue) {
   return value;
 }
 
+bool ParserSource::tokenize() {
+  tokenKinds_.clear();
+  tokenStarts_.clear();
+  tokenEnds_.clear();
+  while (!isEnd()) {
+    size_t begin = source.nextIdx - 1;
+    Ctype kind = source.nextType;
+    if (kind == QUOTE) {
+      kind = TEXT;
+    }
+    if (kind == TEXT) {
+      if (source.skipUnescaped()) {
+        makeError();
+        return false;
+      }
+    } else {
+      next();
+    }
+    tokenKinds_.push_back(kind);
+    tokenStarts_.push_back(begin);
+    tokenEnds_.push_back(getPos());
+  }
+  return true;
+}
+
 void ParserSource::makeError(int pos, const BaseBuffer* cause) {
-  // std::cout << "makeError hasMsg=" << (cause != NULL) << std::endl;
+  TraceSpan span("wson.error");
   if (pos < 0) {
-    pos = isEnd() ? source.size() : source.nextIdx - 1;
+    pos = getPos();
   }
   const int argc = 3;
   v8::Local<v8::String> hCause;
   if (cause) {
-    hCause = cause->getHandle();
+    hCause = getHandle(*cause);
   } else {
-    hCause = Nan::New(Parser::sEmpty);
+    hCause = Nan::New(parser_.addon_->sEmpty);
   }
-  v8::Local<v8::Value> argv[argc] = {
-    source.getHandle(),
-    Nan::New<v8::Number>(pos),
-    hCause
-  };
+  v8::Local<v8::Value> argv[argc];
+  size_t offset = 0;
+  if (excerptErrors_) {
+    const usc2vector& chars = source.getBuffer();
+    offset = pos > ERROR_EXCERPT_SIZE ? pos - ERROR_EXCERPT_SIZE : 0;
+    size_t end = std::min(static_cast<size_t>(pos) + ERROR_EXCERPT_SIZE, chars.size());
+    argv[0] = Nan::New<v8::String>(chars.data() + offset, end - offset).ToLocalChecked();
+  } else {
+    argv[0] = getHandle(source);
+  }
+  argv[1] = Nan::New<v8::Number>(pos - offset);
+  argv[2] = hCause;
   error = parser_.createError(argc, argv);
+  if (excerptErrors_ && error->IsObject()) {
+    error.As<v8::Object>()->Set(Nan::GetCurrentContext(), Nan::New("offset").ToLocalChecked(), Nan::New<v8::Number>(offset)).ToChecked();
+  }
   hasError = true;
 }
 
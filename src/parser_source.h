@@ -1,7 +1,16 @@
 #ifndef WSON_PARSER_SOURCE_H_
 #define WSON_PARSER_SOURCE_H_
 
-#include "source_buffer.h"
+#include "buffer_handles.h"
+#include "parse_projection.h"
+#include "record_schema.h"
+#include "record_input.h"
+#include "core/parser_tape.h"
+#include "core/tape_diff.h"
+#include "core/tape_reader.h"
+#include "core/json_reader.h"
+#include "core/json_writer.h"
+#include "core/wson_writer.h"
 #include <map>
 #include <memory>
 
@@ -21,40 +30,143 @@ struct ParseFrame {
   {}
 };
 
+// Where getEntries starts within an object: just after '{', just after a '|' or just after an entry.
+enum EntryStage {
+  STAGE_BEGIN,
+  STAGE_NEXT,
+  STAGE_HAVE_ENTRY
+};
+
 class ParserSource {
   public:
     friend class Parser;
+    friend class LazyValue;
 
-    ParserSource(Parser& parser): parser_(parser) {
-      // std::cout << "ParserSource::ParserSource" << std::endl;
-    }
+    ParserSource(Parser& parser);
     ~ParserSource() {
       // std::cout << "ParserSource::~ParserSource" << std::endl;
     }
-    void init(v8::Local<v8::String> s, Nan::Callback* brCb) {
+    void init(v8::Local<v8::String> s, v8::Local<v8::Value> backrefs, const ParseProjection* projection=NULL) {
+      hasError=false;
+      excerptErrors_ = false;
+      initSource(source, s);
+      setBackrefs(backrefs);
+      projection_ = projection;
+    }
+    // the record [begin, end) of input, as found by input.split()
+    void init(RecordInput& input, size_t begin, size_t end) {
+      hasError=false;
+      excerptErrors_ = false;
+      input.load(source, begin, end);
+      setBackrefs(v8::Local<v8::Value>());
+      projection_ = NULL;
+    }
+    // the chars already put into source, decoded from a file: an error shows an excerpt around its pos
+    void init(v8::Local<v8::Value> backrefs) {
+      hasError=false;
+      excerptErrors_ = true;
+      {
+        TraceSpan span("wson.index");
+        source.init();
+      }
+      setBackrefs(backrefs);
+      projection_ = NULL;
+    }
+    void attach(usc2vector& text, size_t begin, size_t end, v8::Local<v8::Value> backrefs) {
       hasError=false;
-      source.init(s);
-      backrefCb = brCb;
+      excerptErrors_ = false;
+      source.attach(text, begin, end);
+      setBackrefs(backrefs);
+      projection_ = NULL;
+    }
+    // a backrefCb, an array of external objects or neither
+    inline void setBackrefs(v8::Local<v8::Value> backrefs) {
+      backrefCb.Clear();
+      backrefArray.Clear();
+      if (backrefs.IsEmpty()) {
+        return;
+      }
+      if (backrefs->IsFunction()) {
+        backrefCb = backrefs.As<v8::Function>();
+      } else if (backrefs->IsArray()) {
+        backrefArray = backrefs.As<v8::Array>();
+        backrefArrayLength_ = backrefArray->Length();
+      }
+    }
+    void detach(usc2vector& text) {
+      source.detach(text);
     }
     inline void next() { source.next(); }
     inline void skip(size_t n) { source.skip(n); }
     inline bool isEnd() { return source.nextType == END; }
-    inline size_t getPos() { return isEnd() ? source.size() : source.nextIdx - 1; }
+    inline size_t getPos() { return isEnd() ? source.endIdx : source.nextIdx - 1; }
     inline v8::Local<v8::String> getText();
     inline v8::Local<v8::Value> getLiteral();
     inline v8::Local<v8::Object> getBackreffed(ParseFrame* frame);
     inline v8::Local<v8::Object> getArray(ParseFrame* parentFrame);
     inline v8::Local<v8::Object> getObject(ParseFrame* parentFrame);
+    void getEntries(ParseFrame& frame, EntryStage stage);
     inline v8::Local<v8::Object> getCustom(ParseFrame* parentFrame);
     v8::Local<v8::Value> getValue(bool* isValue);
+    v8::Local<v8::Value> getRecord(const RecordSchema&, bool& fits);
     v8::Local<v8::Value> getRawValue(bool* isValue);
+    bool tokenize();
     void makeError(int pos = -1, const BaseBuffer* cause=NULL);
+
+    enum {
+      ERROR_EXCERPT_SIZE = 80 // chars on either side of pos
+    };
+
+    inline size_t memorySize() const {
+      return source.memorySize() + tape_.memorySize() + diff_.memorySize() + errorMsg_.memorySize() +
+        vectorMemory(tokenKinds_) + vectorMemory(tokenStarts_) + vectorMemory(tokenEnds_) +
+        vectorMemory(recordStarts_) + vectorMemory(recordEnds_) + vectorMemory(customArgs_) +
+        transcoded_.memorySize() + wsonWriter_.memorySize() + jsonWriter_.memorySize() + jsonReader_.memorySize() +
+        vectorMemory(transcodedBytes_);
+    }
+
+    inline void trim(size_t maxSize) {
+      source.trim(maxSize);
+      tape_.trim(maxSize);
+      diff_.trim(maxSize);
+      errorMsg_.trim(maxSize);
+      trimVector(tokenKinds_, maxSize);
+      trimVector(tokenStarts_, maxSize);
+      trimVector(tokenEnds_, maxSize);
+      trimVector(recordStarts_, maxSize);
+      trimVector(recordEnds_, maxSize);
+      trimVector(customArgs_, maxSize);
+      transcoded_.trim(maxSize);
+      wsonWriter_.trim(maxSize);
+      jsonWriter_.trim(maxSize);
+      jsonReader_.trim(maxSize);
+      trimVector(transcodedBytes_, maxSize);
+    }
+
   private:
     Parser& parser_;
     SourceBuffer source;
     bool hasError;
+    bool excerptErrors_; // the source may exceed a v8 string
     v8::Local<v8::Value> error;
-    Nan::Callback* backrefCb;
+    v8::Local<v8::Function> backrefCb; // empty: none
+    v8::Local<v8::Array> backrefArray; // empty: none
+    uint32_t backrefArrayLength_;
+    TargetBuffer errorMsg_; // scratch
+    const ParseProjection* projection_; // for the object at hand, NULL: all
+    ParserTape tape_; // for validating
+    TapeDiff diff_;
+    std::vector<uint8_t> tokenKinds_;
+    std::vector<uint32_t> tokenStarts_;
+    std::vector<uint32_t> tokenEnds_;
+    indexVector recordStarts_; // of splitRecords and parseRecords
+    indexVector recordEnds_;
+    std::vector<v8::Local<v8::Value> > customArgs_; // of the custom values being parsed, innermost last
+    TargetBuffer transcoded_; // of toJSON, fromJSON and canonicalize
+    WsonWriter wsonWriter_; // sorting keys
+    JsonWriter jsonWriter_;
+    JsonReader<WsonWriter> jsonReader_;
+    std::vector<char> transcodedBytes_;
 };
 
 
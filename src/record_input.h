@@ -0,0 +1,92 @@
+#ifndef WSON_RECORD_INPUT_H_
+#define WSON_RECORD_INPUT_H_
+
+#include "buffer_handles.h"
+#include "core/record_splitter.h"
+
+// The text of splitRecords and parseRecords: a string, read window by window, or UTF-8 bytes, used in place.
+// Positions are chars for strings and bytes for bytes.
+class RecordInput {
+  public:
+    RecordInput(): bytes_(NULL), length_(0), windowBegin_(0) {}
+
+    // false if input is neither a string nor an ArrayBufferView, or too long for 32-bit positions
+    bool init(v8::Local<v8::Value> input) {
+      if (input->IsString()) {
+        string_ = input.As<v8::String>();
+        length_ = string_->Length();
+      } else if (input->IsArrayBufferView()) {
+        v8::Local<v8::ArrayBufferView> view = input.As<v8::ArrayBufferView>();
+        bytes_ = static_cast<const uint8_t*>(view->Buffer()->GetBackingStore()->Data()) + view->ByteOffset();
+        length_ = view->ByteLength();
+      } else {
+        return false;
+      }
+      if (length_ > UINT32_MAX) {
+        return false;
+      }
+      window_.clear();
+      windowBegin_ = 0;
+      return true;
+    }
+
+    inline size_t length() const {
+      return length_;
+    }
+
+    // Finds up to maxCount records (0: no limit) from pos on, see splitRecords; for a string only
+    // those in the window read (which is kept for load()), so the caller has to go on from the result.
+    size_t split(size_t pos, bool more, size_t maxCount, indexVector& starts, indexVector& ends) {
+      if (bytes_) {
+        return splitRecords(bytes_, pos, length_, more, maxCount, starts, ends);
+      }
+      size_t oldSize = starts.size();
+      size_t windowSize = WINDOW_SIZE;
+      while (true) {
+        size_t windowLength = std::min(windowSize, length_ - pos);
+        bool isLast = pos + windowLength == length_;
+        readWindow(pos, windowLength);
+        size_t next = splitRecords(window_.data(), 0, windowLength, more || !isLast, maxCount, starts, ends);
+        if (next > 0 || isLast) {
+          for (size_t i = oldSize; i < starts.size(); ++i) {
+            starts[i] += pos;
+            ends[i] += pos;
+          }
+          return pos + next;
+        }
+        windowSize *= 2; // a record longer than the window
+      }
+    }
+
+    // Puts the chars of a record found by split() into source and starts on them.
+    void load(SourceBuffer& source, size_t begin, size_t end) {
+      TraceSpan span("wson.copy");
+      source.clear();
+      if (bytes_) {
+        source.appendUtf8(bytes_ + begin, end - begin);
+        source.init();
+      } else {
+        source.init(window_.data() + begin - windowBegin_, end - begin);
+      }
+    }
+
+  private:
+    enum {
+      WINDOW_SIZE = 1 << 16 // chars
+    };
+
+    void readWindow(size_t begin, size_t length) {
+      TraceSpan span("wson.copy");
+      window_.resize(length);
+      string_->Write(v8::Isolate::GetCurrent(), window_.data(), begin, length, v8::String::NO_NULL_TERMINATION);
+      windowBegin_ = begin;
+    }
+
+    v8::Local<v8::String> string_;
+    const uint8_t* bytes_;
+    size_t length_;
+    usc2vector window_;
+    size_t windowBegin_;
+};
+
+#endif // WSON_RECORD_INPUT_H_
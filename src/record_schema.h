@@ -0,0 +1,167 @@
+#ifndef WSON_RECORD_SCHEMA_H_
+#define WSON_RECORD_SCHEMA_H_
+
+#include "buffer_handles.h"
+#include <algorithm>
+
+// A fixed record shape (compileSchema): its keys in output order, already escaped,
+// and what their values are expected to be.
+class RecordSchema {
+  public:
+    enum Kind {
+      K_ANY,
+      K_STRING,
+      K_NUMBER,
+      K_BOOLEAN
+    };
+
+    struct Field {
+      Nan::Persistent<v8::String> key;
+      usc2vector rawKey;
+      TargetBuffer escapedKey; // as written, "#" for ""
+      int64_t index; // of an index key ("1"), which GetOwnPropertyNames gives as a number; -1 for others
+      Kind kind;
+
+      ~Field() {
+        key.Reset();
+      }
+    };
+
+    RecordSchema(void* o): owner(o), trustKeys(false) {}
+
+    ~RecordSchema() {
+      fn_.Reset();
+      for (std::vector<Field*>::iterator it=fields.begin(); it != fields.end(); ++it) {
+        delete *it;
+      }
+    }
+
+    // spec: {key: 'string' | 'number' | 'boolean' | 'any'}; false for another kind
+    bool compile(v8::Local<v8::Object> spec, v8::Local<v8::Value> options) {
+      const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+      if (options->IsObject()) {
+        trustKeys = options.As<v8::Object>()->Get(context, Nan::New("trustKeys").ToLocalChecked()).ToLocalChecked()->IsTrue();
+      }
+      v8::Local<v8::Array> keys = spec->GetOwnPropertyNames(context).ToLocalChecked();
+      uint32_t len = keys->Length();
+      for (uint32_t i=0; i<len; ++i) {
+        v8::Local<v8::Value> keyValue = keys->Get(context, i).ToLocalChecked();
+        v8::Local<v8::String> key = Nan::To<v8::String>(keyValue).ToLocalChecked();
+        Field* field = new Field();
+        fields.push_back(field);
+        if (!parseKind(spec->Get(context, keyValue).ToLocalChecked(), field->kind)) {
+          return false;
+        }
+        field->key.Reset(key);
+        appendHandle(field->escapedKey, key);
+        field->rawKey = field->escapedKey.getBuffer();
+        field->index = indexOf(field->rawKey);
+        field->escapedKey.clear();
+        if (field->rawKey.empty()) {
+          field->escapedKey.push('#');
+        } else {
+          field->escapedKey.appendEscaped(field->rawKey);
+        }
+      }
+      std::sort(fields.begin(), fields.end(), FieldLess());
+      lastOrder_.assign(len, 0);
+      return true;
+    }
+
+    // the index of the field of key, -1 for none; pos: the position of key in its object
+    inline int findField(v8::Local<v8::Value> key, size_t pos) {
+      size_t guess = lastOrder_[pos]; // records tend to come with their keys in the same order
+      if (key->IsUint32()) {
+        int64_t index = key.As<v8::Uint32>()->Value();
+        if (fields[guess]->index == index) {
+          return guess;
+        }
+        for (size_t i=0; i<fields.size(); ++i) {
+          if (fields[i]->index == index) {
+            lastOrder_[pos] = i;
+            return i;
+          }
+        }
+        return -1;
+      }
+      if (!key->IsString()) {
+        key = Nan::To<v8::String>(key).ToLocalChecked(); // a larger integer
+      }
+      if (Nan::New(fields[guess]->key) == key) {
+        return guess;
+      }
+      for (size_t i=0; i<fields.size(); ++i) {
+        v8::Local<v8::String> fieldKey = Nan::New(fields[i]->key);
+        if (fieldKey == key || fieldKey->StrictEquals(key)) {
+          lastOrder_[pos] = i;
+          return i;
+        }
+      }
+      return -1;
+    }
+
+    // Lets the schema go with fn, the function compiled of it (which keeps the owner alive).
+    void bind(v8::Local<v8::Function> fn) {
+      fn_.Reset(fn);
+      fn_.SetWeak(this, collected, Nan::WeakCallbackType::kParameter);
+    }
+
+    static inline bool hasKind(v8::Local<v8::Value> value, Kind kind) {
+      switch (kind) {
+        case K_STRING:
+          return value->IsString();
+        case K_NUMBER:
+          return value->IsNumber();
+        case K_BOOLEAN:
+          return value->IsBoolean();
+        default:
+          return true;
+      }
+    }
+
+    void* owner; // the Stringifier or Parser, kept alive by the compiled function
+    bool trustKeys; // records have no other keys: the stringifier does not enumerate them
+    std::vector<Field*> fields; // by key, as StringifierTarget sorts them
+
+  private:
+    struct FieldLess {
+      bool operator()(const Field* a, const Field* b) const {
+        return a->rawKey < b->rawKey;
+      }
+    };
+
+    // the array index key is the text of, -1 for none
+    static int64_t indexOf(const usc2vector& key) {
+      if (key.empty() || key.size() > 10 || (key[0] == '0' && key.size() > 1)) {
+        return -1;
+      }
+      int64_t index = 0;
+      for (size_t i=0; i<key.size(); ++i) {
+        if (key[i] < '0' || key[i] > '9') {
+          return -1;
+        }
+        index = index * 10 + (key[i] - '0');
+      }
+      return index < 0xffffffff ? index : -1;
+    }
+
+    static bool parseKind(v8::Local<v8::Value> name, Kind& kind) {
+      static const char* names[] = {"any", "string", "number", "boolean"};
+      for (int k=K_ANY; k<=K_BOOLEAN; ++k) {
+        if (name->StrictEquals(Nan::New(names[k]).ToLocalChecked())) {
+          kind = static_cast<Kind>(k);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    static void collected(const Nan::WeakCallbackInfo<RecordSchema>& data) {
+      delete data.GetParameter();
+    }
+
+    std::vector<size_t> lastOrder_;
+    Nan::Persistent<v8::Function> fn_; // weak
+};
+
+#endif // WSON_RECORD_SCHEMA_H_
@@ -0,0 +1,69 @@
+#ifndef WSON_RETENTION_H_
+#define WSON_RETENTION_H_
+
+#include "types.h"
+#include <algorithm>
+#include <climits>
+
+// How much native memory a Stringifier or Parser keeps between calls (options.retention).
+struct Retention {
+  enum {
+    DEFAULT_MAX_BUFFER_SIZE = 1 << 20,
+    DEFAULT_MAX_POOL_SIZE = 4
+  };
+
+  size_t maxBufferSize; // bytes; larger buffers are given back after a call
+  size_t maxPoolSize;   // #pooled parse states
+
+  Retention():
+    maxBufferSize(DEFAULT_MAX_BUFFER_SIZE),
+    maxPoolSize(DEFAULT_MAX_POOL_SIZE)
+  {}
+
+  void configure(v8::Local<v8::Object> options) {
+    const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+    v8::Local<v8::Value> retentionValue = options->Get(context, Nan::New("retention").ToLocalChecked()).ToLocalChecked();
+    if (!retentionValue->IsObject()) {
+      return;
+    }
+    v8::Local<v8::Object> retention = retentionValue.As<v8::Object>();
+    v8::Local<v8::Value> value = retention->Get(context, Nan::New("maxBufferSize").ToLocalChecked()).ToLocalChecked();
+    if (value->IsNumber()) {
+      maxBufferSize = toSize(value);
+    }
+    value = retention->Get(context, Nan::New("maxPoolSize").ToLocalChecked()).ToLocalChecked();
+    if (value->IsNumber()) {
+      maxPoolSize = toSize(value);
+    }
+  }
+};
+
+// The native memory of an owner, as told to v8.
+class ExternalMemory {
+  public:
+    ExternalMemory(): reported_(0) {}
+
+    ~ExternalMemory() {
+      update(0);
+    }
+
+    inline size_t size() const {
+      return reported_;
+    }
+
+    inline void update(size_t size) {
+      // AdjustExternalMemory takes an int: a larger change goes in steps
+      int64_t change = static_cast<int64_t>(size) - static_cast<int64_t>(reported_);
+      while (change != 0) {
+        int step = static_cast<int>(std::max<int64_t>(std::min<int64_t>(change, INT_MAX), -INT_MAX));
+        Nan::AdjustExternalMemory(step);
+        change -= step;
+      }
+      reported_ = size;
+    }
+
+  private:
+    size_t reported_;
+};
+
+#endif // WSON_RETENTION_H_
@@ -1,8 +1,18 @@
 #include "stringifier.h"
 
-Stringifier::Stringifier(v8::Local<v8::Function> errorClass, v8::Local<v8::Object> options): st_(*this) {
+Stringifier::Stringifier(AddonData* addon, v8::Local<v8::Function> errorClass, v8::Local<v8::Object> options):
+  addon_(addon),
+  st_(*this),
+  externalStringThreshold_(0)
+{
   const v8::Local<v8::Context> context = Nan::GetCurrentContext();
   errorClass_.Reset(errorClass);
+  retention_.configure(options);
+  st_.memo.configure(options);
+  v8::Local<v8::Value> thresholdValue = options->Get(context, Nan::New("externalStringThreshold").ToLocalChecked()).ToLocalChecked();
+  if (thresholdValue->IsNumber()) {
+    externalStringThreshold_ = toSize(thresholdValue);
+  }
   v8::Local<v8::Value> conDefsValue = options->Get(context, Nan::New("connectors").ToLocalChecked()).ToLocalChecked();
   if (conDefsValue->IsObject()) {
     v8::Local<v8::Object> conDefs = conDefsValue.As<v8::Object>();
@@ -15,12 +25,14 @@ Stringifier::Stringifier(v8::Local<v8::Function> errorClass, v8::Local<v8::Objec
       StringifyConnector* connector = new StringifyConnector();
       connector->self.Reset(conDef);
       connector->by.Reset(
-        conDef->Get(context, Nan::New(sBy)).ToLocalChecked().As<v8::Function>()
-      );
-      connector->split.Reset(
-        conDef->Get(context, Nan::New(sSplit)).ToLocalChecked().As<v8::Function>()
+        conDef->Get(context, Nan::New(addon_->sBy)).ToLocalChecked().As<v8::Function>()
       );
-      connector->name.appendHandleEscaped(name);
+      v8::Local<v8::Value> split = conDef->Get(context, Nan::New(addon_->sSplit)).ToLocalChecked();
+      if (split->IsFunction()) {
+        connector->split.Reset(split.As<v8::Function>());
+      }
+      connector->native = wsonNativeConnectorOf(conDef->Get(context, Nan::New(addon_->sNative)).ToLocalChecked());
+      appendHandleEscaped(connector->name, name);
       connectors_[i] = connector;
     }
   }
@@ -35,12 +47,6 @@ Stringifier::~Stringifier() {
   connectors_.clear();
 };
 
-Nan::Persistent<v8::Function> Stringifier::constructor;
-Nan::Persistent<v8::String> Stringifier::sBy;
-Nan::Persistent<v8::String> Stringifier::sSplit;
-Nan::Persistent<v8::String> Stringifier::sConstructor;
-Nan::Persistent<v8::Function> Stringifier::objectConstructor;
-
 NAN_METHOD(Stringifier::New) {
   Nan::HandleScope();
   if (info.Length() < 1 || !(info[0]->IsFunction())) {
@@ -51,14 +57,15 @@ NAN_METHOD(Stringifier::New) {
   }
   v8::Local<v8::Function> errorClass = info[0].As<v8::Function>();
   v8::Local<v8::Object> options = info[1].As<v8::Object>();
+  AddonData* addon = AddonData::fromData(info.Data());
   if (info.IsConstructCall()) {
-    Stringifier* obj = new Stringifier(errorClass, options);
+    Stringifier* obj = new Stringifier(addon, errorClass, options);
     obj->Wrap(info.This());
     info.GetReturnValue().Set(info.This());
   } else {
     const int argc = 2;
     v8::Local<v8::Value> argv[argc] = {errorClass, options};
-    v8::Local<v8::Function> cons = Nan::New<v8::Function>(constructor);
+    v8::Local<v8::Function> cons = Nan::New<v8::Function>(addon->stringifierConstructor);
     // info.GetReturnValue().Set(cons->NewInstance(argc, argv));
     Nan::MaybeLocal<v8::Object> result = Nan::NewInstance(cons, argc, argv);
     if (!result.IsEmpty()) {
@@ -74,9 +81,13 @@ NAN_METHOD(Stringifier::Escape) {
     return Nan::ThrowTypeError("First argument should be a string");
   }
   v8::Local<v8::String> s = info[0].As<v8::String>();
-  // Stringifier* self = node::ObjectWrap::Unwrap<Stringifier>(info.This());
-  target.appendHandleEscaped(s);
-  info.GetReturnValue().Set(target.getHandle());
+  Stringifier* self = node::ObjectWrap::Unwrap<Stringifier>(info.This());
+  OpTimer timer(self->stats_, "wson.escape");
+  appendHandleEscaped(target, s);
+  self->stats_.outputLength += target.size();
+  self->stats_.escapes += target.takeEscapes();
+  self->stats_.bufferGrows += target.takeGrows();
+  info.GetReturnValue().Set(getHandle(target));
 }
 
 
@@ -90,13 +101,12 @@ NAN_METHOD(Stringifier::GetTypeid) {
 }
 
 
-NAN_METHOD(Stringifier::Stringify) {
-  Nan::HandleScope();
-  Stringifier* self = node::ObjectWrap::Unwrap<Stringifier>(info.This());
+void Stringifier::stringify(const Nan::FunctionCallbackInfo<v8::Value>& info, Stringifier* self, RecordSchema* schema) {
   StringifierTarget &st = self->st_;
   if (info.Length() < 1) {
     return Nan::ThrowTypeError("Missing first argument");
   }
+  OpTimer timer(self->stats_, "wson.stringify");
 
   Nan::Callback *haverefCb = NULL;
   if (info.Length() >= 2 && (info[1]->IsFunction())) {
@@ -105,13 +115,119 @@ NAN_METHOD(Stringifier::Stringify) {
   }
 
   st.clear(haverefCb);
-  st.put(info[0]);
+  if (info.Length() >= 2 && info[1]->IsArray()) {
+    st.externalRefs.assign(info[1].As<v8::Array>());
+  }
+  if (!schema) {
+    st.put(info[0]);
+  } else if (!st.putRecord(info[0], *schema)) {
+    ++self->stats_.schemaFallbacks;
+    st.put(info[0]);
+  }
+  self->stats_.outputLength += st.target.size();
+  self->stats_.escapes += st.target.takeEscapes();
+  self->stats_.bufferGrows += st.target.takeGrows();
+  if (!st.error.IsEmpty()) {
+    delete haverefCb;
+    ++self->stats_.errors;
+    return Nan::ThrowError(st.error);
+  }
 
-  v8::Local<v8::Value> result = st.target.getHandle();
+  v8::Local<v8::Value> result;
+  {
+    TraceSpan span("wson.result");
+    if (self->externalStringThreshold_ && st.target.size() >= self->externalStringThreshold_) {
+      result = takeExternalHandle(st.target);
+    } else {
+      result = getHandle(st.target);
+    }
+  }
+  st.trim(self->retention_.maxBufferSize);
+  self->memory_.update(st.memorySize());
   delete haverefCb;
   info.GetReturnValue().Set(result);
 }
 
+NAN_METHOD(Stringifier::Stringify) {
+  Nan::HandleScope();
+  stringify(info, node::ObjectWrap::Unwrap<Stringifier>(info.This()), NULL);
+}
+
+// Returns a stringify function for records of the shape given by the spec.
+NAN_METHOD(Stringifier::CompileSchema) {
+  Nan::HandleScope();
+  if (info.Length() < 1 || !(info[0]->IsObject())) {
+    return Nan::ThrowTypeError("First argument should be a schema object");
+  }
+  Stringifier* self = node::ObjectWrap::Unwrap<Stringifier>(info.This());
+  RecordSchema* schema = new RecordSchema(self);
+  if (!schema->compile(info[0].As<v8::Object>(), info[1])) {
+    delete schema;
+    return Nan::ThrowTypeError("Schema kinds should be 'string', 'number', 'boolean' or 'any'");
+  }
+  v8::Local<v8::Function> fn = Nan::New<v8::Function>(StringifyRecord, Nan::New<v8::External>(schema)); // not from a template, that would keep it for good
+  Nan::SetPrivate(fn, Nan::New("wson:owner").ToLocalChecked(), info.This()); // keeps the owner alive
+  schema->bind(fn);
+  info.GetReturnValue().Set(fn);
+}
+
+NAN_METHOD(Stringifier::StringifyRecord) {
+  Nan::HandleScope();
+  RecordSchema* schema = static_cast<RecordSchema*>(info.Data().As<v8::External>()->Value());
+  stringify(info, static_cast<Stringifier*>(schema->owner), schema);
+}
+
+// Writes the WSON of x to the file at path as UTF-8, chunk by chunk, and returns the #bytes written.
+NAN_METHOD(Stringifier::StringifyToFile) {
+  Nan::HandleScope();
+  if (info.Length() < 1 || !(info[0]->IsString())) {
+    return Nan::ThrowTypeError("First argument should be a path");
+  }
+  if (info.Length() < 2) {
+    return Nan::ThrowTypeError("Missing second argument");
+  }
+  Nan::Utf8String path(info[0]);
+  Stringifier* self = node::ObjectWrap::Unwrap<Stringifier>(info.This());
+  StringifierTarget &st = self->st_;
+  OpTimer timer(self->stats_, "wson.stringifyToFile");
+
+  FileSink sink;
+  int err = sink.open(*path);
+  if (err) {
+    ++self->stats_.errors;
+    return Nan::ThrowError(node::UVException(v8::Isolate::GetCurrent(), err, "open", NULL, *path));
+  }
+  Nan::Callback *haverefCb = NULL;
+  if (info.Length() >= 3 && (info[2]->IsFunction())) {
+    haverefCb = new Nan::Callback(info[2].As<v8::Function>());
+  }
+
+  st.clear(haverefCb);
+  if (info.Length() >= 3 && info[2]->IsArray()) {
+    st.externalRefs.assign(info[2].As<v8::Array>());
+  }
+  st.sink = &sink;
+  st.put(info[1]);
+  sink.take(st.target, true);
+  st.sink = NULL;
+  err = sink.close();
+  self->stats_.outputLength += sink.chars();
+  self->stats_.escapes += st.target.takeEscapes();
+  self->stats_.bufferGrows += st.target.takeGrows();
+  st.trim(self->retention_.maxBufferSize);
+  self->memory_.update(st.memorySize());
+  delete haverefCb;
+  if (!st.error.IsEmpty()) {
+    ++self->stats_.errors;
+    return Nan::ThrowError(st.error);
+  }
+  if (err) {
+    ++self->stats_.errors;
+    return Nan::ThrowError(node::UVException(v8::Isolate::GetCurrent(), err, "write", NULL, *path));
+  }
+  info.GetReturnValue().Set(Nan::New<v8::Number>(sink.bytes()));
+}
+
 NAN_METHOD(Stringifier::ConnectorOfValue) {
   Nan::HandleScope();
   if (info.Length() < 1) {
@@ -131,26 +247,55 @@ NAN_METHOD(Stringifier::ConnectorOfValue) {
   info.GetReturnValue().Set(result);
 }
 
-void Stringifier::Init(v8::Local<v8::Object> exports) {
+NAN_METHOD(Stringifier::GetStats) {
+  Nan::HandleScope();
+  Stringifier* self = node::ObjectWrap::Unwrap<Stringifier>(info.This());
+  const OpStats& stats = self->stats_;
+  v8::Local<v8::Object> result = stats.newObject();
+  OpStats::set(result, "outputLength", stats.outputLength);
+  OpStats::set(result, "escapes", stats.escapes);
+  OpStats::set(result, "haverefCbCalls", stats.refCbCalls);
+  OpStats::set(result, "split", stats.split);
+  OpStats::set(result, "memoHits", stats.memoHits);
+  OpStats::set(result, "memoStores", stats.memoStores);
+  OpStats::set(result, "schemaFallbacks", stats.schemaFallbacks);
+  OpStats::set(result, "retainedBytes", self->memory_.size());
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(Stringifier::ResetStats) {
+  Nan::HandleScope();
+  Stringifier* self = node::ObjectWrap::Unwrap<Stringifier>(info.This());
+  self->stats_.reset();
+}
+
+NAN_METHOD(Stringifier::Trim) {
+  Nan::HandleScope();
+  Stringifier* self = node::ObjectWrap::Unwrap<Stringifier>(info.This());
+  self->st_.trim(0);
+  self->st_.memo.clear();
+  self->memory_.update(self->st_.memorySize());
+}
+
+void Stringifier::Init(v8::Local<v8::Object> exports, AddonData* addon) {
   Nan::HandleScope();
   const v8::Local<v8::Context> context = Nan::GetCurrentContext();
 
-  v8::Local<v8::FunctionTemplate> newTpl = Nan::New<v8::FunctionTemplate>(New);
+  v8::Local<v8::FunctionTemplate> newTpl = Nan::New<v8::FunctionTemplate>(New, addon->newExternal());
   newTpl->SetClassName(Nan::New("Stringifier").ToLocalChecked());
   newTpl->InstanceTemplate()->SetInternalFieldCount(1);
 
   Nan::SetPrototypeMethod(newTpl, "escape", Escape);
   Nan::SetPrototypeMethod(newTpl, "getTypeid", GetTypeid);
   Nan::SetPrototypeMethod(newTpl, "stringify", Stringify);
+  Nan::SetPrototypeMethod(newTpl, "compileSchema", CompileSchema);
+  Nan::SetPrototypeMethod(newTpl, "stringifyToFile", StringifyToFile);
   Nan::SetPrototypeMethod(newTpl, "connectorOfValue", ConnectorOfValue);
+  Nan::SetPrototypeMethod(newTpl, "getStats", GetStats);
+  Nan::SetPrototypeMethod(newTpl, "resetStats", ResetStats);
+  Nan::SetPrototypeMethod(newTpl, "trim", Trim);
 
-  constructor.Reset(newTpl->GetFunction(context).ToLocalChecked());
-  sBy.Reset(Nan::New("by").ToLocalChecked());
-  sSplit.Reset(Nan::New("split").ToLocalChecked());
-  sConstructor.Reset(Nan::New("constructor").ToLocalChecked());
-  objectConstructor.Reset(
-    Nan::New<v8::Object>()->Get(context, Nan::New(sConstructor)).ToLocalChecked().As<v8::Function>()
-  );
+  addon->stringifierConstructor.Reset(newTpl->GetFunction(context).ToLocalChecked());
 
   exports->Set(context, Nan::New("Stringifier").ToLocalChecked(), newTpl->GetFunction(context).ToLocalChecked()).ToChecked();
 
@@ -2,6 +2,8 @@
 #define WSON_STINGIFIER_H_
 
 #include "stringifier_target.h"
+#include "op_stats.h"
+#include "addon_data.h"
 
 enum {
   TI_FAIL      = 0,
@@ -18,10 +20,10 @@ enum {
 class Stringifier: public node::ObjectWrap {
   public:
     friend class StringifierTarget;
-    static void Init(v8::Local<v8::Object>);
+    static void Init(v8::Local<v8::Object>, AddonData*);
 
   private:
-    Stringifier(v8::Local<v8::Function>, v8::Local<v8::Object>);
+    Stringifier(AddonData*, v8::Local<v8::Function>, v8::Local<v8::Object>);
     ~Stringifier();
 
     struct StringifyConnector {
@@ -29,6 +31,7 @@ class Stringifier: public node::ObjectWrap {
       Nan::Persistent<v8::Function> by;
       Nan::Persistent<v8::Function> split;
       TargetBuffer name;
+      const WsonNativeConnector* native; // its split, if any, stands in for the one above
 
       ~StringifyConnector() {
         self.Reset();
@@ -39,31 +42,40 @@ class Stringifier: public node::ObjectWrap {
 
     inline static int getTypeid(v8::Local<v8::Value> x);
     inline const StringifyConnector* findConnector(v8::Local<v8::Object>) const;
-
-    static Nan::Persistent<v8::Function> constructor;
-    static Nan::Persistent<v8::String> sBy;
-    static Nan::Persistent<v8::String> sSplit;
-    static Nan::Persistent<v8::String> sConstructor;
-    static Nan::Persistent<v8::Function> objectConstructor;
+    static void stringify(const Nan::FunctionCallbackInfo<v8::Value>&, Stringifier*, RecordSchema*);
 
     static NAN_METHOD(New);
     static NAN_METHOD(Escape);
     static NAN_METHOD(GetTypeid);
     static NAN_METHOD(Stringify);
+    static NAN_METHOD(CompileSchema);
+    static NAN_METHOD(StringifyRecord);
+    static NAN_METHOD(StringifyToFile);
     static NAN_METHOD(ConnectorOfValue);
+    static NAN_METHOD(GetStats);
+    static NAN_METHOD(ResetStats);
+    static NAN_METHOD(Trim);
 
     typedef std::vector<StringifyConnector*> ConnectorVector;
 
+    AddonData* addon_;
     Nan::Persistent<v8::Function> errorClass_;
     ConnectorVector connectors_;
     StringifierTarget st_;
+    OpStats stats_;
+    Retention retention_;
+    ExternalMemory memory_;
+    size_t externalStringThreshold_; // results of at least that many chars become external strings, 0: none
 };
 
 const Stringifier::StringifyConnector* Stringifier::findConnector(v8::Local<v8::Object> x) const {
-  v8::Local<v8::Value> constructor = x->Get(Nan::GetCurrentContext(), Nan::New(sConstructor)).ToLocalChecked();
+  if (connectors_.empty()) {
+    return NULL;
+  }
+  v8::Local<v8::Value> constructor = x->Get(Nan::GetCurrentContext(), Nan::New(addon_->sConstructor)).ToLocalChecked();
   if (constructor->IsFunction()) {
     v8::Local<v8::Value> constructorF = constructor.As<v8::Function>();
-    if (constructorF != Nan::New(objectConstructor)) {
+    if (constructorF != Nan::New(addon_->objectConstructor)) {
       for (ConnectorVector::const_iterator it=connectors_.begin(); it != connectors_.end(); ++it) {
         // std::cout << "findConnector" << std::endl;
         if (Nan::New((*it)->by) == constructorF) {
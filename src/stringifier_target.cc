@@ -9,7 +9,7 @@ void StringifierTarget::putText(v8::Local<v8::String> s) {
   if (s->Length() == 0) {
     target.push('#');
   } else {
-    target.appendHandleEscaped(s);
+    appendHandleEscaped(target, s);
   }
 }
 void StringifierTarget::putText(const usc2vector& buffer, size_t start, size_t length) {
@@ -20,15 +20,29 @@ void StringifierTarget::putText(const usc2vector& buffer, size_t start, size_t l
   }
 }
 
+void StringifierTarget::putNumber(v8::Local<v8::Value> x) {
+  if (x->IsInt32()) {
+    // as v8 would, without making a string
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", x.As<v8::Int32>()->Value());
+    target.appendAscii(buf);
+  } else {
+    appendHandle(target, Nan::To<v8::String>(x).ToLocalChecked());
+  }
+}
+
 bool StringifierTarget::putBackref(v8::Local<v8::Object> x) {
   handleVector::const_iterator haveIt = std::find(haves.begin(), haves.end(), x);
   size_t idx;
   if (haveIt != haves.end()) {
     idx = haves.end() - haveIt - 1;
+  } else if (externalRefs.find(x, idx)) {
+    idx += haves.size();
   } else if (haverefCb) {
     v8::Local<v8::Value> cbArgv[] = {
       x
     };
+    ++stringifier_.stats_.refCbCalls;
     v8::Local<v8::Value> haveIdx = haverefCb->Call(1, cbArgv);
     if (!haveIdx->IsUint32()) {
       return false;
@@ -37,6 +51,7 @@ bool StringifierTarget::putBackref(v8::Local<v8::Object> x) {
   } else {
     return false;
   }
+  backrefSeen_ = true;
   std::stringstream idxBuf;
   idxBuf << idx;
   target.push('|');
@@ -64,51 +79,69 @@ void StringifierTarget::putValue(v8::Local<v8::Value> x) {
       break;
     case TI_NUMBER:
       target.push('#');
-      target.appendHandle(Nan::To<v8::String>(x).ToLocalChecked());
+      putNumber(x);
       break;
     case TI_DATE:
+      mutableSeen_ = true;
       target.push('#');
       target.push('d');
-      target.appendHandle(Nan::To<v8::String>(Nan::To<v8::Number>(x).ToLocalChecked()).ToLocalChecked());
+      appendHandle(target, Nan::To<v8::String>(Nan::To<v8::Number>(x).ToLocalChecked()).ToLocalChecked());
       break;
     case TI_STRING:
       putText(x.As<v8::String>());
       break;
-    case TI_ARRAY: {
-      if (putBackref(x.As<v8::Object>())) {
-        return;
-      }
-      haves.push_back(x);
-      v8::Local<v8::Array> array = x.As<v8::Array>();
-      uint32_t len = array->Length();
-      target.push('[');
-      for (uint32_t i=0; i<len; ++i) {
-        putValue(array->Get(Nan::GetCurrentContext(), i).ToLocalChecked());
-        if (i + 1 != len) {
-          target.push('|');
-        }
-      }
-      target.push(']');
-      haves.pop_back();
-      break;
-    }
+    case TI_ARRAY:
     case TI_OBJECT: {
       v8::Local<v8::Object> xObj = x.As<v8::Object>();
       if (putBackref(xObj)) {
         return;
       }
-      haves.push_back(x);
+      if (memo.enabled() && !haverefCb && externalRefs.empty()) {
+        putMemoized(xObj, ti);
+      } else {
+        putComposite(xObj, ti);
+      }
+      break;
+    }
+  }
+  if (sink && target.size() >= FLUSH_SIZE) {
+    flush();
+  }
+}
 
-      const Stringifier::StringifyConnector* connector = stringifier_.findConnector(xObj);
-      if (connector) {
-        target.push('[');
-        target.push(':');
-        target.append(connector->name.getBuffer());
+void StringifierTarget::putComposite(v8::Local<v8::Object> x, int ti) {
+  haves.push_back(x);
+  if (ti == TI_ARRAY) {
+    v8::Local<v8::Array> array = x.As<v8::Array>();
+    uint32_t len = array->Length();
+    target.push('[');
+    for (uint32_t i=0; i<len; ++i) {
+      putValue(array->Get(Nan::GetCurrentContext(), i).ToLocalChecked());
+      if (i + 1 != len) {
+        target.push('|');
+      }
+    }
+    target.push(']');
+  } else {
+    const Stringifier::StringifyConnector* connector = stringifier_.findConnector(x);
+    if (connector) {
+      target.push('[');
+      target.push(':');
+      target.append(connector->name.getBuffer());
+      if (connector->native && connector->native->split) {
+        putNativeArgs(x, connector->native);
+      } else {
         const int argc = 1;
         v8::Local<v8::Value> argv[argc] = {x};
         v8::Local<v8::Function> split = Nan::New<v8::Function>(connector->split);
         if (!split.IsEmpty()) {
-          v8::Local<v8::Value> args = split->Call(Nan::GetCurrentContext(), Nan::New<v8::Object>(connector->self), argc, argv).ToLocalChecked();
+          v8::Local<v8::Value> args;
+          {
+            TraceSpan span("wson.split");
+            uint64_t startTime = uv_hrtime();
+            args = split->Call(Nan::GetCurrentContext(), Nan::New<v8::Object>(connector->self), argc, argv).ToLocalChecked();
+            stringifier_.stats_.split.add(startTime);
+          }
           if (!args.IsEmpty() && args->IsArray()) {
             v8::Local<v8::Array> argsArray = args.As<v8::Array>();
             uint32_t len = argsArray->Length();
@@ -118,83 +151,241 @@ void StringifierTarget::putValue(v8::Local<v8::Value> x) {
             }
           }
         }
-        target.push(']');
-      } else {
-        ObjectAdaptor *oa = getOa();
-        oa->putObject(xObj);
-        oa->sort();
-        oa->emit(*this);
-        releaseOa(oa);
       }
-      haves.pop_back();
-      break;
+      target.push(']');
+    } else {
+      ObjectAdaptor *oa = getOa();
+      oa->putObject(x);
+      oa->sort();
+      oa->emit(*this);
+      releaseOa(oa);
     }
   }
+  haves.pop_back();
 }
 
-void StringifierTarget::put(v8::Local<v8::Value> x) {
-  putValue(x);
+void StringifierTarget::putNativeArgs(v8::Local<v8::Object> x, const WsonNativeConnector* native) {
+  size_t argsBegin = customArgs_.size(); // on top of those of enclosing custom values
+  int argc;
+  {
+    TraceSpan span("wson.split");
+    uint64_t startTime = uv_hrtime();
+    Nan::TryCatch tryCatch;
+    int room = STATIC_ARGS_NUM;
+    while (true) {
+      customArgs_.resize(argsBegin + room);
+      argc = native->split(native->data, v8::Isolate::GetCurrent(), x, customArgs_.data() + argsBegin, room);
+      if (argc <= room) {
+        break;
+      }
+      room = argc;
+    }
+    stringifier_.stats_.split.add(startTime);
+    if (argc < 0) {
+      if (error.IsEmpty()) {
+        error = tryCatch.Exception();
+      }
+      argc = 0;
+    }
+  }
+  for (int i=0; i<argc; ++i) {
+    target.push('|');
+    putValue(customArgs_[argsBegin + i]);
+  }
+  customArgs_.resize(argsBegin);
 }
 
-void ObjectAdaptor::putObject(v8::Local<v8::Object> obj) {
-  v8::Local<v8::Array> keys = obj->GetOwnPropertyNames(Nan::GetCurrentContext()).ToLocalChecked();
-  uint32_t len = keys->Length();
-  entries.resize(len);
-  entryIdxs.resize(len);
-  keyBunch.clear();
-  for (uint32_t i=0; i<len; ++i) {
-    entryIdxs[i] = i;
-    Entry& entry = entries[i];
-    v8::Local<v8::Value> key = keys->Get(Nan::GetCurrentContext(), i).ToLocalChecked();
-    v8::Local<v8::String> skey = key->IsString() ? key.As<v8::String>() : Nan::To<v8::String>(key).ToLocalChecked();
-    entry.keyBeginIdx = keyBunch.size();
-    entry.keyLength = skey->Length();
-    entry.value = obj->Get(Nan::GetCurrentContext(), key).ToLocalChecked();
-    keyBunch.appendHandle(skey);
+// A subtree counts as immutable if it is marked, or if it and all composites in it are frozen.
+// Its fragment is only kept without any backrefs: one to the outside depends on the context,
+// one to the inside means a cycle, and the subtree might be spliced below some object of that cycle.
+void StringifierTarget::putMemoized(v8::Local<v8::Object> x, int ti) {
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  bool marked = !memo.marker.IsEmpty() && x->Has(context, Nan::New(memo.marker)).FromMaybe(false);
+  bool frozen = false;
+  if (!marked && memo.frozen) {
+    v8::Local<v8::Value> argv[] = {x};
+    v8::Local<v8::Value> isFrozen;
+    frozen = Nan::New(stringifier_.addon_->objectIsFrozen)->Call(context, Nan::Undefined(), 1, argv).ToLocal(&isFrozen) &&
+      isFrozen->IsTrue();
+  }
+  if (!marked && !frozen) {
+    mutableSeen_ = true;
+    putComposite(x, ti);
+    return;
+  }
+  int hash = x->GetIdentityHash();
+  const usc2vector* fragment = memo.find(x, hash);
+  if (fragment) {
+    ++stringifier_.stats_.memoHits;
+    target.append(*fragment);
+    return;
+  }
+  size_t begin = target.size();
+  size_t flushes = flushes_;
+  bool outerBackrefSeen = backrefSeen_;
+  bool outerMutableSeen = mutableSeen_;
+  backrefSeen_ = false;
+  mutableSeen_ = false;
+  putComposite(x, ti);
+  if (!backrefSeen_ && (marked || !mutableSeen_) && flushes == flushes_) { // else partly flushed
+    if (memo.insert(x, hash, target.getBuffer(), begin, target.size())) {
+      ++stringifier_.stats_.memoStores;
+    }
   }
+  backrefSeen_ = outerBackrefSeen || backrefSeen_;
+  mutableSeen_ = outerMutableSeen || (mutableSeen_ && !marked);
 }
 
-struct OaLess {
-  OaLess(const ObjectAdaptor& oa): oa_(oa) {}
-  const ObjectAdaptor& oa_;
-  bool operator()(size_t idxA, size_t idxB) {
-    const uint16_t* keyData = oa_.keyBunch.getBuffer().data();
-    const ObjectAdaptor::Entry& entryA = oa_.entries[idxA];
-    const ObjectAdaptor::Entry& entryB = oa_.entries[idxB];
-    const uint16_t* itA = keyData + entryA.keyBeginIdx;
-    const uint16_t* itB = keyData + entryB.keyBeginIdx;
-    const uint16_t* endA = itA + entryA.keyLength;
-    const uint16_t* endB = itB + entryB.keyLength;
-    while (itA != endA) {
-      if (itB == endB) {  // B ends -> extra A-tail
-        return false;
+void StringifierTarget::put(v8::Local<v8::Value> x) {
+  putValue(x);
+}
+
+// The fast path of a compiled schema: no key sorting or escaping, no dispatch on typed fields.
+// false (without writing anything) if x does not fit.
+bool StringifierTarget::putRecord(v8::Local<v8::Value> xValue, RecordSchema& schema) {
+  if (!xValue->IsObject() || xValue->IsArray() || xValue->IsDate()) {
+    return false;
+  }
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  v8::Local<v8::Object> x = xValue.As<v8::Object>();
+  if (stringifier_.findConnector(x)) {
+    return false;
+  }
+  size_t len = schema.fields.size();
+  recordValues_.resize(len);
+  if (schema.trustKeys) {
+    // enumerating the keys would cost more than all the rest; extra keys go unnoticed
+    for (size_t i=0; i<len; ++i) {
+      const RecordSchema::Field& field = *schema.fields[i];
+      v8::Local<v8::String> key = Nan::New(field.key);
+      if (!x->HasOwnProperty(context, key).FromMaybe(false)) {
+        return false; // the generic path leaves it out
       }
-      uint16_t cA = *itA++;
-      uint16_t cB = *itB++;
-      if (cA < cB) {
-        return true;
-      } else if (cA > cB) {
+      v8::Local<v8::Value> value = x->Get(context, key).ToLocalChecked();
+      if (!RecordSchema::hasKind(value, field.kind)) {
         return false;
       }
+      recordValues_[i] = value;
     }
-    // A ends;
-    if (itB == endB) {
-      // equal
+  } else {
+    v8::Local<v8::Array> keys = x->GetOwnPropertyNames(context).ToLocalChecked();
+    if (keys->Length() != len) {
       return false;
+    }
+    for (size_t i=0; i<len; ++i) {
+      v8::Local<v8::Value> key = keys->Get(context, i).ToLocalChecked();
+      int fieldIdx = schema.findField(key, i);
+      if (fieldIdx < 0) {
+        return false;
+      }
+      v8::Local<v8::Value> value = x->Get(context, key).ToLocalChecked();
+      if (!RecordSchema::hasKind(value, schema.fields[fieldIdx]->kind)) {
+        return false;
+      }
+      recordValues_[fieldIdx] = value;
+    }
+  }
+
+  if (putBackref(x)) {
+    return true; // an external ref, as the generic path writes it
+  }
+  haves.push_back(x);
+  target.push('{');
+  for (size_t i=0; i<len; ++i) {
+    const RecordSchema::Field& field = *schema.fields[i];
+    v8::Local<v8::Value> value = recordValues_[i];
+    if (i > 0) {
+      target.push('|');
+    }
+    target.append(field.escapedKey.getBuffer());
+    switch (field.kind) {
+      case RecordSchema::K_STRING:
+        target.push(':');
+        putText(value.As<v8::String>());
+        break;
+      case RecordSchema::K_NUMBER:
+        target.push(':');
+        target.push('#');
+        putNumber(value);
+        break;
+      default:
+        if (!value->IsTrue()) {
+          target.push(':');
+          putValue(value);
+        }
+    }
+  }
+  target.push('}');
+  haves.pop_back();
+  return true;
+}
+
+void ExternalRefs::assign(v8::Local<v8::Array> array) {
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  uint32_t len = array->Length();
+  refs_.resize(len);
+  count_ = 0;
+  for (uint32_t i=0; i<len; ++i) {
+    v8::Local<v8::Value> ref = array->Get(context, i).ToLocalChecked();
+    if (ref->IsObject()) {
+      refs_[i] = ref.As<v8::Object>();
+      ++count_;
     } else {
-      // extra B-tail
-      return true;
+      refs_[i] = v8::Local<v8::Object>();
+    }
+  }
+  if (count_ <= MAX_SCAN_NUM) {
+    return;
+  }
+  size_t slotNum = 2 * MAX_SCAN_NUM;
+  while (slotNum < 2 * count_) {
+    slotNum <<= 1;
+  }
+  mask_ = slotNum - 1;
+  slots_.resize(slotNum);
+  memset(slots_.data(), 0, slotNum * sizeof(Slot));
+  for (uint32_t i=0; i<len; ++i) {
+    if (refs_[i].IsEmpty()) {
+      continue;
+    }
+    int hash = refs_[i]->GetIdentityHash();
+    size_t slotIdx = hash & mask_;
+    while (slots_[slotIdx].refIdx && refs_[slots_[slotIdx].refIdx - 1] != refs_[i]) {
+      slotIdx = (slotIdx + 1) & mask_;
+    }
+    if (!slots_[slotIdx].refIdx) { // the first of duplicates wins
+      slots_[slotIdx].hash = hash;
+      slots_[slotIdx].refIdx = i + 1;
     }
   }
-};
+}
 
+void ObjectAdaptor::putObject(v8::Local<v8::Object> obj) {
+  v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  v8::Local<v8::Array> keys = obj->GetOwnPropertyNames(context).ToLocalChecked();
+  uint32_t len = keys->Length();
+  entries.resize(len);
+  keyBunch.clear();
+  for (uint32_t i=0; i<len; ++i) {
+    Entry& entry = entries[i];
+    v8::Local<v8::Value> key = keys->Get(context, i).ToLocalChecked();
+    entry.keyBeginIdx = keyBunch.size();
+    if (key->IsUint32()) {
+      // an index key comes as a number: its digits are written here, without a string
+      uint32_t index = key.As<v8::Uint32>()->Value();
+      keyBunch.appendDecimal(index);
+      entry.value = obj->Get(context, index).ToLocalChecked();
+    } else {
+      v8::Local<v8::String> skey = key->IsString() ? key.As<v8::String>() : Nan::To<v8::String>(key).ToLocalChecked();
+      appendHandle(keyBunch, skey);
+      entry.value = obj->Get(context, key).ToLocalChecked();
+    }
+    entry.keyLength = keyBunch.size() - entry.keyBeginIdx;
+  }
+}
 
 void ObjectAdaptor::sort() {
-  if (entryIdxs.size() > 1) {
-    OaLess oaLess(*this);
-    std::sort(entryIdxs.begin(), entryIdxs.end(), oaLess);
-    // std::swap(entryIdxs[0], entryIdxs[1]);
-  }
+  sorter.sort(keyBunch.getBuffer().data(), entries, entryIdxs);
 }
 
 void ObjectAdaptor::emit(StringifierTarget& st) {
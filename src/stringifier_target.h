@@ -1,7 +1,12 @@
 #ifndef WSON_STINGIFIER_TARGET_H_
 #define WSON_STINGIFIER_TARGET_H_
 
-#include "target_buffer.h"
+#include "buffer_handles.h"
+#include "memo_cache.h"
+#include "record_schema.h"
+#include "file_io.h"
+#include "wson_native_connector.h"
+#include "core/key_order.h"
 #include <algorithm>
 #include <sstream>
 
@@ -12,6 +17,17 @@ class ObjectAdaptor {
     inline void putObject(v8::Local<v8::Object> obj);
     inline void sort();
     inline void emit(StringifierTarget&);
+
+    inline size_t memorySize() const {
+      return keyBunch.memorySize() + vectorMemory(entries) + vectorMemory(entryIdxs) + sorter.memorySize();
+    }
+
+    inline void trim(size_t maxSize) {
+      keyBunch.trim(maxSize);
+      trimVector(entries, maxSize);
+      trimVector(entryIdxs, maxSize);
+      sorter.trim(maxSize);
+    }
   private:
     struct Entry {
       size_t keyBeginIdx;
@@ -21,28 +37,136 @@ class ObjectAdaptor {
     TargetBuffer keyBunch;
     std::vector<Entry> entries;
     std::vector<size_t> entryIdxs;
-    friend struct OaLess;
+    KeySorter sorter;
 };
 
+// The external references of a call: a few are just compared, more are indexed by identity hash.
+class ExternalRefs {
+  public:
+    ExternalRefs(): count_(0), mask_(0) {}
+
+    void assign(v8::Local<v8::Array>);
+    inline bool find(v8::Local<v8::Object> x, size_t& idx) const;
+
+    inline void clear() {
+      refs_.clear();
+      count_ = 0;
+    }
+
+    inline bool empty() const {
+      return count_ == 0;
+    }
+
+    inline size_t memorySize() const {
+      return vectorMemory(refs_) + vectorMemory(slots_);
+    }
+
+    inline void trim(size_t maxSize) {
+      trimVector(refs_, maxSize);
+      trimVector(slots_, maxSize);
+    }
+
+  private:
+    enum {
+      MAX_SCAN_NUM = 8
+    };
+    struct Slot {
+      int hash;
+      uint32_t refIdx; // index + 1, 0 for an empty slot
+    };
+    std::vector<v8::Local<v8::Object> > refs_; // empty for non-objects
+    std::vector<Slot> slots_;
+    size_t count_;
+    size_t mask_;
+};
+
+bool ExternalRefs::find(v8::Local<v8::Object> x, size_t& idx) const {
+  if (count_ == 0) {
+    return false;
+  }
+  if (count_ <= MAX_SCAN_NUM) {
+    for (size_t i=0; i<refs_.size(); ++i) {
+      if (refs_[i] == x) {
+        idx = i;
+        return true;
+      }
+    }
+    return false;
+  }
+  int hash = x->GetIdentityHash();
+  for (size_t slotIdx = hash & mask_; slots_[slotIdx].refIdx; slotIdx = (slotIdx + 1) & mask_) {
+    const Slot& slot = slots_[slotIdx];
+    if (slot.hash == hash && refs_[slot.refIdx - 1] == x) {
+      idx = slot.refIdx - 1;
+      return true;
+    }
+  }
+  return false;
+}
+
 class Stringifier;
 
 class StringifierTarget {
   public:
     friend class Stringifier;
 
-    StringifierTarget(Stringifier& stringifier): stringifier_(stringifier), oaIdx_(0) {}
+    StringifierTarget(Stringifier& stringifier):
+      sink(NULL),
+      stringifier_(stringifier),
+      oaIdx_(0),
+      flushes_(0),
+      backrefSeen_(false),
+      mutableSeen_(false)
+    {}
     inline void putText(v8::Local<v8::String>);
     inline void putText(const usc2vector& buffer, size_t start, size_t length);
     inline bool putBackref(v8::Local<v8::Object> x);
+    inline void putNumber(v8::Local<v8::Value>);
     inline void putValue(v8::Local<v8::Value>);
+    void putComposite(v8::Local<v8::Object>, int ti);
+    void putMemoized(v8::Local<v8::Object>, int ti);
+    void putNativeArgs(v8::Local<v8::Object>, const WsonNativeConnector*);
 
     inline void clear(Nan::Callback* aHaverefCb) {
       target.clear();
       haves.clear();
+      externalRefs.clear();
       haverefCb = aHaverefCb;
+      sink = NULL;
+      error.Clear();
       oaIdx_ = 0;
+      flushes_ = 0;
+      backrefSeen_ = false;
+      mutableSeen_ = false;
     };
     void put(v8::Local<v8::Value>);
+    bool putRecord(v8::Local<v8::Value>, RecordSchema&);
+
+    // Hands the chars so far over to the sink (stringifyToFile).
+    inline void flush() {
+      sink->take(target, false);
+      ++flushes_;
+    }
+
+    inline size_t memorySize() const {
+      size_t size = target.memorySize() + vectorMemory(haves) + vectorMemory(recordValues_) + vectorMemory(customArgs_) +
+        externalRefs.memorySize() + memo.memorySize();
+      for (size_t i=0; i<STATIC_OA_NUM; ++i) {
+        size += oas_[i].memorySize();
+      }
+      return size;
+    }
+
+    inline void trim(size_t maxSize) {
+      target.trim(maxSize);
+      trimVector(haves, maxSize);
+      trimVector(recordValues_, maxSize);
+      trimVector(customArgs_, maxSize);
+      externalRefs.trim(maxSize);
+      for (size_t i=0; i<STATIC_OA_NUM; ++i) {
+        oas_[i].trim(maxSize);
+      }
+    }
 
     static void Init();
 
@@ -50,15 +174,26 @@ class StringifierTarget {
 
     TargetBuffer target;
     handleVector haves;
+    ExternalRefs externalRefs;
+    MemoCache memo;
     Nan::Callback* haverefCb;
+    FileSink* sink; // of stringifyToFile: takes the chars once there are FLUSH_SIZE of them
+    v8::Local<v8::Value> error; // the first one thrown by a native split
 
   private:
     Stringifier& stringifier_;
     enum {
-      STATIC_OA_NUM = 8
+      STATIC_OA_NUM = 8,
+      STATIC_ARGS_NUM = 8, // room for the args of a native split at first
+      FLUSH_SIZE = 1 << 18 // chars
     };
     ObjectAdaptor oas_[STATIC_OA_NUM];
     size_t oaIdx_;
+    size_t flushes_;
+    bool backrefSeen_;
+    bool mutableSeen_; // a composite not frozen or a date
+    handleVector recordValues_; // by field
+    handleVector customArgs_; // of native splits, innermost last
 
     inline ObjectAdaptor* getOa() {
       if (oaIdx_ < STATIC_OA_NUM) {
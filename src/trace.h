@@ -0,0 +1,63 @@
+#ifndef WSON_TRACE_H_
+#define WSON_TRACE_H_
+
+#include "types.h"
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define WSON_USDT 1
+#endif
+#endif
+
+// A phase of a call, e.g. copying the input or a connector callback, seen from outside:
+// - a complete trace event of category "wson" while node records that category
+//   (--trace-event-categories wson, or trace_events.createTracing({ categories: ['wson'] }));
+// - the USDT probes wson:span-begin and wson:span-end, with the name as argument, for perf or bpftrace
+//   (where <sys/sdt.h> was found at build time; a nop while no tracer is attached).
+// Otherwise it costs a load and a branch.
+class TraceSpan {
+  public:
+    inline TraceSpan(const char* name): name_(name), active_(false), handle_(0) {
+#ifdef WSON_USDT
+      DTRACE_PROBE1(wson, span__begin, name);
+#endif
+#ifndef V8_USE_PERFETTO
+      const uint8_t* enabled = categoryEnabled();
+      if (*enabled) {
+        handle_ = controller()->AddTraceEvent('X', enabled, name, NULL, 0, 0, 0, NULL, NULL, NULL, NULL, 0);
+        active_ = true;
+      }
+#endif
+    }
+
+    inline ~TraceSpan() {
+#ifndef V8_USE_PERFETTO
+      if (active_) {
+        controller()->UpdateTraceEventDuration(categoryEnabled(), name_, handle_);
+      }
+#endif
+#ifdef WSON_USDT
+      DTRACE_PROBE1(wson, span__end, name_);
+#endif
+    }
+
+  private:
+    static inline v8::TracingController* controller() {
+      static v8::TracingController* controller = node::GetTracingController();
+      return controller;
+    }
+
+    // the flags of the category, kept up to date by the controller
+    static inline const uint8_t* categoryEnabled() {
+      static const uint8_t disabled = 0;
+      static const uint8_t* enabled = controller() ? controller()->GetCategoryGroupEnabled("wson") : &disabled;
+      return enabled;
+    }
+
+    const char* name_;
+    bool active_;
+    uint64_t handle_;
+};
+
+#endif // WSON_TRACE_H_
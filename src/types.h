@@ -2,26 +2,26 @@
 #define WSON_TYPES_H_
 
 #include <nan.h>
-#include <vector>
-
-typedef std::vector<uint16_t> usc2vector;
-
-enum Ctype {
-  TEXT,
-  OBJECT,
-  ENDOBJECT,
-  ARRAY,
-  ENDARRAY,
-  IS,
-  LITERAL,
-  PIPE,
-  QUOTE,
-  END,
-};
-
-
-#define SYNTAX_ERROR -1
-
+#include "core/types.h"
+
+template<typename A, typename T>
+inline v8::Local<A> newTypedArray(const std::vector<T>& items) {
+  size_t byteLength = items.size() * sizeof(T);
+  v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), byteLength);
+  if (byteLength) {
+    memcpy(buffer->GetBackingStore()->Data(), items.data(), byteLength);
+  }
+  return A::New(buffer, 0, items.size());
+}
+
+// A size given as option: negative and NaN give 0, Infinity (and what does not fit) the largest size.
+inline size_t toSize(v8::Local<v8::Value> value) {
+  double x = Nan::To<double>(value).FromJust();
+  if (!(x > 0)) {
+    return 0;
+  }
+  return x < static_cast<double>(SIZE_MAX) ? static_cast<size_t>(x) : SIZE_MAX;
+}
 
 #endif // WSON_TYPES_H_
 
@@ -30,9 +30,13 @@ export type Creator<T = unknown, A extends AnyArgs = AnyArgs> = (args: A) => T;
 export type Precreator<T = unknown> = () => T;
 export type Postcreator<T = unknown, A extends AnyArgs = AnyArgs> = (x: T, args: A) => T | null | undefined;
 
+// the handle of a WsonNativeConnector of another addon (see include/wson_native_connector.h)
+export type NativeConnector = object;
+
 export interface Connector<T, A extends AnyArgs = AnyArgs> {
   by: Class<T, A>;
-  split: Splitter<T, A>;
+  split?: Splitter<T, A>; // needless with a native split
+  native?: NativeConnector;
   create?: Creator<T, A>;
   precreate?: Precreator<T>;
   postcreate?: Postcreator<T, A>;
@@ -40,8 +44,34 @@ export interface Connector<T, A extends AnyArgs = AnyArgs> {
   hasCreate?: boolean;
 }
 
+export interface Projection {
+  [key: string]: boolean | Projection;
+}
+
+export interface Retention {
+  maxBufferSize?: number; // bytes, default 1 MiB
+  maxPoolSize?: number; // default 4
+}
+
+export interface Memoize {
+  frozen?: boolean; // memoize subtrees that are frozen throughout (no dates)
+  marker?: string | symbol; // memoize subtrees having this property, whatever is inside
+  maxSize?: number; // bytes, default 16 MiB
+}
+
 export interface FactoryOptions {
   connectors?: Record<string, Connector<Value>>;
+  retention?: Retention;
+  memoize?: Memoize;
+  externalStringThreshold?: number; // chars; longer stringify results are handed over as external strings, default 0: never
+}
+
+export type RecordKind = 'string' | 'number' | 'boolean' | 'any';
+
+export type RecordSpec = Record<string, RecordKind>;
+
+export interface SchemaOptions {
+  trustKeys?: boolean; // stringify: records have no keys besides those of the spec, so they are not enumerated
 }
 
 export interface OpOptions {
@@ -49,20 +79,123 @@ export interface OpOptions {
   cb?: PartialCb;
   backrefCb?: BackrefCb;
   haverefCb?: HaverefCb;
+  externalRefs?: Value[]; // instead of haverefCb and backrefCb: backref |idx is externalRefs[idx]
+  projection?: Projection;
+}
+
+interface BaseStats {
+  calls: number;
+  bufferGrows: number;
+  retainedBytes: number;
+  latency: number[]; // #calls by duration: latency[i] for [2^(i-1), 2^i) ns
+}
+
+export interface StringifierStats extends BaseStats {
+  outputLength: number;
+  escapes: number;
+  haverefCbCalls: number;
+  splitCalls: number;
+  splitNanos: number;
+  memoHits: number;
+  memoStores: number;
+  schemaFallbacks: number;
+}
+
+export interface ParserStats extends BaseStats {
+  errors: number;
+  inputLength: number;
+  backrefCbCalls: number;
+  createCalls: number;
+  createNanos: number;
+  precreateCalls: number;
+  precreateNanos: number;
+  postcreateCalls: number;
+  postcreateNanos: number;
+  psPoolSize: number;
+  schemaFallbacks: number;
 }
 
 interface AddonStringifier {
   escape(s: string): string;
-  stringify(x: Value, haverefCb?: HaverefCb | null): string;
+  stringify(x: Value, haverefCbOrExternalRefs?: HaverefCb | Value[] | null): string;
   getTypeid(x: Value): number;
   connectorOfValue<V extends Value>(value: V): Connector<V>;
+  compileSchema(spec: RecordSpec, options?: SchemaOptions): (x: Value, haverefCbOrExternalRefs?: HaverefCb | Value[] | null) => string;
+  stringifyToFile(path: string, x: Value, haverefCbOrExternalRefs?: HaverefCb | Value[] | null): number;
+  getStats(): StringifierStats;
+  resetStats(): void;
+  trim(): void;
+}
+
+export enum TokenKind {
+  TEXT = 0,
+  OBJECT = 1,
+  ENDOBJECT = 2,
+  ARRAY = 3,
+  ENDARRAY = 4,
+  IS = 5,
+  LITERAL = 6,
+  PIPE = 7,
+}
+
+export interface Tokens {
+  kinds: Uint8Array;
+  starts: Uint32Array;
+  ends: Uint32Array;
+}
+
+export interface RecordBounds {
+  starts: Uint32Array;
+  ends: Uint32Array;
+  next: number; // where to go on from, with more input
+}
+
+export interface RecordBatch {
+  values: Value[];
+  next: number;
+}
+
+// thrown by parseFile: s is an excerpt of the text, starting at offset
+export type FileParseError = BaseParseError & { offset: number };
+
+// thrown by parseRecords: the error of the record at index, with the values before it and next at that record
+export type RecordsParseError = BaseParseError & RecordBatch & { index: number };
+
+export type ValidateResult = true | [number, string];
+
+export type DiffPath = (string | number)[]; // keys and indices
+
+export type LazyPath = string | number | (string | number)[];
+
+export interface LazyValue {
+  readonly length: number;
+  get(path: LazyPath): LazyValue | Value;
+  keys(): string[];
+  materialize(): Value;
 }
 
 interface AddonParser {
   unescape(s: string): string;
-  parse(s: string, backrefCb?: BackrefCb | null): Value;
-  parsePartial(s: string, howNext: HowNext, cb: PartialCb, backrefCb?: BackrefCb | null): Value;
+  parse(s: string, backrefCbOrExternalRefs?: BackrefCb | Value[] | null, projection?: Projection | null): Value;
+  parsePartial(s: string, howNext: HowNext, cb: PartialCb, backrefCbOrExternalRefs?: BackrefCb | Value[] | null): Value;
+  parseLazy(s: string, backrefCbOrExternalRefs?: BackrefCb | Value[] | null): LazyValue;
+  tokenize(s: string): Tokens;
+  validate(s: string, externalRefs?: boolean | number): ValidateResult;
+  splitRecords(s: string | ArrayBufferView, more?: boolean): RecordBounds;
+  parseRecords(s: string | ArrayBufferView, start?: number, maxCount?: number, more?: boolean): RecordBatch;
+  parseFile(path: string, backrefCbOrExternalRefs?: BackrefCb | Value[] | null): Value;
+  diff(a: string, b: string, maxPaths?: number): DiffPath[];
+  toJSON(s: string, customPrefix?: string | null): string | undefined;
+  toJSON(s: ArrayBufferView, customPrefix?: string | null): Uint8Array | undefined;
+  fromJSON(json: string, customPrefix?: string | null): string;
+  fromJSON(json: ArrayBufferView, customPrefix?: string | null): Uint8Array;
+  canonicalize(s: string): string;
+  canonicalize(s: ArrayBufferView): Uint8Array;
   connectorOfCname(cname: string): Connector<Value>;
+  compileSchema(spec: RecordSpec): (s: string, backrefCbOrExternalRefs?: BackrefCb | Value[] | null) => Value;
+  getStats(): ParserStats;
+  resetStats(): void;
+  trim(): void;
 }
 
 export interface AddonFactory {
@@ -1,13 +1,18 @@
 #include "stringifier.h"
 #include "parser.h"
+#include "alloc_counter.h"
 
 using v8::FunctionTemplate;
 
 void Init(v8::Local<v8::Object> exports) {
-  Stringifier::Init(exports);
-  Parser::Init(exports);
+  AddonData* addon = new AddonData(v8::Isolate::GetCurrent());
+  Stringifier::Init(exports, addon);
+  Parser::Init(exports, addon);
+#ifdef WSON_COUNT_ALLOCS
+  Nan::SetMethod(exports, "allocCount", AllocCount);
+#endif
 }
 
-NODE_MODULE(wson_addon, Init)
+NAN_MODULE_WORKER_ENABLED(wson_addon, Init)
 
 
@@ -1,5 +1,7 @@
 import _ = require('lodash');
 import { expect } from 'chai';
+
+import { Value } from '../src/types';
 import { safeRepr } from './fixtures/helpers';
 import setups from './fixtures/setups';
 import pairs from './fixtures/stringify-pairs';
@@ -21,8 +23,62 @@ for (const setup of setups) {
           it(`should stringify ${safeRepr(pair.x)} as ${safeRepr(pair.s)} `, () => {
             expect(wson.stringify(pair.x, { haverefCb: pair.haverefCb })).to.be.equal(pair.s);
           });
+          if (pair.externalRefs) {
+            it(`should stringify ${safeRepr(pair.x)} as ${safeRepr(pair.s)} with externalRefs`, () => {
+              expect(wson.stringify(pair.x, { externalRefs: pair.externalRefs })).to.be.equal(pair.s);
+            });
+          }
         }
       }
     });
+    describe('stringify with many externalRefs', () => {
+      const externalRefs: Value[] = [1, 'a', null];
+      for (let i = 0; i < 100; ++i) {
+        externalRefs.push({ i });
+      }
+      externalRefs.push(externalRefs[10]);
+      const haverefCb = (x: Value) => {
+        const idx = externalRefs.indexOf(x);
+        return idx >= 0 ? idx : null;
+      };
+      it('should find them like haverefCb does', () => {
+        const x = [externalRefs[3], { a: externalRefs[102], b: [externalRefs[10]] }, { i: 5 }];
+        const s = wson.stringify(x, { externalRefs });
+        expect(s).to.be.equal(wson.stringify(x, { haverefCb }));
+        expect(s).to.be.equal('[|4|{a:|104|b:[|13]}|{i:#5}]');
+      });
+    });
+    describe('stringify to external strings', () => {
+      const externalWson = wsonFactory({ ...setup.options, externalStringThreshold: 100 });
+      const x = _.range(1000).map((i) => ({ i, s: `a:${i}` }));
+      it('should yield the same as copying', () => {
+        const s = externalWson.stringify(x, {});
+        expect(externalWson.stringify([1, 2], {})).to.be.equal('[#1|#2]');
+        expect(externalWson.stringify(x.slice(1), {})).to.be.equal(wson.stringify(x.slice(1), {}));
+        expect(s).to.be.equal(wson.stringify(x, {})); // not changed by later calls
+      });
+    });
+    describe('stringify wide objects', () => {
+      const expectSorted = (x: Record<string, number>) => {
+        const keys = Object.keys(x).sort();
+        expect(wson.stringify(x, {})).to.be.equal(`{${keys.map((key) => `${key}:#${x[key]}`).join('|')}}`);
+      };
+      it('should sort index keys as text', () => {
+        const x: Record<string, number> = {};
+        for (let i = 0; i < 5000; ++i) {
+          x[(i * 7919) % 100003] = i;
+        }
+        x[4294967295] = -1; // not an index
+        x['12a'] = -2;
+        expectSorted(x);
+      });
+      it('should sort keys of long common prefixes', () => {
+        const x: Record<string, number> = {};
+        for (let i = 0; i < 5000; ++i) {
+          x[`user.${((i * 7919) % 5003).toString(36)}${'é'.repeat(i % 3)}`] = i;
+        }
+        expectSorted(x);
+      });
+    });
   });
 }
@@ -1,6 +1,7 @@
 import _ = require('lodash');
 import { expect } from 'chai';
 
+import { OpOptions } from '../src/types';
 import { safeRepr } from './fixtures/helpers';
 import setups from './fixtures/setups';
 import pairs from './fixtures/stringify-pairs';
@@ -15,24 +16,34 @@ for (const setup of setups) {
         if (s == null) {
           continue;
         }
-        if (pair.parseFailPos != null) {
-          it(`should fail to parse '${s}' at ${pair.parseFailPos}`, () => {
-            let e;
-            try {
-              wson.parse(s, { backrefCb: pair.backrefCb });
-            } catch (someE) {
-              e = someE as ParseError;
-            }
-            if (e == null) {
-              throw new Error('ParseError expected');
-            }
-            expect(e.name).to.be.equal('ParseError');
-            expect(e.pos).to.be.equal(pair.parseFailPos);
-          });
-        } else {
-          it(`should parse '${s}' as ${safeRepr(pair.x)}`, () => {
-            expect(wson.parse(s, { backrefCb: pair.backrefCb })).to.be.deep.equal(pair.x);
-          });
+        const variants: [string, OpOptions][] = [['', { backrefCb: pair.backrefCb }]];
+        if (pair.externalRefs) {
+          variants.push([' with externalRefs', { externalRefs: pair.externalRefs }]);
+        }
+        for (const [suffix, opt] of variants) {
+          if (pair.parseFailPos != null) {
+            it(`should fail to parse '${s}' at ${pair.parseFailPos}${suffix}`, () => {
+              let e;
+              try {
+                wson.parse(s, opt);
+              } catch (someE) {
+                e = someE as ParseError;
+              }
+              if (e == null) {
+                throw new Error('ParseError expected');
+              }
+              expect(e.name).to.be.equal('ParseError');
+              expect(e.pos).to.be.equal(pair.parseFailPos);
+            });
+          } else {
+            it(`should parse '${s}' as ${safeRepr(pair.x)}${suffix}`, () => {
+              const x = wson.parse(s, opt);
+              expect(x).to.be.deep.equal(pair.x);
+              if (pair.externalRefs && pair.externalRefs.includes(pair.x)) {
+                expect(x).to.be.equal(pair.x); // the very object
+              }
+            });
+          }
         }
       }
     });
@@ -0,0 +1,72 @@
+import { expect } from 'chai';
+
+import { LazyValue } from '../src/types';
+import { Point } from './fixtures/extdefs';
+import { safeRepr } from './fixtures/helpers';
+import setups from './fixtures/setups';
+import pairs, { extBacks } from './fixtures/stringify-pairs';
+import wsonFactory, { ParseError } from './wsonFactory';
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    const wson = wsonFactory(setup.options);
+    describe('parse lazy', () => {
+      for (const pair of pairs) {
+        const { s } = pair;
+        if (s == null) {
+          continue;
+        }
+        if (pair.parseFailPos != null) {
+          it(`should fail to parse '${s}' at ${pair.parseFailPos}`, () => {
+            let e;
+            try {
+              wson.parseLazy(s, { backrefCb: pair.backrefCb }).materialize();
+            } catch (someE) {
+              e = someE as ParseError;
+            }
+            if (e == null) {
+              throw new Error('ParseError expected');
+            }
+            expect(e.name).to.be.equal('ParseError');
+            expect(e.pos).to.be.equal(pair.parseFailPos);
+          });
+        } else {
+          it(`should materialize '${s}' as ${safeRepr(pair.x)}`, () => {
+            expect(wson.parseLazy(s, { backrefCb: pair.backrefCb }).materialize()).to.be.deep.equal(pair.x);
+          });
+        }
+      }
+    });
+
+    describe('lazy value', () => {
+      const lazy = wson.parseLazy('{a:[#1|#2|{x:y}]|b:[:Point|#3|#4]|c|d:{e:|1}|k`i:v}', {});
+      it('should provide length and keys', () => {
+        expect(lazy.length).to.be.equal(5);
+        expect(lazy.keys()).to.be.deep.equal(['a', 'b', 'c', 'd', 'k:']);
+        expect((lazy.get('a') as LazyValue).length).to.be.equal(3);
+      });
+      it('should get by path', () => {
+        expect(lazy.get(['a', 2, 'x'])).to.be.equal('y');
+        expect(lazy.get('c')).to.be.equal(true);
+        expect(lazy.get('k:')).to.be.equal('v');
+        expect(lazy.get(['a', 3])).to.be.equal(undefined);
+        expect(lazy.get('z')).to.be.equal(undefined);
+      });
+      it('should materialize subtrees', () => {
+        expect((lazy.get('a') as LazyValue).materialize()).to.be.deep.equal([1, 2, { x: 'y' }]);
+        expect(lazy.get('b')).to.be.deep.equal(new Point(3, 4));
+      });
+      it('should keep backrefs beyond subtrees', () => {
+        const d = lazy.get('d') as LazyValue;
+        expect(d.get('e')).to.be.equal(lazy.materialize());
+        expect((d.materialize() as { e: unknown }).e).to.be.equal(lazy.materialize());
+      });
+      it('should resolve externalRefs', () => {
+        const externalRefs = extBacks;
+        const refLazy = wson.parseLazy('{a:{x:|2}|b:#1}', { externalRefs });
+        expect((refLazy.get('a') as LazyValue).get('x')).to.be.equal(extBacks[0]);
+        expect(() => wson.parseLazy('{a:{x:|5}}', { externalRefs })).to.throw();
+      });
+    });
+  });
+}
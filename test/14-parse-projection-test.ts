@@ -0,0 +1,53 @@
+import { expect } from 'chai';
+
+import { Point } from './fixtures/extdefs';
+import setups from './fixtures/setups';
+import wsonFactory, { ParseError } from './wsonFactory';
+
+const s = '{a:#1|b:{c:[x|y`e]|d:{e:#f}|f}|g:[:Point|#1|#2]|h:[{a:#1|z:#2}|{a:#3}]|i}';
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    const wson = wsonFactory(setup.options);
+    describe('parse with projection', () => {
+      it('should keep selected keys only', () => {
+        expect(wson.parse(s, { projection: { a: true, i: true } })).to.be.deep.equal({ a: 1, i: true });
+        expect(wson.parse(s, { projection: { a: false } })).to.be.deep.equal({});
+      });
+      it('should select nested keys', () => {
+        expect(wson.parse(s, { projection: { b: { d: true, f: true } } })).to.be.deep.equal({
+          b: { d: { e: false }, f: true },
+        });
+      });
+      it('should pass projection on to array items', () => {
+        expect(wson.parse(s, { projection: { h: { a: true } } })).to.be.deep.equal({ h: [{ a: 1 }, { a: 3 }] });
+      });
+      it('should not project custom args', () => {
+        expect(wson.parse(s, { projection: { g: { x: true } } })).to.be.deep.equal({ g: new Point(1, 2) });
+      });
+      it('should keep backrefs', () => {
+        const x = wson.parse('{a:{x:|1}|b:#2}', { projection: { a: true } }) as { a: { x: unknown } };
+        expect(x.a.x).to.be.equal(x);
+      });
+      for (const [bad, pos] of [
+        ['{a:#1|b:[x}', 11],
+        ['{a:#1|b:x`z}', 10],
+        ['{a:#1|b:}', 8],
+      ] as [string, number][]) {
+        it(`should fail to parse '${bad}' at ${pos}`, () => {
+          let e;
+          try {
+            wson.parse(bad, { projection: { a: true } });
+          } catch (someE) {
+            e = someE as ParseError;
+          }
+          if (e == null) {
+            throw new Error('ParseError expected');
+          }
+          expect(e.name).to.be.equal('ParseError');
+          expect(e.pos).to.be.equal(pos);
+        });
+      }
+    });
+  });
+}
@@ -0,0 +1,47 @@
+import { expect } from 'chai';
+
+import setups from './fixtures/setups';
+import wsonFactory, { ParseError } from './wsonFactory';
+
+function makeText(n: number): string {
+  const chars = 'ab:|[]{}#`xyz';
+  let s = '';
+  for (let i = 0; i < n; i++) {
+    s += chars[(i * 7919 + n) % chars.length];
+  }
+  return s;
+}
+
+const large = {
+  text: makeText(1000),
+  items: Array.from({ length: 200 }, (_, i) => ({ k: makeText(i % 30), n: i, d: new Date(i), b: i % 2 === 0, e: '' })),
+  nested: [[[['deep' + makeText(50)]]]],
+};
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    const wson = wsonFactory(setup.options);
+    describe('parse large', () => {
+      const s = wson.stringify(large, {});
+      it('should parse a large source', () => {
+        expect(wson.parse(s, {})).to.be.deep.equal(large);
+      });
+      it('should skip by projection in a large source', () => {
+        expect(wson.parse(s, { projection: { nested: true } })).to.be.deep.equal({ nested: large.nested });
+      });
+      it('should fail at a bad escape in a large source', () => {
+        let e;
+        try {
+          wson.parse(s.slice(0, 5000) + '`z' + s.slice(5000), {});
+        } catch (someE) {
+          e = someE as ParseError;
+        }
+        if (e == null) {
+          throw new Error('ParseError expected');
+        }
+        expect(e.name).to.be.equal('ParseError');
+        expect(e.pos).to.be.equal(5001);
+      });
+    });
+  });
+}
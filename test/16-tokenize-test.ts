@@ -0,0 +1,52 @@
+import { expect } from 'chai';
+
+import { TokenKind } from '../src/types';
+import setups from './fixtures/setups';
+import wsonFactory, { ParseError } from './wsonFactory';
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    const wson = wsonFactory(setup.options);
+    describe('tokenize', () => {
+      it('should tokenize into typed arrays', () => {
+        const s = '{a`i:#12|b:[x|y]}';
+        const tokens = wson.tokenize(s);
+        expect(tokens.kinds).to.be.instanceOf(Uint8Array);
+        expect(Array.from(tokens.kinds)).to.be.deep.equal([
+          TokenKind.OBJECT,
+          TokenKind.TEXT,
+          TokenKind.IS,
+          TokenKind.LITERAL,
+          TokenKind.TEXT,
+          TokenKind.PIPE,
+          TokenKind.TEXT,
+          TokenKind.IS,
+          TokenKind.ARRAY,
+          TokenKind.TEXT,
+          TokenKind.PIPE,
+          TokenKind.TEXT,
+          TokenKind.ENDARRAY,
+          TokenKind.ENDOBJECT,
+        ]);
+        const parts = Array.from(tokens.starts).map((start, idx) => s.slice(start, tokens.ends[idx]));
+        expect(parts).to.be.deep.equal(['{', 'a`i', ':', '#', '12', '|', 'b', ':', '[', 'x', '|', 'y', ']', '}']);
+      });
+      it('should tokenize an empty string', () => {
+        expect(wson.tokenize('').kinds.length).to.be.equal(0);
+      });
+      it('should fail at a bad escape', () => {
+        let e;
+        try {
+          wson.tokenize('ab`x');
+        } catch (someE) {
+          e = someE as ParseError;
+        }
+        if (e == null) {
+          throw new Error('ParseError expected');
+        }
+        expect(e.name).to.be.equal('ParseError');
+        expect(e.pos).to.be.equal(3);
+      });
+    });
+  });
+}
@@ -0,0 +1,41 @@
+import { expect } from 'chai';
+
+import setups from './fixtures/setups';
+import pairs, { extBacks } from './fixtures/stringify-pairs';
+import wsonFactory from './wsonFactory';
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    const wson = wsonFactory(setup.options);
+    describe('validate', () => {
+      for (const pair of pairs) {
+        const { s } = pair;
+        if (s == null) {
+          continue;
+        }
+        const externalRefs = pair.backrefCb ? extBacks.length : 0;
+        if (pair.parseFailPos != null) {
+          it(`should reject '${s}' at ${pair.parseFailPos}`, () => {
+            const result = wson.validate(s, externalRefs);
+            expect(result).to.be.an('array');
+            expect((result as [number, string])[0]).to.be.equal(pair.parseFailPos);
+          });
+        } else {
+          it(`should accept '${s}'`, () => {
+            expect(wson.validate(s, externalRefs)).to.be.equal(true);
+          });
+        }
+      }
+      it('should take counts of external refs beyond int32', () => {
+        expect(wson.validate('|4294967294', 4294967295)).to.be.equal(true);
+        expect(wson.validate('|4294967295', 4294967295)).to.be.an('array');
+        expect(wson.validate('|2147483648', 2147483648)).to.be.an('array');
+      });
+      it('should reject nesting deeper than 1000', () => {
+        const deep = (n: number) => '[{a:'.repeat(n / 2) + '#n' + '}]'.repeat(n / 2);
+        expect(wson.validate(deep(1000))).to.be.equal(true);
+        expect(wson.validate(deep(1e6))).to.be.deep.equal([2000, 'nested too deeply']);
+      });
+    });
+  });
+}
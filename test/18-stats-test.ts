@@ -0,0 +1,48 @@
+import { expect } from 'chai';
+
+import { Point, Polygon } from './fixtures/extdefs';
+import setups from './fixtures/setups';
+import wsonFactory from './wsonFactory';
+
+const sum = (xs: number[]) => xs.reduce((a, b) => a + b, 0);
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    const wson = wsonFactory(setup.options);
+    describe('stats', () => {
+      beforeEach(() => {
+        wson.resetStats();
+      });
+      it('should count stringifying', () => {
+        const s = wson.stringify({ a: 'x:y', p: new Point(1, 2) }, {});
+        wson.escape('a|b');
+        const stats = wson.getStats().stringifier;
+        expect(stats.calls).to.be.equal(2);
+        expect(stats.escapes).to.be.equal(2);
+        expect(stats.splitCalls).to.be.equal(1);
+        expect(stats.outputLength).to.be.equal(s.length + 4);
+        expect(sum(stats.latency)).to.be.equal(2);
+      });
+      it('should count parsing', () => {
+        const s = '[[:Polygon|[:Point|#1|#2]]|[|2]]';
+        expect(wson.parse(s, { backrefCb: () => [] })).to.be.deep.equal([new Polygon([new Point(1, 2)]), [[]]]);
+        expect(() => wson.parse('{a', {})).to.throw();
+        const stats = wson.getStats().parser;
+        expect(stats.calls).to.be.equal(2);
+        expect(stats.errors).to.be.equal(1);
+        expect(stats.inputLength).to.be.equal(s.length + 2);
+        expect(stats.createCalls).to.be.equal(1);
+        expect(stats.precreateCalls).to.be.equal(1);
+        expect(stats.postcreateCalls).to.be.equal(1);
+        expect(stats.backrefCbCalls).to.be.equal(1);
+        expect(stats.psPoolSize).to.be.equal(1);
+        expect(sum(stats.latency)).to.be.equal(2);
+      });
+      it('should reset', () => {
+        wson.parse('#1', {});
+        wson.resetStats();
+        expect(wson.getStats().parser.calls).to.be.equal(0);
+      });
+    });
+  });
+}
@@ -0,0 +1,50 @@
+import { expect } from 'chai';
+
+import setups from './fixtures/setups';
+import wsonFactory from './wsonFactory';
+
+const big = Array.from({ length: 100000 }, (_, i) => `item${i}`);
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    describe('retention', () => {
+      it('should give back large buffers by default', () => {
+        const wson = wsonFactory(setup.options);
+        const s = wson.stringify(big, {});
+        expect(wson.parse(s, {})).to.be.deep.equal(big);
+        const stats = wson.getStats();
+        expect(stats.stringifier.retainedBytes).to.be.below(1 << 20);
+        expect(stats.parser.retainedBytes).to.be.below(1 << 20);
+      });
+      it('should keep buffers up to maxBufferSize until trim', () => {
+        const wson = wsonFactory({ ...setup.options, retention: { maxBufferSize: 1e9 } });
+        const s = wson.stringify(big, {});
+        wson.parse(s, {});
+        let stats = wson.getStats();
+        expect(stats.stringifier.retainedBytes).to.be.at.least(2 * s.length);
+        expect(stats.parser.retainedBytes).to.be.at.least(2 * s.length);
+        wson.trim();
+        stats = wson.getStats();
+        expect(stats.stringifier.retainedBytes).to.be.equal(0);
+        expect(stats.parser.retainedBytes).to.be.equal(0);
+        expect(stats.parser.psPoolSize).to.be.equal(0);
+      });
+      it('should cap the pool', () => {
+        const wson = wsonFactory({ ...setup.options, retention: { maxPoolSize: 0 } });
+        expect(wson.parse('[a|{b:c}]', {})).to.be.deep.equal(['a', { b: 'c' }]);
+        expect(wson.validate('{')).to.be.deep.equal([1, '']);
+        expect(wson.getStats().parser.psPoolSize).to.be.equal(0);
+      });
+      it('should clamp sizes out of range', () => {
+        const none = wsonFactory({ ...setup.options, retention: { maxBufferSize: -1, maxPoolSize: NaN }, externalStringThreshold: -5 });
+        expect(none.parse(none.stringify(big, {}), {})).to.be.deep.equal(big);
+        expect(none.getStats().stringifier.retainedBytes).to.be.equal(0);
+        expect(none.getStats().parser.psPoolSize).to.be.equal(0);
+        const all = wsonFactory({ ...setup.options, retention: { maxBufferSize: Infinity, maxPoolSize: Infinity } });
+        expect(all.parse(all.stringify(big, {}), {})).to.be.deep.equal(big);
+        expect(all.getStats().stringifier.retainedBytes).to.be.above(1 << 20);
+        expect(all.getStats().parser.psPoolSize).to.be.equal(1);
+      });
+    });
+  });
+}
@@ -3,6 +3,7 @@ import { expect } from 'chai';
 
 import { Point } from './fixtures/extdefs';
 import setups from './fixtures/setups';
+import { Connector } from '../src/types';
 import wsonFactory from './wsonFactory';
 
 for (const setup of setups) {
@@ -20,3 +21,53 @@ for (const setup of setups) {
     });
   });
 }
+
+describe('many connectors', () => {
+  class Tagged {
+    constructor(public tag: string, public x: unknown) {}
+  }
+  const names = Array.from({ length: 300 }, (_, i) => `Tag${i}`).concat(['a:b', 'x[1]|y', '`q']);
+  // eslint-disable-next-line @typescript-eslint/no-explicit-any
+  const connectors: Record<string, Connector<any, any>> = {};
+  const classes: { [name: string]: typeof Tagged } = {};
+  for (const name of names) {
+    const cls = class extends Tagged {};
+    classes[name] = cls;
+    connectors[name] = {
+      by: cls,
+      split: (t: Tagged) => [t.x],
+      create: ([x]: unknown[]) => new cls(name, x),
+      hasCreate: true,
+    };
+  }
+  const wson = wsonFactory({ connectors });
+
+  it('should find connectors by escaped names', () => {
+    for (const name of ['Tag0', 'Tag299', 'a:b', 'x[1]|y', '`q']) {
+      const x = [new classes[name](name, [1, 'a'])];
+      const s = wson.stringify(x, {});
+      const y = wson.parse(s, {}) as Tagged[];
+      expect(y[0]).to.be.instanceOf(classes[name]);
+      expect(y[0].tag).to.be.equal(name);
+      expect(wson.connectorOfCname(name).by).to.be.equal(classes[name]);
+    }
+  });
+
+  it('should report an unknown name unescaped', () => {
+    for (const [s, cause] of [
+      ['[:Tag300|#1]', "no connector for 'Tag300'"],
+      ['[:a`ic|#1]', "no connector for 'a:c'"],
+    ]) {
+      let error: InstanceType<typeof wsonFactory.ParseError> | undefined;
+      try {
+        wson.parse(s, {});
+      } catch (e) {
+        error = e as InstanceType<typeof wsonFactory.ParseError>;
+      }
+      expect(error).to.be.instanceOf(wsonFactory.ParseError);
+      expect(error?.pos).to.be.equal(2);
+      expect(error?.cause).to.be.equal(cause);
+      expect(wson.validate(s)).to.be.deep.equal([2, cause]);
+    }
+  });
+});
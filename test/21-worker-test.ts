@@ -0,0 +1,87 @@
+import { expect } from 'chai';
+import bindings = require('bindings');
+import { Worker } from 'worker_threads';
+
+import addonFactory from '../src/';
+import { BaseStringifyError } from '../src/types';
+
+const addonPath = (bindings as unknown as (opts: { bindings: string; path: boolean }) => string)({
+  bindings: 'wson_addon',
+  path: true,
+});
+
+// runs in each worker: own isolate, own addon instance
+const workerCode = `
+const { parentPort, workerData } = require('worker_threads');
+const addon = require(workerData.addonPath);
+class Pair {
+  constructor(a, b) { this.a = a; this.b = b; }
+}
+const options = {
+  connectors: {
+    Pair: { by: Pair, split: (p) => [p.a, p.b], create: ([a, b]) => new Pair(a, b), hasCreate: true },
+  },
+};
+class StringifyError extends Error {}
+class ParseError extends Error {
+  constructor(s, pos, cause) { super(cause); this.pos = pos; }
+}
+const stringifier = new addon.Stringifier(StringifyError, options);
+const parser = new addon.Parser(ParseError, options);
+for (let k = 0; k < workerData.rounds; ++k) {
+  const x = { id: workerData.id, k, s: 'a:b|c\`', l: [1, 2.5, true, null, new Pair(k, [new Date(k)])] };
+  const s = stringifier.stringify(x);
+  const y = parser.parse(s);
+  if (stringifier.stringify(y) !== s || !(y.l[4] instanceof Pair) || y.l[4].b[0].getTime() !== k) {
+    throw new Error('round trip failed: ' + s);
+  }
+  if (parser.parseLazy(s).get('id') !== workerData.id || parser.validate(s) !== true) {
+    throw new Error('lazy/validate failed: ' + s);
+  }
+  let pos = -1;
+  try {
+    parser.parse('{a:}');
+  } catch (e) {
+    pos = e.pos;
+  }
+  if (pos !== 3) {
+    throw new Error('bad error pos: ' + String(pos));
+  }
+}
+parentPort.postMessage(workerData.id);
+`;
+
+function runWorker(id: number, rounds: number): Promise<number> {
+  return new Promise((resolve, reject) => {
+    const worker = new Worker(workerCode, { eval: true, workerData: { addonPath, id, rounds } });
+    let result: number;
+    worker.on('message', (msg: number) => {
+      result = msg;
+    });
+    worker.on('error', reject);
+    worker.on('exit', (code) => {
+      if (code) {
+        reject(new Error(`worker ${id} exited with ${code}`));
+      } else {
+        resolve(result);
+      }
+    });
+  });
+}
+
+describe('worker threads', function () {
+  this.timeout(30000);
+  const workerCount = 8;
+
+  it('should parse and stringify concurrently', async () => {
+    for (let pass = 0; pass < 3; ++pass) {
+      const ids = Array.from({ length: workerCount }, (_, id) => id);
+      expect(await Promise.all(ids.map((id) => runWorker(id, 200)))).to.be.deep.equal(ids);
+    }
+  });
+
+  it('should still work in the main thread after workers exited', () => {
+    const stringifier = new addonFactory.Stringifier(BaseStringifyError, {});
+    expect(stringifier.stringify({ a: [1, 2] })).to.be.equal('{a:[#1|#2]}');
+  });
+});
@@ -0,0 +1,79 @@
+import { expect } from 'chai';
+
+import { Point } from './fixtures/extdefs';
+import setups from './fixtures/setups';
+import wsonFactory from './wsonFactory';
+
+function deepFreeze<T>(x: T): T {
+  if (x != null && typeof x === 'object') {
+    Object.values(x).forEach(deepFreeze);
+    Object.freeze(x);
+  }
+  return x;
+}
+
+const memoMarker = Symbol('memo');
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    describe('memoize', () => {
+      const plainWson = wsonFactory(setup.options);
+      const wson = wsonFactory({ ...setup.options, memoize: { frozen: true, marker: memoMarker } });
+      const same = (x: unknown) => expect(wson.stringify(x, {})).to.be.equal(plainWson.stringify(x, {}));
+      beforeEach(() => {
+        wson.resetStats();
+      });
+
+      it('should reuse fragments of frozen subtrees', () => {
+        const table = deepFreeze({ names: ['alpha', 'beta:gamma', 'delta|x'], p: new Point(1, 2) });
+        const state = { a: table, b: [table, { c: table }] };
+        same(state);
+        same(state);
+        const stats = wson.getStats().stringifier;
+        expect(stats.memoStores).to.be.equal(2); // table and table.names
+        expect(stats.memoHits).to.be.equal(5);
+      });
+      it('should not keep subtrees with mutable parts', () => {
+        const child = ['x', 'y', 'some longer text'];
+        const shallow = Object.freeze({ child, d: Object.freeze({ date: new Date(5), text: 'some longer text' }) });
+        same(shallow);
+        child.push('z');
+        shallow.d.date.setTime(7);
+        same(shallow);
+        expect(wson.getStats().stringifier.memoHits).to.be.equal(0);
+      });
+      it('should not keep subtrees with backrefs', () => {
+        const root: Record<string, unknown> = { name: 'root' };
+        const sub = Object.freeze({ up: root, text: 'some longer text' });
+        root.sub = sub;
+        same(root);
+        same({ s: sub });
+        same({ r: root });
+        const cyc: Record<string, unknown> = { text: 'some longer text' };
+        cyc.self = cyc;
+        Object.freeze(cyc);
+        same([cyc]);
+        same({ a: { b: cyc } });
+        expect(wson.getStats().stringifier.memoHits).to.be.equal(0);
+      });
+      it('should trust marked subtrees', () => {
+        const marked = { [memoMarker]: true, list: [1, 2, 3, 4, 5, 6, 7, 8, 9] };
+        const s = wson.stringify(marked, {});
+        marked.list.push(10);
+        expect(wson.stringify(marked, {})).to.be.equal(s);
+      });
+      it('should bypass the cache with external refs', () => {
+        const table = deepFreeze({ inner: { text: 'some longer text' } });
+        const externalRefs = [table.inner];
+        same(table);
+        expect(wson.stringify(table, { externalRefs })).to.be.equal('{inner:|1}');
+      });
+      it('should drop fragments by trim', () => {
+        same(deepFreeze({ text: 'some longer text' }));
+        expect(wson.getStats().stringifier.retainedBytes).to.be.above(0);
+        wson.trim();
+        expect(wson.getStats().stringifier.retainedBytes).to.be.equal(0);
+      });
+    });
+  });
+}
@@ -0,0 +1,124 @@
+import { expect } from 'chai';
+
+import { BaseParseError } from '../src/types';
+import { Point } from './fixtures/extdefs';
+import setups from './fixtures/setups';
+import wsonFactory from './wsonFactory';
+
+const spec = { id: 'number', name: 'string', 'a:b': 'string', active: 'boolean', extra: 'any', '': 'any' } as const;
+
+const records = [
+  { id: 1, name: 'alpha', 'a:b': 'x|y', active: true, extra: null, '': 1.5 },
+  { active: false, '': 'e', extra: [1, { z: 2 }], id: -7, name: '', 'a:b': '' },
+  { id: 2 ** 40, name: 'b`c', 'a:b': '[]', active: true, extra: new Date(5), '': undefined },
+];
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    describe('schema', () => {
+      const wson = wsonFactory(setup.options);
+      const record = wson.compileSchema(spec);
+      beforeEach(() => {
+        wson.resetStats();
+      });
+
+      it('should stringify records as the generic path does', () => {
+        for (const x of records) {
+          expect(record.stringify(x, {})).to.be.equal(wson.stringify(x, {}));
+        }
+        expect(wson.getStats().stringifier.schemaFallbacks).to.be.equal(0);
+      });
+      it('should fall back for other shapes', () => {
+        const others = [
+          { id: 1, name: 'alpha', 'a:b': 'x', active: true, extra: null },
+          { id: 1, name: 'alpha', 'a:b': 'x', active: true, extra: null, '': 0, more: 1 },
+          { id: '1', name: 'alpha', 'a:b': 'x', active: true, extra: null, '': 0 },
+          [1, 2],
+          'text',
+          new Point(1, 2),
+        ];
+        for (const x of others) {
+          expect(record.stringify(x, {})).to.be.equal(wson.stringify(x, {}));
+        }
+        expect(wson.getStats().stringifier.schemaFallbacks).to.be.equal(others.length);
+      });
+      it('should parse records as the generic path does', () => {
+        for (const x of records) {
+          const s = wson.stringify(x, {});
+          expect(record.parse(s, {})).to.be.deep.equal(wson.parse(s, {}));
+        }
+        expect(wson.getStats().parser.schemaFallbacks).to.be.equal(0);
+      });
+      it('should fall back for other texts', () => {
+        const others = ['{id:#1}', '{a`ib:x|active|extra:#n|id:#1|name:alpha}', '[#1]', '#', '{#:#1|a`ib:x|active|b|extra|id|name}'];
+        for (const s of others) {
+          expect(record.parse(s, {})).to.be.deep.equal(wson.parse(s, {}));
+        }
+        expect(wson.getStats().parser.schemaFallbacks).to.be.equal(others.length);
+      });
+      it('should call backrefCb once on a fallback', () => {
+        let calls = 0;
+        const backrefCb = () => {
+          ++calls;
+          return { ref: true };
+        };
+        const s = '{#:#1|a`ib:x|active|extra:|1|id:#1|name:n|zz:#1}';
+        expect(record.parse(s, { backrefCb })).to.be.deep.equal(wson.parse(s, { backrefCb }));
+        expect(calls).to.be.equal(2); // once per parse
+        expect(wson.getStats().parser.schemaFallbacks).to.be.equal(1);
+      });
+      it('should report syntax errors as the generic path does', () => {
+        expect(() => record.parse('{#:#1|a`ib:x|active|extra:#n|id:#1|name:alpha', {})).to.throw(wsonFactory.ParseError);
+        expect(() => record.parse('{#:#1|a`ib:x|active|extra:[#x]|id:#1|name:alpha}', {})).to.throw(wsonFactory.ParseError);
+        for (const s of ['{#:#1|zz:[#x]}', '{#:#1|a`ib:x|active|extra|id:#1|name:n|zz:#x}', '{#:#1|a`ib:x}}', '{#:#1|a`ibc[}']) {
+          const errorOf = (parse: () => unknown) => {
+            try {
+              parse();
+            } catch (err) {
+              return [(err as BaseParseError).pos, (err as BaseParseError).cause];
+            }
+            return null;
+          };
+          expect(errorOf(() => record.parse(s, {}))).to.be.deep.equal(errorOf(() => wson.parse(s, {})));
+          expect(errorOf(() => wson.parse(s, {}))).to.be.an('array');
+        }
+      });
+      it('should resolve backrefs', () => {
+        const x = { id: 1, name: 'n', 'a:b': '', active: false, extra: { up: null as unknown }, '': 0 };
+        x.extra.up = x;
+        const s = record.stringify(x, {});
+        expect(s).to.be.equal(wson.stringify(x, {}));
+        const y = record.parse(s, {}) as typeof x;
+        expect(y.extra.up).to.be.equal(y);
+      });
+      it('should write external refs of the record as backrefs', () => {
+        const x = records[0];
+        expect(record.stringify(x, { externalRefs: [x] })).to.be.equal('|0');
+        expect(record.stringify(x, { haverefCb: (y: unknown) => (y === x ? 1 : null) })).to.be.equal('|1');
+      });
+      it('should skip enumerating keys with trustKeys', () => {
+        const trusted = wson.compileSchema(spec, { trustKeys: true });
+        expect(trusted.stringify(records[0], {})).to.be.equal(wson.stringify(records[0], {}));
+        expect(trusted.stringify({ ...records[0], more: 1 }, {})).to.be.equal(wson.stringify(records[0], {})); // dropped
+        expect(wson.getStats().stringifier.schemaFallbacks).to.be.equal(0);
+      });
+      it('should fall back with trustKeys for a missing key', () => {
+        const trusted = wson.compileSchema(spec, { trustKeys: true });
+        const { extra, ...x } = records[0];
+        const inherited = Object.assign(Object.create({ extra }), x);
+        expect(trusted.stringify(x, {})).to.be.equal(wson.stringify(x, {}));
+        expect(trusted.stringify(inherited, {})).to.be.equal(wson.stringify(inherited, {}));
+        expect(wson.getStats().stringifier.schemaFallbacks).to.be.equal(2);
+      });
+      it('should find index keys', () => {
+        const indexed = wson.compileSchema({ 0: 'number', 1: 'string', 4294967295: 'any', a: 'any' });
+        const x = { 0: 1, 1: 'x', 4294967295: null, a: true };
+        expect(indexed.stringify(x, {})).to.be.equal(wson.stringify(x, {}));
+        expect(wson.getStats().stringifier.schemaFallbacks).to.be.equal(0);
+      });
+      it('should reject unknown kinds', () => {
+        expect(() => wson.compileSchema({ id: 'integer' } as unknown as typeof spec)).to.throw();
+      });
+    });
+  });
+}
@@ -0,0 +1,98 @@
+import { expect } from 'chai';
+
+import { BaseParseError, RecordsParseError } from '../src/types';
+import { Point } from './fixtures/extdefs';
+import setups from './fixtures/setups';
+import wsonFactory from './wsonFactory';
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    describe('records', () => {
+      const wson = wsonFactory(setup.options);
+      const pieces = (s: string, more?: boolean) => {
+        const { starts, ends, next } = wson.splitRecords(s, more);
+        return [Array.from(starts, (start, i) => s.slice(start, ends[i])), next];
+      };
+
+      it('should split concatenated values', () => {
+        expect(pieces('{a}{b:c}[x|y]')).to.be.deep.equal([['{a}', '{b:c}', '[x|y]'], 13]);
+      });
+      it('should split values per line', () => {
+        expect(pieces('{a}\n{b}\r\n\nabc\n#5\n')).to.be.deep.equal([['{a}', '{b}', 'abc', '#5'], 17]);
+        expect(pieces('a`ob\n{x:[a`cb|{y}]}\nde')).to.be.deep.equal([['a`ob', '{x:[a`cb|{y}]}', 'de'], 22]);
+      });
+      it('should leave an unfinished value for more input', () => {
+        expect(pieces('{a}\n{b:[c', true)).to.be.deep.equal([['{a}'], 4]);
+        expect(pieces('{a}\nabc', true)).to.be.deep.equal([['{a}'], 4]);
+        expect(pieces('{a}\n{b:[c')).to.be.deep.equal([['{a}', '{b:[c'], 9]);
+      });
+      it('should split UTF-8 bytes', () => {
+        const { starts, ends, next } = wson.splitRecords(Buffer.from('{a:ä}\nx'));
+        expect(Array.from(starts)).to.be.deep.equal([0, 7]);
+        expect(Array.from(ends)).to.be.deep.equal([6, 8]);
+        expect(next).to.be.equal(8);
+      });
+      it('should parse records', () => {
+        const values = [{ a: 1, b: ['x', 'y|z'] }, 'text', 5, [new Date(3), null], { p: new Point(1, 2) }];
+        const s = values.map((x) => wson.stringify(x, {})).join('\n');
+        expect(wson.parseRecords(s)).to.be.deep.equal({ values, next: s.length });
+        const bytes = Buffer.from(s.replace('text', 'täxt €'));
+        expect(wson.parseRecords(bytes).values[1]).to.be.equal('täxt €');
+      });
+      it('should decode malformed UTF-8 as Node does', () => {
+        const sequences = [
+          [0xe0, 0x80, 0x80],
+          [0xed, 0xa0, 0x80],
+          [0xf0, 0x80, 0x80, 0x80],
+          [0xf4, 0x90, 0x80, 0x80],
+          [0xc0, 0xaf],
+          [0xf1, 0x80, 0x80, 0x61],
+          [0xe1, 0x80],
+          [0xff, 0xf0, 0x9f, 0x98, 0x80],
+        ];
+        let seed = 1;
+        for (let i = 0; i < 200; ++i) {
+          sequences.push(Array.from({ length: 8 }, () => (seed = (seed * 48271) % 2147483647) % 2 ? 0x80 + (seed % 128) : 0x61));
+        }
+        for (const sequence of sequences) {
+          const bytes = Buffer.from([0x61, ...sequence]);
+          expect(wson.parseRecords(bytes).values).to.be.deep.equal([bytes.toString()]);
+        }
+      });
+      it('should parse records in batches', () => {
+        const s = Array.from({ length: 10 }, (_, i) => `{i:#${i}}`).join('');
+        const first = wson.parseRecords(s, 0, 4);
+        expect(first.values).to.be.deep.equal([0, 1, 2, 3].map((i) => ({ i })));
+        const rest = wson.parseRecords(s, first.next);
+        expect(rest.values.length).to.be.equal(6);
+        expect(rest.next).to.be.equal(s.length);
+      });
+      it('should report a bad record', () => {
+        try {
+          wson.parseRecords('{a}\n{b|}\n{c}');
+          expect.fail();
+        } catch (err) {
+          expect(err).to.be.instanceOf(wsonFactory.ParseError);
+          expect((err as BaseParseError).s).to.be.equal('{b|}');
+        }
+      });
+      it('should tell which record failed and where to go on', () => {
+        const s = '{a:#1}\n{b:#x}\n{c}';
+        try {
+          wson.parseRecords(s);
+          expect.fail();
+        } catch (err) {
+          const { s: text, pos, index, values, next } = err as RecordsParseError;
+          expect([text, pos, index, values, next]).to.be.deep.equal(['{b:#x}', 4, 1, [{ a: 1 }], 7]);
+          expect(wson.parseRecords(s, next + text.length).values).to.be.deep.equal([{ c: true }]);
+        }
+        try {
+          wson.parseRecords(Buffer.from('{é:#1}{b:#x}'));
+          expect.fail();
+        } catch (err) {
+          expect((err as RecordsParseError).next).to.be.equal(7); // in bytes
+        }
+      });
+    });
+  });
+}
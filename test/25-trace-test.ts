@@ -0,0 +1,66 @@
+import { expect } from 'chai';
+import bindings = require('bindings');
+import { spawnSync } from 'child_process';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+
+const addonPath = (bindings as unknown as (opts: { bindings: string; path: boolean }) => string)({
+  bindings: 'wson_addon',
+  path: true,
+});
+
+// runs in a child process, so its trace file can be read back
+const childCode = `
+const addon = require(process.argv[1]);
+class Pair {
+  constructor(a, b) { this.a = a; this.b = b; }
+}
+const options = {
+  connectors: {
+    Pair: { by: Pair, split: (p) => [p.a, p.b], create: ([a, b]) => new Pair(a, b), hasCreate: true },
+  },
+};
+const stringifier = new addon.Stringifier(Error, options);
+const parser = new addon.Parser(Error, options);
+stringifier.stringify({ before: true });
+const tracing = require('trace_events').createTracing({ categories: ['wson'] });
+tracing.enable();
+parser.parse(stringifier.stringify({ l: [new Pair(1, 'x')] }));
+try {
+  parser.parse('{a|');
+} catch (err) {}
+tracing.disable();
+stringifier.stringify({ after: true });
+`;
+
+describe('trace', () => {
+  it('should emit trace events while the category is enabled', function () {
+    this.timeout(10000);
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'wson-trace-'));
+    try {
+      const traceFile = path.join(dir, 'trace.log');
+      const child = spawnSync(process.execPath, ['--trace-event-file-pattern', traceFile, '-e', childCode, addonPath]);
+      expect(child.status).to.be.equal(0);
+      const { traceEvents } = JSON.parse(fs.readFileSync(traceFile, 'utf8')) as {
+        traceEvents: { cat: string; name: string; ph: string }[];
+      };
+      const names = traceEvents.filter((event) => event.cat === 'wson').map((event) => event.name);
+      expect(names).to.be.deep.equal([
+        'wson.stringify',
+        'wson.split',
+        'wson.result',
+        'wson.parse',
+        'wson.copy',
+        'wson.index',
+        'wson.create',
+        'wson.parse',
+        'wson.copy',
+        'wson.index',
+        'wson.error',
+      ]);
+    } finally {
+      fs.rmSync(dir, { recursive: true, force: true });
+    }
+  });
+});
@@ -0,0 +1,98 @@
+import { expect } from 'chai';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+
+import { FileParseError } from '../src/types';
+import { Point } from './fixtures/extdefs';
+import setups from './fixtures/setups';
+import wsonFactory from './wsonFactory';
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    describe('files', () => {
+      const wson = wsonFactory(setup.options);
+      let dir: string;
+      before(() => {
+        dir = fs.mkdtempSync(path.join(os.tmpdir(), 'wson-file-'));
+      });
+      after(() => {
+        fs.rmSync(dir, { recursive: true, force: true });
+      });
+
+      it('should round trip through a file', () => {
+        const file = path.join(dir, 'a.wson');
+        const x = { a: [1, 'b|c', null], d: new Date(5), p: new Point(3, 4), t: true };
+        const bytes = wson.stringifyToFile(file, x, {});
+        const s = wson.stringify(x, {});
+        expect(fs.readFileSync(file, 'utf8')).to.be.equal(s);
+        expect(bytes).to.be.equal(Buffer.byteLength(s));
+        expect(wson.parseFile(file, {})).to.be.deep.equal(x);
+      });
+      it('should write and read UTF-8', () => {
+        const file = path.join(dir, 'b.wson');
+        const x = ['äöü', '€', '😀x', 'a\ud800b'];
+        wson.stringifyToFile(file, x, {});
+        expect(fs.readFileSync(file, 'utf8')).to.be.equal('[äöü|€|😀x|a�b]');
+        expect(wson.parseFile(file, {})).to.be.deep.equal(['äöü', '€', '😀x', 'a�b']);
+      });
+      it('should stringify values larger than a chunk', () => {
+        const file = path.join(dir, 'c.wson');
+        const x = Array.from({ length: 40000 }, (_, i) => ({ i, s: `😀${'x'.repeat(i % 7)}` }));
+        const bytes = wson.stringifyToFile(file, x, {});
+        expect(bytes).to.be.equal(fs.statSync(file).size);
+        expect(fs.readFileSync(file, 'utf8')).to.be.equal(wson.stringify(x, {}));
+        expect(wson.parseFile(file, {})).to.be.deep.equal(x);
+      });
+      it('should report a missing file', () => {
+        try {
+          wson.parseFile(path.join(dir, 'missing.wson'), {});
+          expect.fail();
+        } catch (err) {
+          expect((err as NodeJS.ErrnoException).code).to.be.equal('ENOENT');
+        }
+        try {
+          wson.stringifyToFile(path.join(dir, 'missing', 'x.wson'), 1, {});
+          expect.fail();
+        } catch (err) {
+          expect((err as NodeJS.ErrnoException).code).to.be.equal('ENOENT');
+        }
+      });
+      it('should report bad syntax in a file', () => {
+        const file = path.join(dir, 'd.wson');
+        fs.writeFileSync(file, '{a:b|c');
+        try {
+          wson.parseFile(file, {});
+          expect.fail();
+        } catch (err) {
+          expect(err).to.be.instanceOf(wsonFactory.ParseError);
+          expect((err as FileParseError).s).to.be.equal('{a:b|c');
+          expect((err as FileParseError).offset).to.be.equal(0);
+        }
+      });
+      it('should report bad syntax in a large file by an excerpt', () => {
+        const file = path.join(dir, 'e.wson');
+        const s = `[${'a|'.repeat(50000)}#x|${'b|'.repeat(50000)}c]`;
+        fs.writeFileSync(file, s);
+        try {
+          wson.parseFile(file, {});
+          expect.fail();
+        } catch (err) {
+          const { s: excerpt, pos, offset } = err as FileParseError;
+          expect(excerpt.length).to.be.equal(160);
+          expect(excerpt).to.be.equal(s.slice(offset, offset + 160));
+          expect(offset + pos).to.be.equal(s.indexOf('#x') + 1);
+        }
+      });
+      it('should reject files above 2 GiB', function () {
+        if (process.platform === 'win32') {
+          this.skip(); // read, not mapped
+        }
+        const file = path.join(dir, 'f.wson');
+        fs.writeFileSync(file, '');
+        fs.truncateSync(file, 2 ** 31); // sparse
+        expect(() => wson.parseFile(file, {})).to.throw(RangeError);
+      });
+    });
+  });
+}
@@ -0,0 +1,147 @@
+import { expect } from 'chai';
+import bindings = require('bindings');
+import { Worker } from 'worker_threads';
+
+import { BaseParseError, NativeConnector } from '../src/types';
+import { Point } from './fixtures/extdefs';
+import wsonFactory from './wsonFactory';
+
+interface TestConnectors {
+  point(by: typeof Point): NativeConnector;
+  range: NativeConnector;
+  failing: NativeConnector;
+  number: NativeConnector;
+  future: NativeConnector;
+  foreign: NativeConnector;
+}
+
+const plugin = bindings('wson_test_connector') as TestConnectors;
+
+const bindingPath = (name: string) =>
+  (bindings as unknown as (opts: { bindings: string; path: boolean }) => string)({ bindings: name, path: true });
+const addonPath = bindingPath('wson_addon');
+const pluginPath = bindingPath('wson_test_connector');
+
+// runs in each worker: own isolate, own instances of both addons
+const workerCode = `
+const { parentPort, workerData } = require('worker_threads');
+const addon = require(workerData.addonPath);
+const plugin = require(workerData.pluginPath);
+class Point {
+  constructor(x, y) { this.x = x; this.y = y; }
+}
+const options = { connectors: { Point: { by: Point, native: plugin.point(Point) } } };
+const stringifier = new addon.Stringifier(Error, options);
+const parser = new addon.Parser(Error, options);
+for (let k = 0; k < 100; ++k) {
+  const s = stringifier.stringify([new Point(workerData.id, k)]);
+  const y = parser.parse(s);
+  if (s !== '[[:Point|#' + workerData.id + '|#' + k + ']]' || !(y[0] instanceof Point) || y[0].y !== k) {
+    throw new Error('round trip failed: ' + s);
+  }
+}
+parentPort.postMessage(workerData.id);
+`;
+
+function runWorker(id: number): Promise<number> {
+  return new Promise((resolve, reject) => {
+    const worker = new Worker(workerCode, { eval: true, workerData: { addonPath, pluginPath, id } });
+    let result: number;
+    worker.on('message', (msg: number) => {
+      result = msg;
+    });
+    worker.on('error', reject);
+    worker.on('exit', (code) => (code ? reject(new Error(`worker ${id} exited with ${code}`)) : resolve(result)));
+  });
+}
+
+class Range {
+  constructor(public length: number) {}
+}
+
+class Bad {}
+
+class NotObject {}
+
+class Future {
+  constructor(public a: unknown) {}
+}
+
+class Foreign {
+  constructor(public a: unknown) {}
+}
+
+describe('native connector', () => {
+  const wson = wsonFactory({
+    connectors: {
+      Point: { by: Point, native: plugin.point(Point) },
+      Range: { by: Range, native: plugin.range, create: (args: number[]) => new Range(args.length), hasCreate: true },
+      Bad: { by: Bad, native: plugin.failing },
+      NotObject: { by: NotObject, native: plugin.number, split: () => [] },
+      Future: {
+        by: Future,
+        native: plugin.future,
+        split: (f: Future) => [f.a],
+        create: ([a]: unknown[]) => new Future(a),
+        hasCreate: true,
+      },
+      Foreign: {
+        by: Foreign,
+        native: plugin.foreign,
+        split: (f: Foreign) => [f.a],
+        create: ([a]: unknown[]) => new Foreign(a),
+        hasCreate: true,
+      },
+    },
+  });
+
+  it('should split and create natively', () => {
+    const x = { p: new Point(1, 2), q: [new Point(3, undefined)] };
+    const s = wson.stringify(x, {});
+    expect(s).to.be.equal('{p:[:Point|#1|#2]|q:[[:Point|#3|#u]]}');
+    const y = wson.parse(s, {}) as typeof x;
+    expect(y.p).to.be.instanceOf(Point);
+    expect(y).to.be.deep.equal(x);
+  });
+  it('should nest native connectors', () => {
+    const x = new Point(new Point(1, 2) as unknown as number, 3);
+    const s = wson.stringify(x, {});
+    expect(s).to.be.equal('[:Point|[:Point|#1|#2]|#3]');
+    expect(wson.parse(s, {})).to.be.deep.equal(x);
+  });
+  it('should give more room to a native split', () => {
+    const s = wson.stringify([new Range(3), new Range(20)], {});
+    expect(s).to.be.equal(`[[:Range|#0|#1|#2]|[:Range|${Array.from({ length: 20 }, (_, i) => `#${i}`).join('|')}]]`);
+    expect(wson.parse(s, {})).to.be.deep.equal([new Range(3), new Range(20)]);
+  });
+  it('should throw what a native connector throws', () => {
+    expect(() => wson.stringify({ a: new Bad() }, {})).to.throw(RangeError, 'cannot split');
+    expect(() => wson.parse('{a:[:Bad]}', {})).to.throw(RangeError, 'cannot create');
+  });
+  it('should reject a native create that gives no object', () => {
+    expect(wson.stringify(new NotObject(), {})).to.be.equal('[:NotObject]');
+    try {
+      wson.parse('{a:[:NotObject]}', {});
+      expect.fail();
+    } catch (err) {
+      expect(err).to.be.instanceOf(wsonFactory.ParseError);
+      expect((err as BaseParseError).pos).to.be.equal(5);
+      expect((err as BaseParseError).cause).to.be.equal("native create of 'NotObject' gave no object");
+    }
+  });
+  it('should ignore a native connector of another abi', () => {
+    const s = wson.stringify(new Future('x'), {});
+    expect(s).to.be.equal('[:Future|x]');
+    expect(wson.parse(s, {})).to.be.deep.equal(new Future('x'));
+  });
+  it('should ignore a native value that is no connector handle', () => {
+    const s = wson.stringify(new Foreign('x'), {});
+    expect(s).to.be.equal('[:Foreign|x]');
+    expect(wson.parse(s, {})).to.be.deep.equal(new Foreign('x'));
+  });
+  it('should split and create natively in worker threads', async () => {
+    const ids = [0, 1, 2, 3];
+    expect(await Promise.all(ids.map(runWorker))).to.be.deep.equal(ids);
+    expect(wson.parse(wson.stringify(new Point(1, 2), {}), {})).to.be.instanceOf(Point);
+  });
+});
@@ -0,0 +1,50 @@
+import { expect } from 'chai';
+
+import { BaseParseError } from '../src/types';
+import { Point } from './fixtures/extdefs';
+import setups from './fixtures/setups';
+import wsonFactory from './wsonFactory';
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    describe('diff', () => {
+      const wson = wsonFactory(setup.options);
+      const diff = (a: unknown, b: unknown, maxPaths?: number) =>
+        wson.diff(wson.stringify(a, {}), wson.stringify(b, {}), maxPaths);
+
+      it('should find no paths for equal values', () => {
+        const x = { a: [1, 'b', { c: null }], d: new Date(3), p: new Point(1, 2) };
+        expect(diff(x, { ...x })).to.be.deep.equal([]);
+        expect(wson.diff('{a}', '{a:#t}')).to.be.deep.equal([]);
+      });
+      it('should find changed values', () => {
+        expect(diff({ a: 1, b: { c: 'x', d: [1, 2] } }, { a: 1, b: { c: 'y', d: [1, 3] } })).to.be.deep.equal([
+          ['b', 'c'],
+          ['b', 'd', 1],
+        ]);
+        expect(diff({ a: 'x' }, { a: ['x'] })).to.be.deep.equal([['a']]);
+        expect(diff([1, 2], [1, 2, 3])).to.be.deep.equal([[]]);
+      });
+      it('should merge-join object entries', () => {
+        expect(diff({ a: 1, c: 3, 'k:y': 4 }, { b: 2, c: 3, 'k:y': 5 })).to.be.deep.equal([['a'], ['b'], ['k:y']]);
+        expect(wson.diff('{b:#1|a:#2}', '{a:#2|b:#3}')).to.be.deep.equal([['b']]);
+      });
+      it('should compare custom values by connector and args', () => {
+        expect(diff({ p: new Point(1, 2) }, { p: new Point(1, 3) })).to.be.deep.equal([['p', 1]]);
+        expect(wson.diff('[:Point|#1|#2]', '[:Polygon|#1|#2]')).to.be.deep.equal([[]]);
+      });
+      it('should stop at maxPaths', () => {
+        expect(diff({ a: 1, b: 2, c: 3 }, { a: 4, b: 5, c: 6 }, 2)).to.be.deep.equal([['a'], ['b']]);
+      });
+      it('should report bad syntax', () => {
+        try {
+          wson.diff('{a}', '{a:}');
+          expect.fail();
+        } catch (err) {
+          expect(err).to.be.instanceOf(wsonFactory.ParseError);
+          expect((err as BaseParseError).s).to.be.equal('{a:}');
+        }
+      });
+    });
+  });
+}
@@ -0,0 +1,83 @@
+import { expect } from 'chai';
+
+import { BaseParseError } from '../src/types';
+import { Point } from './fixtures/extdefs';
+import setups from './fixtures/setups';
+import wsonFactory from './wsonFactory';
+
+const expectParseError = (fn: () => unknown, pos: number, cause?: string) => {
+  try {
+    fn();
+    expect.fail();
+  } catch (err) {
+    expect(err).to.be.instanceOf(wsonFactory.ParseError);
+    expect((err as BaseParseError).pos).to.be.equal(pos);
+    if (cause != null) {
+      expect((err as BaseParseError).cause).to.be.equal(cause);
+    }
+  }
+};
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    describe('JSON transcoding', () => {
+      const wson = wsonFactory(setup.options);
+      const x = {
+        s: 'a:[b]|`c"\\\n\u0001\ud800',
+        n: [0, -1.5, 1e21, 1e-7, 0.1 + 0.2, 2 ** 60, NaN],
+        b: [true, false, null],
+        d: new Date(1400000000000),
+        o: { z: {}, y: [], '': 'e' },
+        u: undefined,
+      };
+
+      it('should write JSON as JSON.stringify does', () => {
+        const s = wson.stringify(x, {});
+        expect(JSON.parse(wson.toJSON(s) as string)).to.be.deep.equal(JSON.parse(JSON.stringify(x)));
+        expect(wson.toJSON('#u')).to.be.equal(undefined);
+        expect(wson.toJSON('[#u|{a:#u}]')).to.be.equal('[null,{}]');
+      });
+      it('should read JSON as stringify writes it parsed', () => {
+        const json = JSON.stringify(x);
+        expect(wson.fromJSON(json)).to.be.equal(wson.stringify(JSON.parse(json), {}));
+        expect(wson.fromJSON(' { "b" : [ 1 , 2.5e1 , -0 ] , "a" : "\\u0041" , "b" : true } ')).to.be.equal('{a:A|b}');
+      });
+      it('should canonicalize', () => {
+        const s = wson.stringify(x, {});
+        expect(wson.canonicalize(s)).to.be.equal(s);
+        expect(wson.canonicalize('{b:#1.50|a:[#1e3|#d5.0]|c:#t|a:x}')).to.be.equal('{a:x|b:#1.5|c}');
+        expect(wson.canonicalize('{b:{y|x}|a:|0}')).to.be.equal('{a:|0|b:{x|y}}');
+      });
+      it('should map custom values by customPrefix', () => {
+        const s = wson.stringify({ p: new Point(1, 2) }, {});
+        expect(wson.toJSON(s, '@')).to.be.equal('{"p":{"@Point":[1,2]}}');
+        expect(wson.fromJSON('{"p":{"@Point":[1,2]}}', '@')).to.be.equal(s);
+        expect(wson.canonicalize('[:Point|#1|{b|a}]')).to.be.equal('[:Point|#1|{a|b}]');
+      });
+      it('should transcode UTF-8 bytes', () => {
+        const json = (wson.toJSON as (s: Buffer) => Buffer)(Buffer.from('{é:[x|#2]}'));
+        expect(Buffer.isBuffer(json)).to.be.equal(true);
+        expect(json.toString()).to.be.equal('{"é":["x",2]}');
+        expect((wson.fromJSON as (s: Buffer) => Buffer)(json).toString()).to.be.equal('{é:[x|#2]}');
+      });
+      it('should report what has no translation', () => {
+        expectParseError(() => wson.toJSON('{p:[:Point|#1|#2]}'), 3, 'no JSON for custom values without a customPrefix');
+        expectParseError(() => wson.toJSON('[a||0]'), 3, 'no JSON for backrefs');
+        expectParseError(() => wson.fromJSON('{"a":1,"@P":[]}', '@'), 7, 'custom value with other keys');
+        expectParseError(() => wson.fromJSON('{"@P":1}', '@'), 6, 'custom value without args array');
+      });
+      it('should report bad syntax', () => {
+        expectParseError(() => wson.fromJSON('{"a":1,}'), 7);
+        expectParseError(() => wson.fromJSON('[01]'), 2);
+        expectParseError(() => wson.fromJSON('"\\x"'), 2);
+        expectParseError(() => wson.canonicalize('{a:}'), 3);
+      });
+      it('should report nesting deeper than 1000', () => {
+        const n = 1e6;
+        expectParseError(() => wson.fromJSON('['.repeat(n) + ']'.repeat(n)), 1000, 'nested too deeply');
+        expectParseError(() => wson.toJSON('['.repeat(n) + ']'.repeat(n)), 1000, 'nested too deeply');
+        expect(wson.fromJSON('['.repeat(1000) + ']'.repeat(1000))).to.be.equal('['.repeat(1000) + ']'.repeat(1000));
+      });
+    });
+  });
+}
@@ -0,0 +1,50 @@
+import { expect } from 'chai';
+
+import addonFactory from '../src/';
+import { Point } from './fixtures/extdefs';
+import setups from './fixtures/setups';
+import wsonFactory from './wsonFactory';
+
+// needs a build with allocation counting: node-gyp rebuild --wson_count_allocs=1
+const { allocCount } = addonFactory as unknown as { allocCount?: () => number };
+
+for (const setup of setups) {
+  describe(setup.name, () => {
+    describe('parse allocations', () => {
+      const wson = wsonFactory(setup.options);
+      const s = wson.stringify({ a: [1, 2.5, 'x:y', null, true], b: { c: new Point(1, 2), d: new Date(5) } }, {});
+      const backrefCb = () => ({});
+      const bads = ['{a:#xyz}', '[|9]', '[:Nope]', '{a'];
+      const run = () => {
+        wson.parse(s, {});
+        wson.parse('[|2]', { backrefCb });
+        wson.parsePartial(s, { howNext: true, cb: () => true });
+        wson.validate(s);
+        for (const bad of bads) {
+          expect(() => wson.parse(bad, {})).to.throw();
+          wson.validate(bad);
+        }
+      };
+      it('should not allocate after warm-up', function () {
+        if (!allocCount) {
+          this.skip();
+          return;
+        }
+        const countBefore = allocCount();
+        wsonFactory(setup.options);
+        if (allocCount() === countBefore) {
+          this.skip(); // allocations are not seen on this platform
+          return;
+        }
+        for (let i = 0; i < 5; ++i) {
+          run();
+        }
+        const countWarm = allocCount();
+        for (let i = 0; i < 20; ++i) {
+          run();
+        }
+        expect(allocCount() - countWarm).to.be.equal(0);
+      });
+    });
+  });
+}
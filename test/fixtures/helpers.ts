@@ -21,6 +21,7 @@ export interface Pair {
   parseFailPos?: number;
   backrefCb?: (refNum: number) => Value;
   haverefCb?: (item: Value) => number | null;
+  externalRefs?: Value[];
   nrs?: HowNext[];
   col?: unknown[];
 }
@@ -19,7 +19,7 @@ const cycObj2: Record<string, Value> = { a: 3, b: {} };
 const cycPoint = new Point(8, 9);
 (cycPoint as unknown as Record<string, Value>).x = cycPoint;
 
-const extBacks = [[100], [101], [102]];
+export const extBacks = [[100], [101], [102]];
 
 const backrefCb = (refNum: number): number[] => extBacks[refNum];
 
@@ -50,6 +50,18 @@ const pairs: Pair[] = [
     x: 3,
     s: '#3',
   },
+  {
+    x: 2147483648,
+    s: '#2147483648',
+  },
+  {
+    x: -2147483649,
+    s: '#-2147483649',
+  },
+  {
+    x: 1152921504606847000,
+    s: '#1152921504606847000',
+  },
   {
     x: true,
     s: '#t',
@@ -188,17 +200,27 @@ const pairs: Pair[] = [
     s: '{a:#3|b:|1}',
     backrefCb,
     haverefCb,
+    externalRefs: extBacks,
   },
   {
     x: { a: 3, b: extBacks[2] },
     s: '{a:#3|b:|3}',
     backrefCb,
     haverefCb,
+    externalRefs: extBacks,
   },
   {
     s: '{a:#3|b:|4}',
     backrefCb,
     haverefCb,
+    externalRefs: extBacks,
+    parseFailPos: 9,
+  },
+  {
+    s: '{a:#3|b:|4294967297}',
+    backrefCb,
+    haverefCb,
+    externalRefs: extBacks,
     parseFailPos: 9,
   },
   {
@@ -206,12 +228,14 @@ const pairs: Pair[] = [
     s: '|0',
     backrefCb,
     haverefCb,
+    externalRefs: extBacks,
   },
   {
     x: extBacks[1],
     s: '|1',
     backrefCb,
     haverefCb,
+    externalRefs: extBacks,
   },
   // extension
   {
@@ -257,6 +281,14 @@ const pairs: Pair[] = [
     s: '#123x',
     parseFailPos: 1,
   },
+  {
+    s: '[a|#123x]',
+    parseFailPos: 4,
+  },
+  {
+    s: '{a:#123x}',
+    parseFailPos: 4,
+  },
   {
     s: '#[x]',
     parseFailPos: 1,
@@ -0,0 +1,106 @@
+// A separately built addon with native connectors, for test/27-native-connector-test.ts.
+#include <nan.h>
+#include "wson_native_connector.h"
+
+static int splitPoint(void*, v8::Isolate*, v8::Local<v8::Object>, v8::Local<v8::Value>*, int);
+static v8::Local<v8::Value> createPoint(void*, v8::Isolate*, const v8::Local<v8::Value>*, int);
+
+// The handles of this addon, one instance per isolate as AddonData of wson-addon, so it can be loaded in workers.
+// Its point connector carries it as data.
+struct PointData {
+  Nan::Persistent<v8::Function> pointClass;
+  Nan::Persistent<v8::String> sX;
+  Nan::Persistent<v8::String> sY;
+  WsonNativeConnector pointConnector;
+
+  // freed when the environment (main thread or worker) of isolate exits
+  explicit PointData(v8::Isolate* isolate) {
+    sX.Reset(Nan::New("x").ToLocalChecked());
+    sY.Reset(Nan::New("y").ToLocalChecked());
+    pointConnector = {WSON_NATIVE_CONNECTOR_ABI, this, splitPoint, createPoint};
+    node::AddEnvironmentCleanupHook(isolate, cleanup, this);
+  }
+
+  ~PointData() {
+    pointClass.Reset();
+    sX.Reset();
+    sY.Reset();
+  }
+
+  static void cleanup(void* arg) {
+    delete static_cast<PointData*>(arg);
+  }
+};
+
+static int splitPoint(void* data, v8::Isolate*, v8::Local<v8::Object> x, v8::Local<v8::Value>* args, int room) {
+  if (room < 2) {
+    return 2;
+  }
+  PointData* pd = static_cast<PointData*>(data);
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  args[0] = x->Get(context, Nan::New(pd->sX)).ToLocalChecked();
+  args[1] = x->Get(context, Nan::New(pd->sY)).ToLocalChecked();
+  return 2;
+}
+
+static v8::Local<v8::Value> createPoint(void* data, v8::Isolate*, const v8::Local<v8::Value>* args, int argc) {
+  v8::Local<v8::Value> argv[2] = {Nan::Undefined(), Nan::Undefined()};
+  for (int i=0; i<argc && i<2; ++i) {
+    argv[i] = args[i];
+  }
+  PointData* pd = static_cast<PointData*>(data);
+  Nan::MaybeLocal<v8::Object> result = Nan::NewInstance(Nan::New(pd->pointClass), 2, argv);
+  return result.IsEmpty() ? v8::Local<v8::Value>() : v8::Local<v8::Value>(result.ToLocalChecked());
+}
+
+// splits into as many args as x.length, more than fit at first
+static int splitRange(void*, v8::Isolate*, v8::Local<v8::Object> x, v8::Local<v8::Value>* args, int room) {
+  const v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  int length = Nan::To<int32_t>(x->Get(context, Nan::New("length").ToLocalChecked()).ToLocalChecked()).FromMaybe(0);
+  if (length > room) {
+    return length;
+  }
+  for (int i=0; i<length; ++i) {
+    args[i] = Nan::New<v8::Number>(i);
+  }
+  return length;
+}
+
+static v8::Local<v8::Value> createNumber(void*, v8::Isolate* isolate, const v8::Local<v8::Value>*, int) {
+  return v8::Number::New(isolate, 1);
+}
+
+static int splitFailing(void*, v8::Isolate*, v8::Local<v8::Object>, v8::Local<v8::Value>*, int) {
+  Nan::ThrowRangeError("cannot split");
+  return -1;
+}
+
+static v8::Local<v8::Value> createFailing(void*, v8::Isolate*, const v8::Local<v8::Value>*, int) {
+  Nan::ThrowRangeError("cannot create");
+  return v8::Local<v8::Value>();
+}
+
+static const WsonNativeConnector rangeConnector = {WSON_NATIVE_CONNECTOR_ABI, NULL, splitRange, NULL};
+static const WsonNativeConnector failingConnector = {WSON_NATIVE_CONNECTOR_ABI, NULL, splitFailing, createFailing};
+static const WsonNativeConnector numberConnector = {WSON_NATIVE_CONNECTOR_ABI, NULL, NULL, createNumber};
+static const WsonNativeConnector futureConnector = {WSON_NATIVE_CONNECTOR_ABI + 1, NULL, splitFailing, createFailing};
+
+NAN_METHOD(Point) {
+  PointData* pd = static_cast<PointData*>(info.Data().As<v8::External>()->Value());
+  pd->pointClass.Reset(info[0].As<v8::Function>());
+  info.GetReturnValue().Set(wsonNativeConnector(info.GetIsolate(), &pd->pointConnector));
+}
+
+NAN_MODULE_INIT(Init) {
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  PointData* pd = new PointData(isolate);
+  v8::Local<v8::External> data = Nan::New<v8::External>(pd);
+  Nan::Set(target, Nan::New("point").ToLocalChecked(), Nan::GetFunction(Nan::New<v8::FunctionTemplate>(Point, data)).ToLocalChecked());
+  Nan::Set(target, Nan::New("range").ToLocalChecked(), wsonNativeConnector(isolate, &rangeConnector));
+  Nan::Set(target, Nan::New("failing").ToLocalChecked(), wsonNativeConnector(isolate, &failingConnector));
+  Nan::Set(target, Nan::New("number").ToLocalChecked(), wsonNativeConnector(isolate, &numberConnector));
+  Nan::Set(target, Nan::New("future").ToLocalChecked(), wsonNativeConnector(isolate, &futureConnector));
+  Nan::Set(target, Nan::New("foreign").ToLocalChecked(), data); // not a connector
+}
+
+NAN_MODULE_WORKER_ENABLED(wson_test_connector, Init)
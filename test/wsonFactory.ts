@@ -3,8 +3,18 @@ import {
   Value,
   FactoryOptions,
   Connector,
+  DiffPath,
   HowNext,
+  LazyValue,
   PartialCb,
+  RecordBatch,
+  RecordBounds,
+  RecordSpec,
+  SchemaOptions,
+  ParserStats,
+  StringifierStats,
+  Tokens,
+  ValidateResult,
   BaseStringifyError,
   BaseParseError,
 } from '../src/types';
@@ -33,8 +43,26 @@ export interface Wson {
   stringify(x: Value, opt: OpOptions): string;
   parse(s: string, opt: OpOptions): Value;
   parsePartial(s: string, opt: OpOptions): Value;
+  parseLazy(s: string, opt: OpOptions): LazyValue;
+  tokenize(s: string): Tokens;
+  validate(s: string, externalRefs?: boolean | number): ValidateResult;
+  splitRecords(s: string | ArrayBufferView, more?: boolean): RecordBounds;
+  parseRecords(s: string | ArrayBufferView, start?: number, maxCount?: number, more?: boolean): RecordBatch;
+  stringifyToFile(path: string, x: Value, opt: OpOptions): number;
+  parseFile(path: string, opt: OpOptions): Value;
+  diff(a: string, b: string, maxPaths?: number): DiffPath[];
+  toJSON(s: string, customPrefix?: string): string | undefined;
+  fromJSON(json: string, customPrefix?: string): string;
+  canonicalize(s: string): string;
   connectorOfCname(name: string): Connector<unknown>;
   connectorOfValue(value: Value): Connector<unknown>;
+  compileSchema(spec: RecordSpec, options?: SchemaOptions): {
+    stringify(x: Value, opt: OpOptions): string;
+    parse(s: string, opt: OpOptions): Value;
+  };
+  getStats(): { stringifier: StringifierStats; parser: ParserStats };
+  resetStats(): void;
+  trim(): void;
 }
 
 export interface Factory {
@@ -60,13 +88,46 @@ function factory(options: FactoryOptions): Wson {
       return stringifier.getTypeid(x);
     },
     stringify(x: Value, opt: OpOptions) {
-      return stringifier.stringify(x, opt.haverefCb);
+      return stringifier.stringify(x, opt.externalRefs ?? opt.haverefCb);
     },
     parse(s: string, opt: OpOptions) {
-      return parser.parse(s, opt.backrefCb);
+      return parser.parse(s, opt.externalRefs ?? opt.backrefCb, opt.projection);
     },
     parsePartial(s: string, opt: OpOptions) {
-      return parser.parsePartial(s, opt.howNext ?? dftHowNext, opt.cb ?? dftCb, opt.backrefCb);
+      return parser.parsePartial(s, opt.howNext ?? dftHowNext, opt.cb ?? dftCb, opt.externalRefs ?? opt.backrefCb);
+    },
+    parseLazy(s: string, opt: OpOptions) {
+      return parser.parseLazy(s, opt.externalRefs ?? opt.backrefCb);
+    },
+    tokenize(s: string) {
+      return parser.tokenize(s);
+    },
+    validate(s: string, externalRefs?: boolean | number) {
+      return parser.validate(s, externalRefs);
+    },
+    splitRecords(s: string | ArrayBufferView, more?: boolean) {
+      return parser.splitRecords(s, more);
+    },
+    parseRecords(s: string | ArrayBufferView, start?: number, maxCount?: number, more?: boolean) {
+      return parser.parseRecords(s, start, maxCount, more);
+    },
+    stringifyToFile(path: string, x: Value, opt: OpOptions) {
+      return stringifier.stringifyToFile(path, x, opt.externalRefs ?? opt.haverefCb);
+    },
+    parseFile(path: string, opt: OpOptions) {
+      return parser.parseFile(path, opt.externalRefs ?? opt.backrefCb);
+    },
+    diff(a: string, b: string, maxPaths?: number) {
+      return parser.diff(a, b, maxPaths);
+    },
+    toJSON(s: string, customPrefix?: string) {
+      return parser.toJSON(s, customPrefix);
+    },
+    fromJSON(json: string, customPrefix?: string) {
+      return parser.fromJSON(json, customPrefix);
+    },
+    canonicalize(s: string) {
+      return parser.canonicalize(s);
     },
     connectorOfCname(cname: string) {
       return parser.connectorOfCname(cname);
@@ -74,6 +135,29 @@ function factory(options: FactoryOptions): Wson {
     connectorOfValue(value: Value) {
       return stringifier.connectorOfValue(value);
     },
+    compileSchema(spec: RecordSpec, options?: SchemaOptions) {
+      const stringifyRecord = stringifier.compileSchema(spec, options);
+      const parseRecord = parser.compileSchema(spec);
+      return {
+        stringify(x: Value, opt: OpOptions) {
+          return stringifyRecord(x, opt.externalRefs ?? opt.haverefCb);
+        },
+        parse(s: string, opt: OpOptions) {
+          return parseRecord(s, opt.externalRefs ?? opt.backrefCb);
+        },
+      };
+    },
+    getStats() {
+      return { stringifier: stringifier.getStats(), parser: parser.getStats() };
+    },
+    resetStats() {
+      stringifier.resetStats();
+      parser.resetStats();
+    },
+    trim() {
+      stringifier.trim();
+      parser.trim();
+    },
   };
 }
 